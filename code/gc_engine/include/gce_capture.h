@@ -0,0 +1,66 @@
+#ifndef GCE_CAPTURE_H
+#define GCE_CAPTURE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <glad/glad.h>
+#include "gce_math.h"
+#include "gce_utils.h"
+#include "gce_rendering.h"
+#include "gce_threading.h"
+
+#define FRAME_CAPTURE_PBO_CNT 3 // How many frames a readback can be behind by before frames start getting dropped.
+#define FRAME_CAPTURE_QUEUE_LEN 8 // How many frames can be waiting on the writer thread before frames start getting dropped.
+#define FRAME_CAPTURE_FILE_PATH_SIZE 256
+
+typedef enum {
+    ek_frame_capture_format_raw, // RGBA8 frames, top row first, one after another in a single file.
+    ek_frame_capture_format_png, // A numbered PNG file per frame in a directory.
+    ek_frame_capture_format_y4m // A single YUV 4:2:0 video file.
+} e_frame_capture_format;
+
+typedef struct {
+    t_byte* pxs; // RGBA8, bottom row first as read back.
+    s_vec_2d_i size;
+    int index;
+    int repeat_cnt; // How many times over the frame is to be written again after the first.
+} s_captured_frame;
+
+// Reads frames back through a ring of pixel buffer objects, only mapping each once its fence shows the copy to be done, then hands them over to a writer thread. Frames are dropped rather than waited on if either falls behind.
+typedef struct {
+    e_frame_capture_format format;
+    char out_path[FRAME_CAPTURE_FILE_PATH_SIZE]; // A directory for PNG sequences, a file otherwise.
+    int fps;
+    FILE* fs; // NULL for PNG sequences.
+
+    t_gl_id pbo_gl_ids[FRAME_CAPTURE_PBO_CNT];
+    s_vec_2d_i pbo_sizes[FRAME_CAPTURE_PBO_CNT]; // What each buffer is currently allocated to hold.
+    s_vec_2d_i pbo_frame_sizes[FRAME_CAPTURE_PBO_CNT]; // The size of the frame each in-flight buffer is being read into.
+    int pbo_frame_indices[FRAME_CAPTURE_PBO_CNT];
+    int pbo_frame_repeat_cnts[FRAME_CAPTURE_PBO_CNT];
+    GLsync pbo_fences[FRAME_CAPTURE_PBO_CNT];
+    int pbo_begin;
+    int pbo_cnt;
+
+    s_vec_2d_i stream_size; // Raw and Y4M output is fixed to the size of the first frame, with frames of any other size being dropped.
+
+    // Owned by the writer thread while it's between the beginning and end of the queue, and by the main thread otherwise.
+    s_captured_frame queue[FRAME_CAPTURE_QUEUE_LEN];
+    int queue_begin;
+    int queue_cnt;
+    bool stopping;
+    bool write_failed;
+    s_mutex mtx;
+    s_cond cnd;
+    s_thread writer_thread;
+
+    int frame_cnt; // Including those dropped.
+    int dropped_frame_cnt;
+} s_frame_capture;
+
+bool BeginFrameCapture(s_frame_capture* const capture, const char* const out_path, const e_frame_capture_format format, const int fps);
+void CaptureFrame(s_frame_capture* const capture, const s_vec_2d_i display_size);
+void RepeatCapturedFrame(s_frame_capture* const capture);
+bool EndFrameCapture(s_frame_capture* const capture);
+
+#endif
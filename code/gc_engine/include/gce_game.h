@@ -6,6 +6,7 @@
 #include <GLFW/glfw3.h>
 #include "gce_math.h"
 #include "gce_rendering.h"
+#include "gce_capture.h"
 #include "gce_utils.h"
 
 typedef uint64_t t_keys_down_bits;
@@ -120,6 +121,8 @@ typedef struct s_game_tick_func_data {
     s_window_state window_state;
     const s_input_state* input_state;
     const s_input_state* input_state_last;
+    bool* visuals_dirty; // To be set if the tick changed anything that gets rendered. Only matters if the game renders only when dirty.
+    s_gl_state_cache* gl_state_cache; // For any GL work done in the tick (e.g. compute steps) to go through, so that rendering knows what was left bound.
 } s_game_tick_func_data;
 
 typedef struct s_game_render_func_data {
@@ -128,6 +131,7 @@ typedef struct s_game_render_func_data {
     s_mem_arena* temp_mem_arena;
     s_rendering_context rendering_context;
     const s_input_state* input_state;
+    bool visuals_dirty; // If false, nothing but the input has changed since the last render, so whatever doesn't depend on the input can be reused from it.
 } s_game_render_func_data;
 
 typedef struct {
@@ -138,6 +142,14 @@ typedef struct {
     const char* window_title;
     e_window_flags window_flags;
 
+    int render_batch_slot_cnt; // Optional, RENDER_BATCH_SLOT_CNT_DEFAULT is used if 0.
+    const char* shader_prog_cache_dir; // Optional, linked shader program binaries are cached in here if set.
+
+    bool render_only_when_dirty; // If set, frames are only rendered if a tick reports the visuals as dirty, the input changes, or the window is resized. Otherwise the loop waits on events.
+
+    const char* capture_out_path; // Optional, every frame is captured to here if set.
+    e_frame_capture_format capture_format;
+
     bool (*init_func)(const s_game_init_func_data* const func_data);
     bool (*tick_func)(const s_game_tick_func_data* const func_data);
     bool (*render_func)(const s_game_render_func_data* const func_data);
@@ -0,0 +1,72 @@
+#ifndef GCE_RENDER_RECORDING_H
+#define GCE_RENDER_RECORDING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <glad/glad.h>
+#include "gce_utils.h"
+
+//
+// The renderer calls GL through glad's function table. The recording backend swaps out the entries
+// the engine uses, so that every call is recorded as a command. Calls are either forwarded to GL,
+// for draw call accounting on a real GPU, or not, for running headless. In that case the calls that
+// return something get plausible results (generated IDs, successful compiles, signalled fences).
+// If GL hasn't been loaded, unhooked calls are trapped until the recording ends.
+//
+
+#define RENDER_RECORDING_GL_CMD_ARG_CNT 4
+
+typedef enum {
+    ek_recorded_gl_cmd_type_draw,
+    ek_recorded_gl_cmd_type_dispatch,
+    ek_recorded_gl_cmd_type_clear,
+    ek_recorded_gl_cmd_type_blit,
+    ek_recorded_gl_cmd_type_bind,
+    ek_recorded_gl_cmd_type_upload,
+    ek_recorded_gl_cmd_type_readback,
+    ek_recorded_gl_cmd_type_state,
+    ek_recorded_gl_cmd_type_resource,
+    ek_recorded_gl_cmd_type_sync,
+    ek_recorded_gl_cmd_type_query,
+
+    eks_recorded_gl_cmd_type_cnt
+} e_recorded_gl_cmd_type;
+
+typedef struct {
+    e_recorded_gl_cmd_type type;
+    const char* name; // The name of the GL function called.
+    int64_t args[RENDER_RECORDING_GL_CMD_ARG_CNT]; // What these are depends on the function, but they're the arguments that matter most for it (e.g. the instance count for an instanced draw).
+    int64_t byte_cnt; // How much was uploaded or read back, 0 for anything else.
+} s_recorded_gl_cmd;
+
+typedef struct {
+    bool forward_to_gl;
+
+    s_recorded_gl_cmd* cmds;
+    int cmd_cnt;
+    int cmd_cap;
+
+    // Running totals, which are reset along with the commands.
+    int type_cnts[eks_recorded_gl_cmd_type_cnt];
+    int64_t upload_byte_cnt;
+    int64_t readback_byte_cnt;
+
+    // For standing in for GL when calls aren't forwarded to it.
+    GLuint null_gl_id_next;
+    t_byte* null_map_buf;
+    int64_t null_map_buf_size;
+} s_render_recording;
+
+bool BeginRenderRecording(s_render_recording* const recording, const bool forward_to_gl);
+void EndRenderRecording(s_render_recording* const recording);
+void ResetRenderRecording(s_render_recording* const recording);
+void CleanRenderRecording(s_render_recording* const recording);
+bool WriteRenderRecording(const s_render_recording* const recording, const char* const file_path);
+int RenderRecordingCmdCnt(const s_render_recording* const recording, const char* const name);
+const char* RecordedGLCmdTypeName(const e_recorded_gl_cmd_type type);
+
+inline int RenderRecordingDrawCnt(const s_render_recording* const recording) {
+    return recording->type_cnts[ek_recorded_gl_cmd_type_draw];
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include "gce_math.h"
 #include "gce_utils.h"
+#include "gce_threading.h"
 
 #define TEXTURE_CHANNEL_CNT 4
 
@@ -15,13 +16,57 @@
 #define FONT_TEXTURE_WIDTH 2048
 #define FONT_TEXTURE_HEIGHT_LIMIT 2048
  
-#define RENDER_BATCH_SHADER_PROG_VERT_CNT 13
-#define RENDER_BATCH_SLOT_CNT 256 // TODO: There seems to be an issue here. Seems to crash when this is high (e.g. at 2048).
-#define RENDER_BATCH_SLOT_VERT_CNT (RENDER_BATCH_SHADER_PROG_VERT_CNT * 4)
-#define RENDER_BATCH_SLOT_VERTS_SIZE (RENDER_BATCH_SLOT_VERT_CNT * RENDER_BATCH_SLOT_CNT * sizeof(float))
+#define RENDER_BATCH_SLOT_CNT_DEFAULT 4096
+#define RENDER_BATCH_SLOT_CNT_LIMIT 65536
+#define RENDER_BATCH_SLOT_SIZE sizeof(s_render_batch_slot)
 #define RENDER_BATCH_SLOT_ELEM_CNT 6
+#define RENDER_BATCH_TEX_SLOT_LIMIT 32 // The number of textures a batch can bind is the lesser of this and GL_MAX_TEXTURE_IMAGE_UNITS.
+#define RENDER_BATCH_TEX_SLOT_NONE 0xFF // Given to solid colour quads in the dynamic batch, which sample nothing and so don't take up a texture slot.
+
+// The batch vertex buffer is a ring split into regions, each able to hold several full batches. A fence is placed when we move off a region, and is waited on before that region gets written to again.
+#define RENDER_BATCH_RING_REGION_CNT 3
+#define RENDER_BATCH_RING_REGION_BATCH_CNT 8
+#define RENDER_BATCH_RING_FENCE_TIMEOUT 1000000000 // In nanoseconds.
+
+#define RENDER_POLYLINE_MITER_LIMIT 4.0f // How far a polyline corner can reach along a segment past its join, in half widths. Sharper joins are cut short, so they no longer meet exactly.
+
+#define RENDER_QUEUE_CMD_LIMIT 65536 // If the queue fills up, what it holds gets sorted and submitted early. At most 65536.
+#define RENDER_BULK_ENQUEUE_CHUNK_SIZE 64 // How many bulk instances are filled in at a time before being enqueued.
+#define RENDER_CMD_LIST_THREAD_LIMIT 16 // Including the thread recording is started from.
+#define RENDER_LAYER_LIMIT 256
+#define RENDER_DEPTH_LIMIT 256 // Depths order commands within a layer.
 
 #define RENDER_SURFACE_LIMIT 8
+#define RENDER_SURFACE_SIZE_GRANULARITY 256 // Surface textures are allocated in steps of this many pixels per dimension, so that small resizes fit in the slack.
+
+#define DYNAMIC_RES_QUERY_CNT 4 // GPU timer queries are read back this many frames late at most, so that we never wait on one.
+#define DYNAMIC_RES_SCALE_MIN 0.5f
+#define DYNAMIC_RES_SCALE_MAX 1.0f
+#define DYNAMIC_RES_SCALE_STEP_LIMIT 0.05f // The most the scale can change by in a frame, so that the resolution shift is gradual.
+#define DYNAMIC_RES_GPU_TIME_SMOOTHING 0.1f // The weight given to each new GPU time measurement in the running average.
+#define DYNAMIC_RES_GPU_TIME_TOLERANCE 0.1f // How far off the target GPU time (as a fraction of it) we can be before the scale is changed.
+
+#define PARTICLE_BURST_LIMIT 256 // How many emissions can be made between simulation steps. Any beyond this are dropped.
+#define PARTICLE_WORK_GROUP_SIZE 64
+
+#define GPU_PROJECTILE_SPAWN_LIMIT 4096 // How many projectiles can be spawned between steps.
+#define GPU_PROJECTILE_TARGET_LIMIT 512
+#define GPU_PROJECTILE_HIT_LIMIT 1024 // How many hits can be reported per step. A projectile whose hit can't be reported is kept alive, for it to be reported on a later step.
+#define GPU_PROJECTILE_HIT_READBACK_CNT 4 // How many steps can have their hits in flight before a step has to wait on the oldest.
+#define GPU_PROJECTILE_HIT_FENCE_TIMEOUT 1000000000 // In nanoseconds.
+#define GPU_PROJECTILE_WORK_GROUP_SIZE 64
+
+#define RENDER_GRAPH_TARGET_LIMIT 16
+#define RENDER_GRAPH_PASS_LIMIT 16
+#define RENDER_GRAPH_PASS_INPUT_LIMIT 4
+#define RENDER_GRAPH_DISPLAY_TARGET -1
+
+#define SHADER_PROG_UNIFORM_LIMIT 32 // Can't exceed 32, as there's a bit per uniform for whether it has been set.
+#define SHADER_PROG_UNIFORM_NAME_SIZE 64
+#define SHADER_PROG_UNIFORM_HASH_TABLE_SIZE 64 // Must be a power of two, kept at twice the uniform limit so that probe sequences stay short.
+
+#define RENDER_FRAME_UNIFORM_BLOCK_NAME "FrameUniforms"
+#define RENDER_FRAME_UNIFORM_BLOCK_BINDING 0
 
 #define WHITE (s_color){1.0f, 1.0f, 1.0f, 1.0f}
 #define RED (s_color){1.0f, 0.0f, 0.0f, 1.0f}
@@ -37,20 +82,108 @@ typedef GLuint t_gl_id;
 
 typedef struct {
     t_gl_id vert_array_gl_id;
-    t_gl_id vert_buf_gl_id;
+    t_gl_id quad_vert_buf_gl_id; // Static unit quad shared by every slot.
+    t_gl_id slot_buf_gl_id; // The ring of per-instance slot data.
     t_gl_id elem_buf_gl_id;
 } s_render_batch_gl_ids;
 
+// A single instance of the unit quad, as laid out in the batch ring. Normalised integer fields are expanded to floats by the vertex fetch.
+//
+// Line segments are instances too: the position is the start, the size is the vector to the end,
+// the rotation is the width, and the origin holds the miters at each end (see RenderPolyline()).
+typedef struct {
+    s_vec_2d pos;
+    s_vec_2d size;
+    float rot;
+    uint16_t origin[2];
+    uint16_t tex_coords[4]; // Left, top, right, bottom.
+    uint8_t blend[4];
+    uint8_t flash[4]; // The colour to push the sprite towards, with the alpha being by how much.
+    uint8_t tex_slot; // Index into the textures bound for the batch.
+    uint8_t segment; // Nonzero if this is a line segment.
+} s_render_batch_slot;
+
+typedef struct {
+    GLsync region_fences[RENDER_BATCH_RING_REGION_CNT];
+    int batch_size; // In bytes, derived from the batch slot count.
+    int region_size; // In bytes, a multiple of the batch size.
+    int region_index;
+    int write_offs; // Byte offset into the ring at which the next batch will be written.
+} s_render_batch_ring;
+
+typedef struct {
+    s_render_batch_slot slot; // The texture slot is only assigned once the command is submitted.
+    t_gl_id tex_gl_id;
+} s_render_cmd;
+
+typedef struct {
+    s_render_cmd* cmds;
+    uint64_t* keys; // Layer, shader program, texture and command index, from most to least significant.
+    uint64_t* keys_temp; // Scratch space for sorting.
+} s_render_queue;
+
+// Render commands recorded ahead of submission. Adding to a list touches no GL or rendering state, so lists can be filled on other threads (one per thread) and then submitted from the main thread, in whatever order is wanted.
+typedef struct {
+    s_render_cmd* cmds;
+    int cmd_cnt;
+    int cmd_limit;
+} s_render_cmd_list;
+
+typedef void (*t_render_cmd_list_record_func)(s_render_cmd_list* const list, const int list_index, void* const user_data);
+
+// Threads kept around for recording command lists, so that none have to be started per recording. They're only started once first needed, and no more than are needed.
+typedef struct {
+    s_thread threads[RENDER_CMD_LIST_THREAD_LIMIT - 1];
+    int thread_cnt;
+    int thread_index_next; // Each thread takes an index from this once running, which decides the list it records (the index plus one, as the first list is left to the calling thread).
+
+    bool sync_inited;
+    s_mutex mtx;
+    s_cond job_cnd; // Broadcast when jobs are handed out, or the threads are to quit.
+    s_cond done_cnd; // Signalled when the last job handed out is done.
+
+    // What is to be recorded, only touched while holding the mutex.
+    bool jobs_pending[RENDER_CMD_LIST_THREAD_LIMIT - 1]; // By thread index.
+    int jobs_left_cnt;
+    bool quit;
+    s_render_cmd_list* lists;
+    t_render_cmd_list_record_func func;
+    void* user_data;
+} s_render_cmd_list_workers;
+
+// Features that the quads of a batch might use. Each combination has its own variant of the batch shader program with the unused features compiled out, and a batch is drawn with the variant covering just what its quads used.
+typedef enum {
+    ek_render_batch_feature_rotation = 1 << 0,
+    ek_render_batch_feature_texture = 1 << 1,
+    ek_render_batch_feature_segment = 1 << 2
+} e_render_batch_features;
+
+#define RENDER_BATCH_FEATURES_ALL (ek_render_batch_feature_rotation | ek_render_batch_feature_texture | ek_render_batch_feature_segment)
+#define RENDER_BATCH_SHADER_PROG_VARIANT_CNT (RENDER_BATCH_FEATURES_ALL + 1)
+
 typedef struct {
     t_gl_id gl_id;
-    int proj_uniform_loc;
-    int view_uniform_loc;
     int textures_uniform_loc;
 } s_render_batch_shader_prog;
 
+typedef enum {
+    ek_render_target_size_full,
+    ek_render_target_size_half,
+    ek_render_target_size_quarter
+} e_render_target_size;
+
+typedef enum {
+    ek_render_target_format_rgba8,
+    ek_render_target_format_rgba16f
+} e_render_target_format;
+
+// Surface textures are only allocated once a surface is first set. They are kept across frames and only reallocated if they are too small for what is needed, too large by some margin, or of the wrong format.
 typedef struct {
     t_gl_id framebuffer_gl_ids[RENDER_SURFACE_LIMIT];
     t_gl_id framebuffer_tex_gl_ids[RENDER_SURFACE_LIMIT];
+    s_vec_2d_i tex_sizes[RENDER_SURFACE_LIMIT]; // The allocated sizes.
+    s_vec_2d_i sizes[RENDER_SURFACE_LIMIT]; // The sizes last set with, which only the top-left of the textures is used for.
+    e_render_target_format formats[RENDER_SURFACE_LIMIT];
 } s_render_surfaces;
 
 typedef enum {
@@ -75,28 +208,135 @@ typedef struct {
     };
 } s_shader_prog_uniform_value;
 
+// The active uniforms of a shader program outside of any uniform block, reflected once on load. Names are looked up through an open-addressing hash table, after which uniforms are referred to by handle. The last value uploaded to each uniform is shadowed so that redundant uploads can be skipped.
+typedef struct {
+    t_gl_id prog_gl_id;
+
+    char names[SHADER_PROG_UNIFORM_LIMIT][SHADER_PROG_UNIFORM_NAME_SIZE];
+    int locs[SHADER_PROG_UNIFORM_LIMIT];
+    e_shader_prog_uniform_value_type types[SHADER_PROG_UNIFORM_LIMIT];
+    s_shader_prog_uniform_value vals[SHADER_PROG_UNIFORM_LIMIT];
+    uint32_t vals_set; // A bit per uniform, set once a value has been uploaded through us.
+    int cnt;
+
+    int8_t hash_table[SHADER_PROG_UNIFORM_HASH_TABLE_SIZE]; // Uniform indices, -1 for empty.
+} s_shader_prog_uniforms;
+
+typedef struct {
+    s_shader_prog_uniforms* uniforms;
+    int index;
+    e_shader_prog_uniform_value_type type;
+} s_shader_prog_uniform_handle;
+
+// Per-frame constants shared by every shader program through a std140 uniform block bound at RENDER_FRAME_UNIFORM_BLOCK_BINDING. Shaders can declare it as follows:
+//
+// layout (std140) uniform FrameUniforms {
+//     mat4 u_proj;
+//     mat4 u_view;
+//     vec2 u_display_size;
+//     float u_time;
+// };
+typedef struct {
+    t_matrix_4x4 proj_mat;
+    t_matrix_4x4 view_mat;
+    s_vec_2d display_size;
+    float time;
+    float padding; // std140 rounds the block size up to a multiple of 16 bytes.
+} s_render_frame_uniforms;
+
+typedef enum {
+    ek_gl_binding_shader_prog = 1 << 0,
+    ek_gl_binding_vert_array = 1 << 1,
+    ek_gl_binding_array_buf = 1 << 2,
+    ek_gl_binding_framebuffer = 1 << 3,
+    ek_gl_binding_active_tex_unit = 1 << 4,
+    ek_gl_binding_viewport = 1 << 5
+} e_gl_binding;
+
+// Tracks the GL bindings made through the renderer, so that redundant ones can be skipped. Bindings are only trusted once their bits are set, so zeroing the cache (as BeginRendering() does) makes it start from scratch.
+typedef struct {
+    e_gl_binding known_bindings;
+    uint32_t known_tex_units;
+
+    t_gl_id shader_prog_gl_id;
+    t_gl_id vert_array_gl_id;
+    t_gl_id array_buf_gl_id;
+    t_gl_id framebuffer_gl_id;
+    int active_tex_unit;
+    t_gl_id tex_gl_ids[RENDER_BATCH_TEX_SLOT_LIMIT];
+    s_vec_2d_i viewport_size;
+} s_gl_state_cache;
+
+// A batch recorded once and kept on the GPU, for geometry that rarely or never changes. The slots are shadowed on the CPU so that they can be rewritten individually, with only the dirty range being re-uploaded on the next render.
+typedef struct {
+    t_gl_id vert_array_gl_id;
+    t_gl_id slot_buf_gl_id;
+
+    s_render_batch_slot* slots;
+    int slot_cnt;
+    int slot_limit;
+
+    t_gl_id tex_gl_ids[RENDER_BATCH_TEX_SLOT_LIMIT];
+    int tex_slots_used_cnt;
+    int tex_slot_limit;
+
+    int dirty_begin;
+    int dirty_end; // Exclusive, equal to the beginning if nothing is dirty.
+
+    e_render_batch_features features; // Built up as slots are written, and only reset on clear. Static batches are assumed to be textured.
+} s_static_render_batch;
+
 typedef struct {
-    s_render_batch_shader_prog batch_shader_prog;
+    s_render_batch_shader_prog batch_shader_progs[RENDER_BATCH_SHADER_PROG_VARIANT_CNT]; // Indexed by the features used. Every variant is loaded up front.
+    int batch_tex_slot_cnt;
     s_render_batch_gl_ids batch_gl_ids;
+    s_render_batch_ring batch_ring;
+    int batch_slot_cnt; // The number of slots that can be rendered in a single batch before a flush is forced.
+
+    s_render_queue queue;
+
+    s_render_cmd_list_workers cmd_list_workers;
 
     s_render_surfaces surfs;
     t_gl_id surf_vert_array_gl_id;
     t_gl_id surf_vert_buf_gl_id;
     t_gl_id surf_elem_buf_gl_id;
+    s_vec_2d surf_tex_coords_scales[RENDER_SURFACE_LIMIT]; // Each surface has a quad of its own in the vertex buffer, with texture coordinates going up to this.
 
     t_gl_id px_tex_gl_id;
+
+    t_gl_id frame_uniform_buf_gl_id;
+
 } s_pers_render_data;
 
 typedef struct {
     int batch_slots_used_cnt;
-    float batch_slot_verts[RENDER_BATCH_SLOT_CNT][RENDER_BATCH_SLOT_VERT_CNT];
-    t_gl_id batch_tex_gl_id;
+    s_render_batch_slot* batch_slots; // Points into the mapped range of the batch ring while a batch is in progress, NULL otherwise.
+    t_gl_id batch_tex_gl_ids[RENDER_BATCH_TEX_SLOT_LIMIT];
+    int batch_tex_slots_used_cnt;
+    e_render_batch_features batch_features;
+
+    // While the queue is active, rendered quads are recorded as commands and are only sorted and submitted on flush.
+    bool queue_active;
+    bool queue_stable; // If true, submission order is kept within each layer and depth.
+    int queue_cmd_cnt;
+    int layer;
+    int depth;
 
     t_gl_id surf_shader_prog_gl_id; // When a surface is rendered, this shader program is used.
     int surf_index_stack[RENDER_SURFACE_LIMIT];
     int surf_index_stack_height;
 
+    // While a virtual resolution pass is active, the projection covers its surface instead of the display.
+    int virtual_res_scale; // 0 if no virtual resolution pass is active.
+    int virtual_res_surf_index;
+    s_vec_2d virtual_res_view_offs; // Snapped off of the view translation, in display pixels, for the upscale.
+
     t_matrix_4x4 view_mat;
+    bool frame_uniforms_dirty; // Set when the view matrix changes, so that the uniform buffer is updated on the next flush.
+    s_vec_2d_i frame_uniforms_display_size;
+
+    s_gl_state_cache gl_state_cache;
 } s_rendering_state;
 
 typedef struct {
@@ -131,6 +371,7 @@ typedef struct {
 
 typedef struct {
     t_gl_id* gl_ids;
+    s_shader_prog_uniforms* uniforms;
     int cnt;
 } s_shader_progs;
 
@@ -157,8 +398,58 @@ typedef struct {
     s_pers_render_data* pers;
     s_rendering_state* state;
     s_vec_2d_i display_size;
+    float time; // In seconds.
 } s_rendering_context;
 
+typedef struct {
+    void* user_data;
+    int input_surf_indices[RENDER_GRAPH_PASS_INPUT_LIMIT]; // The surfaces the input targets ended up in, for use with RenderSurface().
+    int input_cnt;
+} s_render_pass_info;
+
+typedef bool (*t_render_pass_func)(const s_rendering_context* const context, const s_render_pass_info* const pass_info);
+
+typedef struct {
+    t_render_pass_func func;
+    void* user_data;
+    int output_target; // RENDER_GRAPH_DISPLAY_TARGET to render straight to the display.
+    int input_targets[RENDER_GRAPH_PASS_INPUT_LIMIT];
+    int input_cnt;
+} s_render_pass;
+
+typedef struct {
+    e_render_target_size size;
+    e_render_target_format format;
+} s_render_target_desc;
+
+// Passes are declared in execution order against virtual targets, which only get backed by surfaces at execution. Passes that don't contribute to the display are culled, and targets whose lifetimes don't overlap share surfaces.
+//
+// The display target is whatever is being rendered to when the graph is executed. Surfaces in the surface stack at that point are never used to back targets, and neither are those reserved.
+typedef struct {
+    s_render_target_desc targets[RENDER_GRAPH_TARGET_LIMIT];
+    int target_cnt;
+
+    s_render_pass passes[RENDER_GRAPH_PASS_LIMIT];
+    int pass_cnt;
+
+    bool surfs_reserved[RENDER_SURFACE_LIMIT]; // For surfaces the caller holds onto across frames.
+} s_render_graph;
+
+// Has a pass render into a surface at a fraction of the display resolution before being upscaled, with the fraction being adjusted every frame to keep the GPU time of the pass near a target.
+typedef struct {
+    float scale; // Applied to each dimension of the display size.
+    float target_gpu_time; // In milliseconds.
+    float gpu_time; // A running average in milliseconds, 0 until the first measurement comes in.
+
+    t_gl_id query_gl_ids[DYNAMIC_RES_QUERY_CNT];
+    float query_scales[DYNAMIC_RES_QUERY_CNT]; // The scale each query was issued at.
+    int query_begin; // The oldest query still waiting on a result.
+    int query_cnt; // How many queries are waiting on results.
+
+    int surf_index; // -1 while no pass is active.
+    bool pass_timed; // Whether the active pass got a query, which it won't if all are still waiting on results.
+} s_dynamic_res;
+
 typedef struct {
     float r;
     float g;
@@ -189,11 +480,216 @@ inline s_color_rgb ToColorRGB(const s_color col) {
     return (s_color_rgb){col.r, col.g, col.b};
 }
 
-bool InitPersRenderData(s_pers_render_data* const render_data, const s_vec_2d_i display_size);
+// Structure-of-arrays input for rendering many instances of the one texture region at once. Optional arrays can be left NULL for their defaults.
+typedef struct {
+    int cnt;
+    const s_vec_2d* positions;
+    const float* rots; // Optional, defaults to 0.
+    const s_vec_2d* scales; // Optional, defaults to 1.
+    const s_color* blends; // Optional, defaults to white.
+    const s_color* flashes; // Optional, defaults to no flash.
+} s_render_bulk_input;
+
+// Laid out as the particle shaders expect (std430). Particles only ever exist on the GPU, this is just for sizing their buffers.
+typedef struct {
+    s_vec_2d pos;
+    s_vec_2d vel;
+    float age; // In ticks.
+    float lifetime; // In ticks.
+    float size_begin;
+    float size_end;
+    float drag;
+    uint32_t col_begin; // Packed RGBA8.
+    uint32_t col_end;
+    uint32_t padding;
+} s_particle;
+
+// Laid out as the particle simulation shader expects (std430). One of these is recorded per emission, with the particles themselves only being generated on the GPU.
+typedef struct {
+    s_vec_2d pos;
+    float dir;
+    float spread;
+    float spd_min;
+    float spd_max;
+    float lifetime_min;
+    float lifetime_max;
+    float size_begin;
+    float size_end;
+    float drag;
+    uint32_t col_begin;
+    uint32_t col_end;
+    uint32_t particle_begin; // Where among all particles emitted this step those of this burst begin.
+    uint32_t tick_cnt; // How many ticks have passed since the emission, which the new particles are advanced by.
+    uint32_t padding;
+} s_particle_burst;
+
+// Laid out as GL expects for glDispatchComputeIndirect() and glDrawArraysIndirect(), followed by the counts used by the simulation shader. Lives on the GPU, so that the live count never needs reading back.
+typedef struct {
+    uint32_t work_group_cnts[3];
+    uint32_t vert_cnt;
+    uint32_t inst_cnt;
+    uint32_t first_vert;
+    uint32_t base_inst;
+    uint32_t live_cnt;
+    uint32_t dest_cnt;
+} s_particle_sim_state;
+
+typedef struct {
+    s_vec_2d pos;
+    int cnt;
+    float dir; // In radians.
+    float spread; // The full angle in radians over which directions are spread, centred on the direction.
+    float spd_min; // Per tick.
+    float spd_max;
+    int lifetime_min; // In ticks.
+    int lifetime_max;
+    float size_begin;
+    float size_end;
+    s_color col_begin;
+    s_color col_end;
+    float drag; // The fraction of velocity lost each tick, less than 1.
+} s_particle_emit_info;
+
+// Particles are simulated by a compute shader over two buffers, with the survivors and new particles of each step being compacted from one into the other. The particle count is kept on the GPU and feeds both the next step's dispatch and the draw indirectly.
+//
+// Emissions and ticks are only recorded on the CPU, with the simulation catching up on them when the particles are next rendered.
+typedef struct {
+    t_gl_id particle_buf_gl_ids[2];
+    int src_particle_buf_index;
+    t_gl_id state_buf_gl_id;
+    t_gl_id burst_buf_gl_id;
+    t_gl_id vert_array_gl_id; // Has nothing in it, as the quads are made from the particle buffer in the vertex shader. GL still needs one bound to draw.
+
+    t_gl_id sim_prog_gl_id;
+    int sim_stage_uniform_loc;
+    int sim_tick_cnt_uniform_loc;
+    int sim_emit_cnt_uniform_loc;
+    int sim_burst_cnt_uniform_loc;
+    int sim_particle_limit_uniform_loc;
+    int sim_seed_uniform_loc;
+    t_gl_id render_prog_gl_id;
+
+    int particle_limit;
+
+    s_particle_burst bursts[PARTICLE_BURST_LIMIT];
+    int burst_cnt;
+    int emit_cnt; // The total across the bursts.
+    int pending_tick_cnt; // How many ticks have passed since the last simulation step.
+    uint32_t seed;
+} s_particle_system;
+
+// Laid out as the projectile shaders expect (std430).
+typedef struct {
+    s_vec_2d pos;
+    s_vec_2d vel; // Per tick.
+    float rot;
+    int dmg;
+    uint32_t hit_mask; // Only targets with a mask sharing a bit with this can be hit.
+    uint32_t padding;
+} s_gpu_projectile;
+
+typedef struct {
+    s_rect rect;
+    uint32_t mask; // 0 for the target to be skipped.
+    uint32_t padding[3];
+} s_gpu_projectile_target;
+
+typedef struct {
+    uint32_t target_index;
+    int dmg;
+    s_vec_2d vel; // The velocity of the projectile at the time of the hit.
+} s_gpu_projectile_hit;
+
+// The hits of a step as written by the simulation shader. The count can go over the limit, with only those within it being written.
+typedef struct {
+    uint32_t cnt;
+    uint32_t padding;
+    s_gpu_projectile_hit hits[GPU_PROJECTILE_HIT_LIMIT];
+} s_gpu_projectile_hit_list;
+
+// Laid out as GL expects for glDispatchComputeIndirect() and glDrawArraysIndirect(), followed by the counts used by the simulation shader.
+typedef struct {
+    uint32_t work_group_cnts[3];
+    uint32_t vert_cnt;
+    uint32_t inst_cnt;
+    uint32_t first_vert;
+    uint32_t base_inst;
+    uint32_t live_cnt;
+    uint32_t src_cnt; // Those live at the start of the step plus those spawned.
+    uint32_t dest_cnt;
+} s_gpu_projectile_sim_state;
+
+// Laid out as GL expects for glDrawArraysIndirect().
+typedef struct {
+    uint32_t vert_cnt;
+    uint32_t inst_cnt;
+    uint32_t first_vert;
+    uint32_t base_inst;
+} s_gpu_projectile_draw_cmd;
+
+typedef struct {
+    const s_gpu_projectile_target* targets;
+    int target_cnt;
+
+    // Projectiles are removed on overlapping a solid cell or leaving the grid. Cells are given a bit each, row by row, with the grid's top-left at the origin.
+    const t_byte* solid_cells;
+    s_vec_2d_i grid_size;
+    float cell_size;
+} s_gpu_projectile_step_input;
+
+// Projectiles are stepped a tick at a time by a compute shader over two buffers, as particles are.
+// The hits of a step are only mapped once its fence passes, so they're reported a step or more late.
+typedef struct {
+    t_gl_id proj_buf_gl_ids[2];
+    int src_proj_buf_index;
+    t_gl_id state_buf_gl_id;
+    t_gl_id spawn_buf_gl_id;
+    t_gl_id target_buf_gl_id;
+    t_gl_id solid_cell_buf_gl_id;
+    t_gl_id vert_array_gl_id;
+
+    // When rendering with culling, the projectiles in view are compacted into here and drawn from it.
+    t_gl_id culled_proj_buf_gl_id;
+    t_gl_id culled_draw_cmd_buf_gl_id;
+
+    t_gl_id hit_list_buf_gl_ids[GPU_PROJECTILE_HIT_READBACK_CNT];
+    GLsync hit_list_fences[GPU_PROJECTILE_HIT_READBACK_CNT];
+    int hit_list_gens[GPU_PROJECTILE_HIT_READBACK_CNT]; // The generation each hit list was written in.
+    int hit_list_begin;
+    int hit_list_cnt; // How many are in flight.
+    int gen; // Bumped on each clear, so that hits from steps before it are dropped rather than reported.
+
+    t_gl_id sim_prog_gl_id;
+    int sim_stage_uniform_loc;
+    int sim_spawn_cnt_uniform_loc;
+    int sim_target_cnt_uniform_loc;
+    int sim_proj_limit_uniform_loc;
+    int sim_grid_width_uniform_loc;
+    int sim_grid_height_uniform_loc;
+    int sim_collider_uniform_loc;
+    t_gl_id render_prog_gl_id;
+    int render_tex_coords_uniform_loc;
+    int render_size_and_origin_uniform_loc;
+    int render_blend_uniform_loc;
+    t_gl_id cull_prog_gl_id;
+    int cull_view_rect_uniform_loc;
+
+    int proj_limit;
+    s_vec_2d collider_size; // Colliders are centred on projectile positions and rotated with them.
+
+    s_gpu_projectile spawns[GPU_PROJECTILE_SPAWN_LIMIT];
+    int spawn_cnt;
+
+    // The hits read back by the last step.
+    s_gpu_projectile_hit hits[GPU_PROJECTILE_HIT_LIMIT * GPU_PROJECTILE_HIT_READBACK_CNT];
+    int hit_cnt;
+} s_gpu_projectile_system;
+
+bool InitPersRenderData(s_pers_render_data* const render_data, const int batch_slot_cnt, const char* const shader_prog_cache_dir);
 void CleanPersRenderData(s_pers_render_data* const render_data);
 
-s_render_batch_shader_prog LoadRenderBatchShaderProg();
-s_render_batch_gl_ids GenRenderBatch();
+bool LoadRenderBatchShaderProgs(s_render_batch_shader_prog* const progs, const int tex_slot_cnt, const char* const cache_dir);
+s_render_batch_gl_ids GenRenderBatch(const int ring_size);
 
 // NOTE: Might be better if this takes in a pointer to allocated memory instead of doing the allocation/push itself.
 bool LoadTexturesFromFiles(s_textures* const textures, s_mem_arena* const mem_arena, const int tex_cnt, const t_texture_index_to_file_path tex_index_to_fp);
@@ -202,32 +698,89 @@ void UnloadTextures(s_textures* const textures);
 bool LoadFontsFromFiles(s_fonts* const fonts, s_mem_arena* const mem_arena, const int font_cnt, const t_font_index_to_load_info font_index_to_load_info, s_mem_arena* const temp_mem_arena);
 void UnloadFonts(s_fonts* const fonts);
 
-bool LoadShaderProgsFromFiles(s_shader_progs* const progs, s_mem_arena* const mem_arena, const int prog_cnt, const t_shader_prog_index_to_file_paths prog_index_to_fps, s_mem_arena* const temp_mem_arena);
+bool LoadShaderProgsFromFiles(s_shader_progs* const progs, s_mem_arena* const mem_arena, const int prog_cnt, const t_shader_prog_index_to_file_paths prog_index_to_fps, const char* const cache_dir, s_mem_arena* const temp_mem_arena);
 void UnloadShaderProgs(s_shader_progs* const progs);
+s_shader_prog_uniform_handle GetShaderProgUniformHandle(const s_shader_progs* const progs, const int prog_index, const char* const name);
 
 void BeginRendering(s_rendering_state* const state);
+void SetViewMatrix(const s_rendering_context* const context, const t_matrix_4x4* const mat);
 
 void RenderClear(const s_color col);
 
 void Render(const s_rendering_context* const context, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend);
+void RenderFlashed(const s_rendering_context* const context, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend, const s_color flash);
 void RenderTexture(const s_rendering_context* const context, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend);
+void RenderTextureFlashed(const s_rendering_context* const context, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend, const s_color flash);
+void RenderTextureBulk(const s_rendering_context* const context, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d origin, const s_render_bulk_input* const input);
 bool RenderStr(const s_rendering_context* const context, const char* const str, const int font_index, const s_fonts* const fonts, const s_vec_2d pos, const e_str_hor_align hor_align, const e_str_ver_align ver_align, const s_color blend, s_mem_arena* const temp_mem_arena);
 void RenderRect(const s_rendering_context* const context, const s_rect rect, const s_color blend);
 void RenderRectOutline(const s_rendering_context* const context, const s_rect rect, const s_color blend, const float thickness);
 void RenderLine(const s_rendering_context* const context, const s_vec_2d a, const s_vec_2d b, const s_color blend, const float width);
 void RenderPolyOutline(const s_rendering_context* const context, const s_poly poly, const s_color blend, const float width);
+void RenderPolyline(const s_rendering_context* const context, const s_vec_2d* const pts, const int pt_cnt, const bool closed, const s_color blend, const float width);
 void RenderBarHor(const s_rendering_context* const context, const s_rect rect, const float perc, const s_color_rgb col_front, const s_color_rgb col_back);
 
-void SetSurface(const s_rendering_context* const rendering_context, const int surf_index);
+bool InitRenderCmdList(s_render_cmd_list* const list, const int cmd_limit);
+void CleanRenderCmdList(s_render_cmd_list* const list);
+void ClearRenderCmdList(s_render_cmd_list* const list);
+bool AddToRenderCmdList(s_render_cmd_list* const list, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend, const s_color flash);
+bool AddTextureToRenderCmdList(s_render_cmd_list* const list, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend, const s_color flash);
+bool RecordRenderCmdListsInParallel(const s_rendering_context* const context, s_render_cmd_list* const lists, const int list_cnt, const t_render_cmd_list_record_func func, void* const user_data);
+void SubmitRenderCmdLists(const s_rendering_context* const context, const s_render_cmd_list* const lists, const int list_cnt);
+
+bool InitStaticRenderBatch(s_static_render_batch* const batch, const s_rendering_context* const context, const int slot_limit);
+void CleanStaticRenderBatch(s_static_render_batch* const batch);
+void ClearStaticRenderBatch(s_static_render_batch* const batch);
+int AddToStaticRenderBatch(s_static_render_batch* const batch, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend);
+int AddTextureToStaticRenderBatch(s_static_render_batch* const batch, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend);
+bool UpdateStaticRenderBatchSlot(s_static_render_batch* const batch, const int slot_index, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend);
+void RenderStaticBatch(const s_rendering_context* const context, s_static_render_batch* const batch);
+void RenderStaticBatchRange(const s_rendering_context* const context, s_static_render_batch* const batch, const int slot_begin, const int slot_cnt);
+
+bool SetSurface(const s_rendering_context* const rendering_context, const int surf_index);
 void UnsetSurface(const s_rendering_context* const rendering_context);
 void SetSurfaceShaderProg(const s_rendering_context* const rendering_context, const t_gl_id gl_id);
-void SetSurfaceShaderProgUniform(const s_rendering_context* const rendering_context, const char* const name, const s_shader_prog_uniform_value val);
+void SetSurfaceShaderProgUniform(const s_rendering_context* const rendering_context, const s_shader_prog_uniform_handle handle, const s_shader_prog_uniform_value val);
 void RenderSurface(const s_rendering_context* const rendering_context, const int surf_index);
+void CopySurface(const s_rendering_context* const context, const int surf_index);
+void StretchSurface(const s_rendering_context* const context, const int surf_index);
 
 void Flush(const s_rendering_context* const context);
 
-bool InitRenderSurfaces(s_render_surfaces* const surfs, const s_vec_2d_i size);
-bool ResizeRenderSurfaces(s_render_surfaces* const surfs, const s_vec_2d_i size);
+void BeginRenderQueue(const s_rendering_context* const context, const bool stable);
+void EndRenderQueue(const s_rendering_context* const context);
+void SetRenderLayer(const s_rendering_context* const context, const int layer);
+void SetRenderDepth(const s_rendering_context* const context, const int depth);
+
+void ReserveRenderGraphSurface(s_render_graph* const graph, const int surf_index);
+int AddRenderGraphTarget(s_render_graph* const graph, const e_render_target_size size, const e_render_target_format format);
+void AddRenderGraphPass(s_render_graph* const graph, const t_render_pass_func func, void* const user_data, const int output_target, const int* const input_targets, const int input_cnt);
+bool ExecuteRenderGraph(const s_rendering_context* const context, const s_render_graph* const graph);
+
+void InitDynamicRes(s_dynamic_res* const dynamic_res, const float target_gpu_time);
+void CleanDynamicRes(s_dynamic_res* const dynamic_res);
+bool BeginDynamicResPass(const s_rendering_context* const context, s_dynamic_res* const dynamic_res, const int surf_index);
+void EndDynamicResPass(const s_rendering_context* const context, s_dynamic_res* const dynamic_res);
+
+bool BeginVirtualResPass(const s_rendering_context* const context, const int surf_index, const int scale);
+void EndVirtualResPass(const s_rendering_context* const context);
+
+bool InitParticleSystem(s_particle_system* const sys, const int particle_limit, const char* const shader_prog_cache_dir);
+void CleanParticleSystem(s_particle_system* const sys);
+void EmitParticles(s_particle_system* const sys, const s_particle_emit_info* const info);
+void ClearParticles(s_particle_system* const sys);
+void UpdateParticles(s_particle_system* const sys);
+void RenderParticles(const s_rendering_context* const context, s_particle_system* const sys);
+
+bool InitGPUProjectileSystem(s_gpu_projectile_system* const sys, const int proj_limit, const s_vec_2d collider_size, const char* const shader_prog_cache_dir);
+void CleanGPUProjectileSystem(s_gpu_projectile_system* const sys);
+bool SpawnGPUProjectile(s_gpu_projectile_system* const sys, const s_vec_2d pos, const s_vec_2d vel, const float rot, const int dmg, const uint32_t hit_mask);
+void ClearGPUProjectiles(s_gpu_projectile_system* const sys);
+void StepGPUProjectiles(s_gpu_projectile_system* const sys, s_gl_state_cache* const gl_state_cache, const s_gpu_projectile_step_input* const input);
+void RenderGPUProjectiles(const s_rendering_context* const context, const s_gpu_projectile_system* const sys, const s_rect* const cull_view_rect, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d origin, const s_color blend);
+
+void InitRenderSurfaces(s_render_surfaces* const surfs);
+void CleanRenderSurfaces(s_render_surfaces* const surfs);
 
 s_rect_edges CalcTextureCoords(const s_rect_i src_rect, const s_vec_2d_i tex_size);
 
@@ -0,0 +1,52 @@
+#ifndef GCE_THREADING_H
+#define GCE_THREADING_H
+
+#include <stdbool.h>
+
+//
+// Threads, mutexes and condition variables over the platform API, as C11 threads aren't available with MSVC. This is Win32 on Windows and pthreads elsewhere.
+//
+
+#ifdef _WIN32
+typedef void* t_platform_thread; // A HANDLE.
+typedef void* t_platform_mutex; // An SRWLOCK, which is pointer-sized.
+typedef void* t_platform_cond; // A CONDITION_VARIABLE, which is pointer-sized.
+#else
+#include <pthread.h>
+typedef pthread_t t_platform_thread;
+typedef pthread_mutex_t t_platform_mutex;
+typedef pthread_cond_t t_platform_cond;
+#endif
+
+typedef int (*t_thread_func)(void* const arg);
+
+typedef struct {
+    t_platform_thread handle;
+    t_thread_func func;
+    void* func_arg;
+} s_thread;
+
+typedef struct {
+    t_platform_mutex handle;
+} s_mutex;
+
+typedef struct {
+    t_platform_cond handle;
+} s_cond;
+
+// The thread has to stay where it is until joined, as it's what gets handed to the new thread.
+bool StartThread(s_thread* const thread, const t_thread_func func, void* const func_arg);
+void JoinThread(s_thread* const thread);
+
+bool InitMutex(s_mutex* const mutex);
+void CleanMutex(s_mutex* const mutex);
+void LockMutex(s_mutex* const mutex);
+void UnlockMutex(s_mutex* const mutex);
+
+bool InitCond(s_cond* const cond);
+void CleanCond(s_cond* const cond);
+void WaitCond(s_cond* const cond, s_mutex* const mutex);
+void SignalCond(s_cond* const cond);
+void BroadcastCond(s_cond* const cond);
+
+#endif
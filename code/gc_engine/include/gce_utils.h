@@ -84,5 +84,6 @@ inline bool IsBitActive(const int bit_index, const t_byte* const bytes, const in
 }
 
 t_byte* PushEntireFileContents(const char* const file_path, s_mem_arena* const mem_arena, const bool incl_term_byte);
+bool CreateDirIfMissing(const char* const path);
 
 #endif
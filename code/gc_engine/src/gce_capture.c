@@ -0,0 +1,598 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gce_capture.h>
+
+#define FRAME_CAPTURE_FENCE_TIMEOUT 1000000000 // In nanoseconds.
+#define PNG_STORED_BLOCK_SIZE_LIMIT 65535
+
+//
+// PNG
+//
+// Frames are written uncompressed (using stored deflate blocks), as compressing them on the writer thread couldn't keep up with the frame rate.
+//
+static uint32_t g_png_crc_table[256];
+
+static void InitPNGCRCTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+
+        for (int j = 0; j < 8; j++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+
+        g_png_crc_table[i] = c;
+    }
+}
+
+static uint32_t UpdatePNGCRC(uint32_t crc, const t_byte* const bytes, const size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = g_png_crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+static void WriteU32BE(t_byte* const bytes, const uint32_t val) {
+    bytes[0] = (val >> 24) & 0xFF;
+    bytes[1] = (val >> 16) & 0xFF;
+    bytes[2] = (val >> 8) & 0xFF;
+    bytes[3] = val & 0xFF;
+}
+
+// The chunk data is written in pieces, so the length and CRC have to be worked out by the caller.
+static bool WritePNGChunkHeader(FILE* const fs, const char* const type, const uint32_t data_len, uint32_t* const crc) {
+    t_byte header[8];
+    WriteU32BE(header, data_len);
+    memcpy(header + 4, type, 4);
+
+    *crc = UpdatePNGCRC(0xFFFFFFFFu, header + 4, 4);
+
+    return fwrite(header, 1, sizeof(header), fs) == sizeof(header);
+}
+
+static bool WritePNGChunkData(FILE* const fs, const t_byte* const data, const size_t len, uint32_t* const crc) {
+    *crc = UpdatePNGCRC(*crc, data, len);
+    return fwrite(data, 1, len, fs) == len;
+}
+
+static bool WritePNGChunkFooter(FILE* const fs, const uint32_t crc) {
+    t_byte footer[4];
+    WriteU32BE(footer, crc ^ 0xFFFFFFFFu);
+    return fwrite(footer, 1, sizeof(footer), fs) == sizeof(footer);
+}
+
+static bool WritePNG(FILE* const fs, const s_captured_frame* const frame) {
+    static const t_byte sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    if (fwrite(sig, 1, sizeof(sig), fs) != sizeof(sig)) {
+        return false;
+    }
+
+    uint32_t crc;
+
+    // Header, for 8-bit RGBA.
+    {
+        t_byte data[13] = {0};
+        WriteU32BE(data, frame->size.x);
+        WriteU32BE(data + 4, frame->size.y);
+        data[8] = 8;
+        data[9] = 6;
+
+        if (!WritePNGChunkHeader(fs, "IHDR", sizeof(data), &crc) || !WritePNGChunkData(fs, data, sizeof(data), &crc) || !WritePNGChunkFooter(fs, crc)) {
+            return false;
+        }
+    }
+
+    // Image data, a zlib stream of stored blocks over the rows, each of which is preceded by a filter type byte of 0.
+    {
+        const size_t row_size = (size_t)frame->size.x * 4;
+        const size_t raw_size = (row_size + 1) * frame->size.y;
+        const size_t block_cnt = (raw_size + PNG_STORED_BLOCK_SIZE_LIMIT - 1) / PNG_STORED_BLOCK_SIZE_LIMIT;
+        const size_t data_len = 2 + (block_cnt * 5) + raw_size + 4;
+
+        if (!WritePNGChunkHeader(fs, "IDAT", (uint32_t)data_len, &crc)) {
+            return false;
+        }
+
+        const t_byte zlib_header[2] = {0x78, 0x01};
+
+        if (!WritePNGChunkData(fs, zlib_header, sizeof(zlib_header), &crc)) {
+            return false;
+        }
+
+        uint32_t adler_a = 1;
+        uint32_t adler_b = 0;
+
+        size_t block_left = 0;
+        size_t raw_left = raw_size;
+
+        // The rows are read back bottom first, so they're gone through in reverse.
+        for (int y = frame->size.y - 1; y >= 0; y--) {
+            const t_byte filter_type = 0;
+            const t_byte* const row = frame->pxs + (row_size * y);
+
+            for (size_t i = 0; i < row_size + 1; ) {
+                if (block_left == 0) {
+                    block_left = MIN(raw_left, PNG_STORED_BLOCK_SIZE_LIMIT);
+
+                    const t_byte block_header[5] = {
+                        raw_left == block_left ? 1 : 0,
+                        block_left & 0xFF,
+                        (block_left >> 8) & 0xFF,
+                        ~block_left & 0xFF,
+                        (~block_left >> 8) & 0xFF
+                    };
+
+                    if (!WritePNGChunkData(fs, block_header, sizeof(block_header), &crc)) {
+                        return false;
+                    }
+                }
+
+                const t_byte* src;
+                size_t len;
+
+                if (i == 0) {
+                    src = &filter_type;
+                    len = 1;
+                } else {
+                    src = row + (i - 1);
+                    len = MIN(row_size + 1 - i, block_left);
+                }
+
+                if (!WritePNGChunkData(fs, src, len, &crc)) {
+                    return false;
+                }
+
+                for (size_t j = 0; j < len; j++) {
+                    adler_a = (adler_a + src[j]) % 65521;
+                    adler_b = (adler_b + adler_a) % 65521;
+                }
+
+                i += len;
+                block_left -= len;
+                raw_left -= len;
+            }
+        }
+
+        t_byte adler[4];
+        WriteU32BE(adler, (adler_b << 16) | adler_a);
+
+        if (!WritePNGChunkData(fs, adler, sizeof(adler), &crc) || !WritePNGChunkFooter(fs, crc)) {
+            return false;
+        }
+    }
+
+    return WritePNGChunkHeader(fs, "IEND", 0, &crc) && WritePNGChunkFooter(fs, crc);
+}
+
+//
+// Y4M
+//
+static t_byte ToY(const int r, const int g, const int b) {
+    return (t_byte)((((66 * r) + (129 * g) + (25 * b) + 128) >> 8) + 16);
+}
+
+static t_byte ToU(const int r, const int g, const int b) {
+    return (t_byte)((((-38 * r) - (74 * g) + (112 * b) + 128) >> 8) + 128);
+}
+
+static t_byte ToV(const int r, const int g, const int b) {
+    return (t_byte)((((112 * r) - (94 * g) - (18 * b) + 128) >> 8) + 128);
+}
+
+// Converts to BT.601 limited range, with the chroma of each 2x2 block taken from its average colour.
+static void ConvertToY4MPlanes(const s_captured_frame* const frame, t_byte* const planes) {
+    const int w = frame->size.x;
+    const int h = frame->size.y;
+    const int chroma_w = (w + 1) / 2;
+    const int chroma_h = (h + 1) / 2;
+
+    t_byte* const y_plane = planes;
+    t_byte* const u_plane = y_plane + (w * h);
+    t_byte* const v_plane = u_plane + (chroma_w * chroma_h);
+
+    for (int y = 0; y < h; y++) {
+        const t_byte* const row = frame->pxs + ((size_t)(h - 1 - y) * w * 4);
+
+        for (int x = 0; x < w; x++) {
+            y_plane[(y * w) + x] = ToY(row[x * 4], row[(x * 4) + 1], row[(x * 4) + 2]);
+        }
+    }
+
+    for (int cy = 0; cy < chroma_h; cy++) {
+        for (int cx = 0; cx < chroma_w; cx++) {
+            int r = 0, g = 0, b = 0, cnt = 0;
+
+            for (int y = cy * 2; y < MIN((cy * 2) + 2, h); y++) {
+                for (int x = cx * 2; x < MIN((cx * 2) + 2, w); x++) {
+                    const t_byte* const px = frame->pxs + (((size_t)(h - 1 - y) * w) + x) * 4;
+                    r += px[0];
+                    g += px[1];
+                    b += px[2];
+                    cnt++;
+                }
+            }
+
+            r /= cnt;
+            g /= cnt;
+            b /= cnt;
+
+            u_plane[(cy * chroma_w) + cx] = ToU(r, g, b);
+            v_plane[(cy * chroma_w) + cx] = ToV(r, g, b);
+        }
+    }
+}
+
+//
+// Writer Thread
+//
+static bool WriteCapturedFrame(s_frame_capture* const capture, const s_captured_frame* const frame, t_byte** const scratch, size_t* const scratch_size) {
+    switch (capture->format) {
+        case ek_frame_capture_format_raw: {
+            const size_t row_size = (size_t)frame->size.x * 4;
+
+            for (int i = 0; i <= frame->repeat_cnt; i++) {
+                for (int y = frame->size.y - 1; y >= 0; y--) {
+                    if (fwrite(frame->pxs + (row_size * y), 1, row_size, capture->fs) != row_size) {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        case ek_frame_capture_format_png: {
+            // Each repeat gets a file of its own, so that the sequence has no gaps.
+            for (int i = 0; i <= frame->repeat_cnt; i++) {
+                char file_path[FRAME_CAPTURE_FILE_PATH_SIZE + 32];
+                snprintf(file_path, sizeof(file_path), "%s/frame_%06d.png", capture->out_path, frame->index + i);
+
+                FILE* const fs = fopen(file_path, "wb");
+
+                if (!fs) {
+                    fprintf(stderr, "Failed to open \"%s\" for writing a captured frame!\n", file_path);
+                    return false;
+                }
+
+                const bool success = WritePNG(fs, frame);
+
+                if (fclose(fs) != 0 || !success) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        case ek_frame_capture_format_y4m: {
+            const size_t planes_size = ((size_t)frame->size.x * frame->size.y) + ((size_t)((frame->size.x + 1) / 2) * ((frame->size.y + 1) / 2) * 2);
+
+            if (*scratch_size < planes_size) {
+                t_byte* const scratch_new = realloc(*scratch, planes_size);
+
+                if (!scratch_new) {
+                    fprintf(stderr, "Failed to allocate frame capture conversion buffer!\n");
+                    return false;
+                }
+
+                *scratch = scratch_new;
+                *scratch_size = planes_size;
+            }
+
+            ConvertToY4MPlanes(frame, *scratch);
+
+            for (int i = 0; i <= frame->repeat_cnt; i++) {
+                if (fputs("FRAME\n", capture->fs) < 0 || fwrite(*scratch, 1, planes_size, capture->fs) != planes_size) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int RunFrameCaptureWriter(void* const arg) {
+    s_frame_capture* const capture = arg;
+
+    t_byte* scratch = NULL;
+    size_t scratch_size = 0;
+
+    while (true) {
+        LockMutex(&capture->mtx);
+
+        while (capture->queue_cnt == 0 && !capture->stopping) {
+            WaitCond(&capture->cnd, &capture->mtx);
+        }
+
+        if (capture->queue_cnt == 0) {
+            UnlockMutex(&capture->mtx);
+            break;
+        }
+
+        const s_captured_frame* const frame = &capture->queue[capture->queue_begin];
+        const bool failed = capture->write_failed;
+
+        UnlockMutex(&capture->mtx);
+
+        // Once a write has failed, frames are just drained so that the main thread isn't held up.
+        const bool written = failed || WriteCapturedFrame(capture, frame, &scratch, &scratch_size);
+
+        LockMutex(&capture->mtx);
+
+        if (!written) {
+            capture->write_failed = true;
+        }
+
+        capture->queue_begin = (capture->queue_begin + 1) % FRAME_CAPTURE_QUEUE_LEN;
+        capture->queue_cnt--;
+
+        UnlockMutex(&capture->mtx);
+    }
+
+    free(scratch);
+
+    return 0;
+}
+
+//
+// Capture
+//
+bool BeginFrameCapture(s_frame_capture* const capture, const char* const out_path, const e_frame_capture_format format, const int fps) {
+    assert(capture);
+    assert(IsZero(capture, sizeof(*capture)));
+    assert(out_path);
+    assert(fps > 0);
+
+    if (strlen(out_path) >= sizeof(capture->out_path)) {
+        fprintf(stderr, "Frame capture output path \"%s\" is too long!\n", out_path);
+        return false;
+    }
+
+    strcpy(capture->out_path, out_path);
+    capture->format = format;
+    capture->fps = fps;
+
+    if (format == ek_frame_capture_format_png) {
+        InitPNGCRCTable();
+
+        if (!CreateDirIfMissing(out_path)) {
+            return false;
+        }
+    } else {
+        capture->fs = fopen(out_path, "wb");
+
+        if (!capture->fs) {
+            fprintf(stderr, "Failed to open \"%s\" for writing captured frames!\n", out_path);
+            return false;
+        }
+    }
+
+    if (!InitMutex(&capture->mtx)) {
+        fprintf(stderr, "Failed to initialise the frame capture mutex!\n");
+
+        if (capture->fs) {
+            fclose(capture->fs);
+        }
+
+        return false;
+    }
+
+    if (!InitCond(&capture->cnd)) {
+        fprintf(stderr, "Failed to initialise the frame capture condition variable!\n");
+        CleanMutex(&capture->mtx);
+
+        if (capture->fs) {
+            fclose(capture->fs);
+        }
+
+        return false;
+    }
+
+    if (!StartThread(&capture->writer_thread, RunFrameCaptureWriter, capture)) {
+        fprintf(stderr, "Failed to create the frame capture writer thread!\n");
+        CleanCond(&capture->cnd);
+        CleanMutex(&capture->mtx);
+
+        if (capture->fs) {
+            fclose(capture->fs);
+        }
+
+        return false;
+    }
+
+    glGenBuffers(FRAME_CAPTURE_PBO_CNT, capture->pbo_gl_ids);
+
+    return true;
+}
+
+// Copies the pixels of the oldest in-flight buffer over to the writer queue, or drops them if the queue is full.
+static void RetireFrameCapturePBO(s_frame_capture* const capture) {
+    assert(capture->pbo_cnt > 0);
+
+    const int pbo_index = capture->pbo_begin;
+    const s_vec_2d_i size = capture->pbo_frame_sizes[pbo_index];
+    const size_t pxs_size = (size_t)size.x * size.y * 4;
+
+    glDeleteSync(capture->pbo_fences[pbo_index]);
+    capture->pbo_fences[pbo_index] = NULL;
+
+    capture->pbo_begin = (capture->pbo_begin + 1) % FRAME_CAPTURE_PBO_CNT;
+    capture->pbo_cnt--;
+
+    LockMutex(&capture->mtx);
+    const bool queue_full = capture->queue_cnt == FRAME_CAPTURE_QUEUE_LEN;
+    const int queue_index = (capture->queue_begin + capture->queue_cnt) % FRAME_CAPTURE_QUEUE_LEN;
+    UnlockMutex(&capture->mtx);
+
+    const int repeat_cnt = capture->pbo_frame_repeat_cnts[pbo_index];
+
+    if (queue_full) {
+        capture->dropped_frame_cnt += 1 + repeat_cnt;
+        return;
+    }
+
+    // The queue slot isn't touched by the writer thread until it's been added to the queue, so it can be filled without holding the lock.
+    s_captured_frame* const frame = &capture->queue[queue_index];
+
+    if (!frame->pxs || (size_t)frame->size.x * frame->size.y * 4 < pxs_size) {
+        t_byte* const pxs_new = realloc(frame->pxs, pxs_size);
+
+        if (!pxs_new) {
+            fprintf(stderr, "Failed to allocate captured frame pixels!\n");
+            capture->dropped_frame_cnt += 1 + repeat_cnt;
+            return;
+        }
+
+        frame->pxs = pxs_new;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pbo_gl_ids[pbo_index]);
+
+    const void* const mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pxs_size, GL_MAP_READ_BIT);
+
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        capture->dropped_frame_cnt += 1 + repeat_cnt;
+        return;
+    }
+
+    memcpy(frame->pxs, mapped, pxs_size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    frame->size = size;
+    frame->index = capture->pbo_frame_indices[pbo_index];
+    frame->repeat_cnt = repeat_cnt;
+
+    LockMutex(&capture->mtx);
+    capture->queue_cnt++;
+    SignalCond(&capture->cnd);
+    UnlockMutex(&capture->mtx);
+}
+
+// Has the newest frame still in flight stand in for the one just passed, which otherwise counts as dropped. Frames are only ever retired right before a new one is captured, so the newest one captured stays in flight until then.
+static void RepeatNewestCapturedFrame(s_frame_capture* const capture) {
+    if (capture->pbo_cnt == 0) {
+        capture->dropped_frame_cnt++;
+        return;
+    }
+
+    capture->pbo_frame_repeat_cnts[(capture->pbo_begin + capture->pbo_cnt - 1) % FRAME_CAPTURE_PBO_CNT]++;
+}
+
+// Has the back buffer read into the next pixel buffer object, and hands over any earlier readbacks which have finished. This should be called once rendering is done for the frame, before the buffers are swapped.
+void CaptureFrame(s_frame_capture* const capture, const s_vec_2d_i display_size) {
+    assert(capture);
+    assert(display_size.x > 0 && display_size.y > 0);
+
+    while (capture->pbo_cnt > 0) {
+        const GLenum wait_res = glClientWaitSync(capture->pbo_fences[capture->pbo_begin], 0, 0);
+
+        if (wait_res != GL_ALREADY_SIGNALED && wait_res != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        RetireFrameCapturePBO(capture);
+    }
+
+    const int frame_index = capture->frame_cnt;
+    capture->frame_cnt++;
+
+    if (capture->format != ek_frame_capture_format_png) {
+        if (capture->stream_size.x == 0) {
+            capture->stream_size = display_size;
+
+            if (capture->format == ek_frame_capture_format_y4m) {
+                fprintf(capture->fs, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", display_size.x, display_size.y, capture->fps);
+            }
+        } else if (!Vec2DIsEqual(capture->stream_size, display_size)) {
+            RepeatNewestCapturedFrame(capture);
+            return;
+        }
+    }
+
+    if (capture->pbo_cnt == FRAME_CAPTURE_PBO_CNT) {
+        RepeatNewestCapturedFrame(capture);
+        return;
+    }
+
+    const int pbo_index = (capture->pbo_begin + capture->pbo_cnt) % FRAME_CAPTURE_PBO_CNT;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pbo_gl_ids[pbo_index]);
+
+    if (!Vec2DIsEqual(capture->pbo_sizes[pbo_index], display_size)) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)display_size.x * display_size.y * 4, NULL, GL_STREAM_READ);
+        capture->pbo_sizes[pbo_index] = display_size;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadPixels(0, 0, display_size.x, display_size.y, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Fences are polled without flushing, as the buffer swap that follows does so anyway.
+    capture->pbo_fences[pbo_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    capture->pbo_frame_sizes[pbo_index] = display_size;
+    capture->pbo_frame_indices[pbo_index] = frame_index;
+    capture->pbo_frame_repeat_cnts[pbo_index] = 0;
+    capture->pbo_cnt++;
+}
+
+// Writes the last frame captured again in place of one which wasn't rendered, so that the output keeps to a fixed rate.
+void RepeatCapturedFrame(s_frame_capture* const capture) {
+    assert(capture);
+
+    capture->frame_cnt++;
+    RepeatNewestCapturedFrame(capture);
+}
+
+// Waits on the readbacks still in flight and for the writer thread to get through everything, then cleans up. Returns false if anything failed to be written.
+bool EndFrameCapture(s_frame_capture* const capture) {
+    assert(capture);
+
+    while (capture->pbo_cnt > 0) {
+        GLenum wait_res;
+
+        do {
+            wait_res = glClientWaitSync(capture->pbo_fences[capture->pbo_begin], GL_SYNC_FLUSH_COMMANDS_BIT, FRAME_CAPTURE_FENCE_TIMEOUT);
+        } while (wait_res == GL_TIMEOUT_EXPIRED);
+
+        assert(wait_res != GL_WAIT_FAILED);
+
+        RetireFrameCapturePBO(capture);
+    }
+
+    LockMutex(&capture->mtx);
+    capture->stopping = true;
+    SignalCond(&capture->cnd);
+    UnlockMutex(&capture->mtx);
+
+    JoinThread(&capture->writer_thread);
+
+    bool success = !capture->write_failed;
+
+    if (capture->fs && fclose(capture->fs) != 0) {
+        success = false;
+    }
+
+    if (!success) {
+        fprintf(stderr, "Failed to write captured frames to \"%s\"!\n", capture->out_path);
+    }
+
+    glDeleteBuffers(FRAME_CAPTURE_PBO_CNT, capture->pbo_gl_ids);
+
+    for (int i = 0; i < FRAME_CAPTURE_QUEUE_LEN; i++) {
+        free(capture->queue[i].pxs);
+    }
+
+    CleanCond(&capture->cnd);
+    CleanMutex(&capture->mtx);
+
+    ZeroOut(capture, sizeof(*capture));
+
+    return success;
+}
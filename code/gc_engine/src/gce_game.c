@@ -20,6 +20,9 @@ typedef struct {
     s_mem_arena* temp_mem_arena;
     GLFWwindow* glfw_window;
     s_pers_render_data* pers_render_data;
+    s_frame_capture* frame_capture;
+    void* user_mem; // Only set once the game has been initialised, as the clean function isn't given partially initialised memory.
+    void (*clean_func)(void* const user_mem);
 } s_game_cleanup_info;
 
 static void AssertGameInfoValidity(const s_game_info* const info) {
@@ -29,12 +32,23 @@ static void AssertGameInfoValidity(const s_game_info* const info) {
     assert(info->window_title);
     assert(info->window_init_size.x > 0 && info->window_init_size.y > 0);
 
+    assert(info->render_batch_slot_cnt >= 0 && info->render_batch_slot_cnt <= RENDER_BATCH_SLOT_CNT_LIMIT);
+
     assert(info->init_func);
     assert(info->tick_func);
     assert(info->render_func);
 }
 
 static void CleanGame(const s_game_cleanup_info* const cleanup_info) {
+    // These need the GL context, so have to come before the window is destroyed.
+    if (cleanup_info->user_mem && cleanup_info->clean_func) {
+        cleanup_info->clean_func(cleanup_info->user_mem);
+    }
+
+    if (cleanup_info->frame_capture) {
+        EndFrameCapture(cleanup_info->frame_capture);
+    }
+
     if (cleanup_info->glfw_window) {
         glfwDestroyWindow(cleanup_info->glfw_window);
     }
@@ -57,6 +71,14 @@ static s_window_state GetWindowState(GLFWwindow* const glfw_window) {
     return state;
 }
 
+static bool AreInputStatesEqual(const s_input_state* const a, const s_input_state* const b) {
+    return a->keys_down == b->keys_down
+        && a->mouse_buttons_down == b->mouse_buttons_down
+        && a->mouse_pos.x == b->mouse_pos.x
+        && a->mouse_pos.y == b->mouse_pos.y
+        && a->mouse_scroll == b->mouse_scroll;
+}
+
 static void GLFWKeyCallback(GLFWwindow* const window, const int key, const int scancode, const int action, const int mods) {
     s_input_state* const input_state = glfwGetWindowUserPointer(window);
 
@@ -260,7 +282,16 @@ bool RunGame(const s_game_info* const info) {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     s_pers_render_data pers_render_data = {0};
-    InitPersRenderData(&pers_render_data, info->window_init_size);
+
+    {
+        const int batch_slot_cnt = info->render_batch_slot_cnt > 0 ? info->render_batch_slot_cnt : RENDER_BATCH_SLOT_CNT_DEFAULT;
+
+        if (!InitPersRenderData(&pers_render_data, batch_slot_cnt, info->shader_prog_cache_dir)) {
+            fprintf(stderr, "Failed to initialise persistent render data!\n");
+            CleanGame(&cleanup_info);
+            return false;
+        }
+    }
 
     s_rendering_state* const rendering_state = MEM_ARENA_PUSH_TYPE(&perm_mem_arena, s_rendering_state);
 
@@ -288,6 +319,21 @@ bool RunGame(const s_game_info* const info) {
             CleanGame(&cleanup_info);
             return false;
         }
+
+        cleanup_info.user_mem = user_mem;
+        cleanup_info.clean_func = info->clean_func;
+    }
+
+    s_frame_capture frame_capture = {0};
+
+    if (info->capture_out_path) {
+        if (!BeginFrameCapture(&frame_capture, info->capture_out_path, info->capture_format, TARG_TICKS_PER_SEC)) {
+            fprintf(stderr, "Failed to begin frame capture!\n");
+            CleanGame(&cleanup_info);
+            return false;
+        }
+
+        cleanup_info.frame_capture = &frame_capture;
     }
 
     glfwShowWindow(glfw_window);
@@ -300,6 +346,11 @@ bool RunGame(const s_game_info* const info) {
 
     s_input_state input_state_last = input_state;
 
+    // What the last rendered frame was based on, for working out whether a new one is needed.
+    bool visuals_dirty = true;
+    s_input_state input_state_rendered = {0};
+    s_vec_2d_i display_size_rendered = {0};
+
     printf("Entering the main loop...\n");
 
     while (!glfwWindowShouldClose(glfw_window)) {
@@ -309,7 +360,11 @@ bool RunGame(const s_game_info* const info) {
         frame_dur_accum += frame_time - frame_time_last;
         frame_time_last = frame_time;
 
+        bool rendered = false;
+
         if (frame_dur_accum >= TARG_TICK_INTERVAL) {
+            int tick_cnt = 0;
+
             while (frame_dur_accum >= TARG_TICK_INTERVAL) {
                 const s_game_tick_func_data func_data = {
                     .user_mem = user_mem,
@@ -317,7 +372,9 @@ bool RunGame(const s_game_info* const info) {
                     .temp_mem_arena = &temp_mem_arena,
                     .window_state = window_state_at_frame_begin,
                     .input_state = &input_state,
-                    .input_state_last = &input_state_last
+                    .input_state_last = &input_state_last,
+                    .visuals_dirty = &visuals_dirty,
+                    .gl_state_cache = &rendering_state->gl_state_cache
                 };
 
                 if (!info->tick_func(&func_data)) {
@@ -326,52 +383,85 @@ bool RunGame(const s_game_info* const info) {
                 }
 
                 frame_dur_accum -= TARG_TICK_INTERVAL;
+                tick_cnt++;
             }
 
             input_state_last = input_state;
             input_state.mouse_scroll = ek_mouse_scroll_state_none;
 
-            BeginRendering(rendering_state);
+            // There's nothing to see of a minimised window, so it never gets rendered.
+            const bool iconified = glfwGetWindowAttrib(glfw_window, GLFW_ICONIFIED) || Vec2DIsEqual(window_state_at_frame_begin.size, VEC_2D_I_ZERO);
 
-            {
-                const s_game_render_func_data func_data = {
-                    .user_mem = user_mem,
-                    .perm_mem_arena = &perm_mem_arena,
-                    .temp_mem_arena = &temp_mem_arena,
-                    .rendering_context = {
-                        .pers = &pers_render_data,
-                        .state = rendering_state,
-                        .display_size = window_state_at_frame_begin.size
-                    },
-                    .input_state = &input_state
-                };
+            if (!Vec2DIsEqual(window_state_at_frame_begin.size, display_size_rendered) || !info->render_only_when_dirty) {
+                visuals_dirty = true;
+            }
 
-                if (!info->render_func(&func_data)) {
-                    CleanGame(&cleanup_info);
-                    return false;
-                }
+            const bool render = !iconified && (visuals_dirty || !AreInputStatesEqual(&input_state, &input_state_rendered));
 
-                ResetMemArena(&temp_mem_arena);
+            // Captures are made at the tick rate, so ticks that go without a frame of their own have the last one captured written again in their place.
+            if (cleanup_info.frame_capture) {
+                const int repeat_cnt = render ? tick_cnt - 1 : tick_cnt;
+
+                for (int i = 0; i < repeat_cnt; i++) {
+                    RepeatCapturedFrame(&frame_capture);
+                }
             }
 
-            assert(rendering_state->batch_slots_used_cnt == 0); // Make sure that we flushed.
+            if (render) {
+                BeginRendering(rendering_state);
+
+                {
+                    const s_game_render_func_data func_data = {
+                        .user_mem = user_mem,
+                        .perm_mem_arena = &perm_mem_arena,
+                        .temp_mem_arena = &temp_mem_arena,
+                        .rendering_context = {
+                            .pers = &pers_render_data,
+                            .state = rendering_state,
+                            .display_size = window_state_at_frame_begin.size,
+                            .time = (float)frame_time
+                        },
+                        .input_state = &input_state,
+                        .visuals_dirty = visuals_dirty
+                    };
+
+                    if (!info->render_func(&func_data)) {
+                        CleanGame(&cleanup_info);
+                        return false;
+                    }
+
+                    ResetMemArena(&temp_mem_arena);
+                }
+
+                assert(rendering_state->batch_slots_used_cnt == 0 && rendering_state->queue_cmd_cnt == 0); // Make sure that we flushed.
+
+                if (cleanup_info.frame_capture) {
+                    CaptureFrame(&frame_capture, window_state_at_frame_begin.size);
+                }
 
-            glfwSwapBuffers(glfw_window);
+                glfwSwapBuffers(glfw_window);
+
+                visuals_dirty = false;
+                input_state_rendered = input_state;
+                display_size_rendered = window_state_at_frame_begin.size;
+                rendered = true;
+            }
         }
 
-        glfwPollEvents(); // NOTE: Move up, so that input state is updated prior to first tick?
+        if (rendered) {
+            glfwPollEvents(); // NOTE: Move up, so that input state is updated prior to first tick?
+        } else {
+            // Without a buffer swap to hold us to the display rate, we'd spin until the next tick is due. Input wakes us up early.
+            glfwWaitEventsTimeout(MAX(TARG_TICK_INTERVAL - frame_dur_accum, 0.0));
+        }
 
         // Handle any window state changes.
         const s_window_state window_state_after_poll_events = GetWindowState(glfw_window);
 
         if (!Vec2DIsEqual(window_state_after_poll_events.size, VEC_2D_I_ZERO)
             && !Vec2DIsEqual(window_state_after_poll_events.size, window_state_at_frame_begin.size)) {
+            // Render surfaces adapt to the new size by themselves as they're next set.
             glViewport(0, 0, window_state_after_poll_events.size.x, window_state_after_poll_events.size.y);
-
-            if (!ResizeRenderSurfaces(&pers_render_data.surfs, window_state_after_poll_events.size)) {
-                fprintf(stderr, "Failed to resize render surfaces!\n");
-                return false;
-            }
         }
     }
 
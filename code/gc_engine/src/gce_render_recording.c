@@ -0,0 +1,1230 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <gce_render_recording.h>
+#include <gce_rendering.h>
+
+#define RENDER_RECORDING_GL_CMD_CAP_INIT 1024
+#define NULL_GL_INFO_LOG "(recorded without GL)"
+#define NULL_GL_VERSION "4.3 (recorded without GL)" // Parsed by glad when loading the null GL functions, so has to lead with the version.
+
+// Every GL function the engine calls, as its glad name and the upper-case name used in its glad function pointer type.
+#define RENDER_RECORDING_GL_FUNCS \
+    X(ActiveTexture, ACTIVETEXTURE) \
+    X(AttachShader, ATTACHSHADER) \
+    X(BeginQuery, BEGINQUERY) \
+    X(BindBuffer, BINDBUFFER) \
+    X(BindBufferBase, BINDBUFFERBASE) \
+    X(BindFramebuffer, BINDFRAMEBUFFER) \
+    X(BindTexture, BINDTEXTURE) \
+    X(BindVertexArray, BINDVERTEXARRAY) \
+    X(BlendFunc, BLENDFUNC) \
+    X(BlitFramebuffer, BLITFRAMEBUFFER) \
+    X(BufferData, BUFFERDATA) \
+    X(BufferSubData, BUFFERSUBDATA) \
+    X(CheckFramebufferStatus, CHECKFRAMEBUFFERSTATUS) \
+    X(Clear, CLEAR) \
+    X(ClearColor, CLEARCOLOR) \
+    X(ClientWaitSync, CLIENTWAITSYNC) \
+    X(CompileShader, COMPILESHADER) \
+    X(CreateProgram, CREATEPROGRAM) \
+    X(CreateShader, CREATESHADER) \
+    X(DeleteBuffers, DELETEBUFFERS) \
+    X(DeleteFramebuffers, DELETEFRAMEBUFFERS) \
+    X(DeleteProgram, DELETEPROGRAM) \
+    X(DeleteQueries, DELETEQUERIES) \
+    X(DeleteShader, DELETESHADER) \
+    X(DeleteSync, DELETESYNC) \
+    X(DeleteTextures, DELETETEXTURES) \
+    X(DeleteVertexArrays, DELETEVERTEXARRAYS) \
+    X(DetachShader, DETACHSHADER) \
+    X(DispatchCompute, DISPATCHCOMPUTE) \
+    X(DispatchComputeIndirect, DISPATCHCOMPUTEINDIRECT) \
+    X(DrawArraysIndirect, DRAWARRAYSINDIRECT) \
+    X(DrawElements, DRAWELEMENTS) \
+    X(DrawElementsBaseVertex, DRAWELEMENTSBASEVERTEX) \
+    X(DrawElementsInstancedBaseInstance, DRAWELEMENTSINSTANCEDBASEINSTANCE) \
+    X(Enable, ENABLE) \
+    X(EnableVertexAttribArray, ENABLEVERTEXATTRIBARRAY) \
+    X(EndQuery, ENDQUERY) \
+    X(FenceSync, FENCESYNC) \
+    X(FlushMappedBufferRange, FLUSHMAPPEDBUFFERRANGE) \
+    X(FramebufferTexture2D, FRAMEBUFFERTEXTURE2D) \
+    X(GenBuffers, GENBUFFERS) \
+    X(GenFramebuffers, GENFRAMEBUFFERS) \
+    X(GenQueries, GENQUERIES) \
+    X(GenTextures, GENTEXTURES) \
+    X(GenVertexArrays, GENVERTEXARRAYS) \
+    X(GetIntegerv, GETINTEGERV) \
+    X(GetProgramBinary, GETPROGRAMBINARY) \
+    X(GetProgramInfoLog, GETPROGRAMINFOLOG) \
+    X(GetProgramInterfaceiv, GETPROGRAMINTERFACEIV) \
+    X(GetProgramResourceName, GETPROGRAMRESOURCENAME) \
+    X(GetProgramResourceiv, GETPROGRAMRESOURCEIV) \
+    X(GetProgramiv, GETPROGRAMIV) \
+    X(GetQueryObjectiv, GETQUERYOBJECTIV) \
+    X(GetQueryObjectui64v, GETQUERYOBJECTUI64V) \
+    X(GetShaderInfoLog, GETSHADERINFOLOG) \
+    X(GetShaderiv, GETSHADERIV) \
+    X(GetString, GETSTRING) \
+    X(GetUniformBlockIndex, GETUNIFORMBLOCKINDEX) \
+    X(GetUniformLocation, GETUNIFORMLOCATION) \
+    X(LinkProgram, LINKPROGRAM) \
+    X(MapBufferRange, MAPBUFFERRANGE) \
+    X(MemoryBarrier, MEMORYBARRIER) \
+    X(MultiDrawElementsIndirect, MULTIDRAWELEMENTSINDIRECT) \
+    X(ProgramBinary, PROGRAMBINARY) \
+    X(ProgramParameteri, PROGRAMPARAMETERI) \
+    X(ProgramUniform1f, PROGRAMUNIFORM1F) \
+    X(ProgramUniform1i, PROGRAMUNIFORM1I) \
+    X(ProgramUniform1iv, PROGRAMUNIFORM1IV) \
+    X(ProgramUniform2f, PROGRAMUNIFORM2F) \
+    X(ProgramUniform3f, PROGRAMUNIFORM3F) \
+    X(ProgramUniform4f, PROGRAMUNIFORM4F) \
+    X(ProgramUniformMatrix4fv, PROGRAMUNIFORMMATRIX4FV) \
+    X(ReadPixels, READPIXELS) \
+    X(ShaderSource, SHADERSOURCE) \
+    X(TexImage2D, TEXIMAGE2D) \
+    X(TexParameteri, TEXPARAMETERI) \
+    X(Uniform1i, UNIFORM1I) \
+    X(Uniform1ui, UNIFORM1UI) \
+    X(Uniform4f, UNIFORM4F) \
+    X(UniformBlockBinding, UNIFORMBLOCKBINDING) \
+    X(UnmapBuffer, UNMAPBUFFER) \
+    X(UseProgram, USEPROGRAM) \
+    X(VertexAttribDivisor, VERTEXATTRIBDIVISOR) \
+    X(VertexAttribIPointer, VERTEXATTRIBIPOINTER) \
+    X(VertexAttribPointer, VERTEXATTRIBPOINTER) \
+    X(Viewport, VIEWPORT)
+
+// The versions glad sets a flag for on loading.
+#define NULL_GL_VERSION_FLAGS \
+    X(1_0) \
+    X(1_1) \
+    X(1_2) \
+    X(1_3) \
+    X(1_4) \
+    X(1_5) \
+    X(2_0) \
+    X(2_1) \
+    X(3_0) \
+    X(3_1) \
+    X(3_2) \
+    X(3_3) \
+    X(4_0) \
+    X(4_1) \
+    X(4_2) \
+    X(4_3)
+
+static struct {
+#define X(name, upper) PFNGL##upper##PROC name;
+    RENDER_RECORDING_GL_FUNCS
+#undef X
+} g_gl_funcs; // The functions glad loaded, saved while recording is active.
+
+static s_render_recording* g_render_recording; // Only one recording can be active at a time, as glad's function table is global.
+
+// What glad held before the null GL was loaded over it, to be put back once the recording ends.
+static struct {
+    bool loaded;
+    struct gladGLversionStruct version;
+
+    struct {
+#define X(ver) int v##ver;
+        NULL_GL_VERSION_FLAGS
+#undef X
+    } version_flags;
+} g_null_gl;
+
+static const char* const g_recorded_gl_cmd_type_names[] = {
+    [ek_recorded_gl_cmd_type_draw] = "draw",
+    [ek_recorded_gl_cmd_type_dispatch] = "dispatch",
+    [ek_recorded_gl_cmd_type_clear] = "clear",
+    [ek_recorded_gl_cmd_type_blit] = "blit",
+    [ek_recorded_gl_cmd_type_bind] = "bind",
+    [ek_recorded_gl_cmd_type_upload] = "upload",
+    [ek_recorded_gl_cmd_type_readback] = "readback",
+    [ek_recorded_gl_cmd_type_state] = "state",
+    [ek_recorded_gl_cmd_type_resource] = "resource",
+    [ek_recorded_gl_cmd_type_sync] = "sync",
+    [ek_recorded_gl_cmd_type_query] = "query"
+};
+
+static void RecordGLCmd(const e_recorded_gl_cmd_type type, const char* const name, const int64_t a0, const int64_t a1, const int64_t a2, const int64_t a3, const int64_t byte_cnt) {
+    s_render_recording* const rec = g_render_recording;
+    assert(rec);
+
+    rec->type_cnts[type]++;
+
+    if (type == ek_recorded_gl_cmd_type_upload) {
+        rec->upload_byte_cnt += byte_cnt;
+    } else if (type == ek_recorded_gl_cmd_type_readback) {
+        rec->readback_byte_cnt += byte_cnt;
+    }
+
+    if (rec->cmd_cnt == rec->cmd_cap) {
+        const int cap_new = rec->cmd_cap ? rec->cmd_cap * 2 : RENDER_RECORDING_GL_CMD_CAP_INIT;
+        s_recorded_gl_cmd* const cmds_new = realloc(rec->cmds, sizeof(*cmds_new) * cap_new);
+
+        if (!cmds_new) {
+            // The totals above are still kept accurate, only the command list is cut short.
+            return;
+        }
+
+        rec->cmds = cmds_new;
+        rec->cmd_cap = cap_new;
+    }
+
+    rec->cmds[rec->cmd_cnt] = (s_recorded_gl_cmd){
+        .type = type,
+        .name = name,
+        .args = {a0, a1, a2, a3},
+        .byte_cnt = byte_cnt
+    };
+
+    rec->cmd_cnt++;
+}
+
+static int TexelSize(const GLenum format, const GLenum type) {
+    int channel_cnt;
+
+    switch (format) {
+        case GL_RED:
+        case GL_DEPTH_COMPONENT:
+            channel_cnt = 1;
+            break;
+
+        case GL_RG:
+            channel_cnt = 2;
+            break;
+
+        case GL_RGB:
+        case GL_BGR:
+            channel_cnt = 3;
+            break;
+
+        default:
+            channel_cnt = 4;
+            break;
+    }
+
+    switch (type) {
+        case GL_UNSIGNED_BYTE:
+        case GL_BYTE:
+            return channel_cnt;
+
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT:
+        case GL_HALF_FLOAT:
+            return channel_cnt * 2;
+
+        default:
+            return channel_cnt * 4;
+    }
+}
+
+//
+// Null GL
+//
+static GLuint GenNullGLID(void) {
+    return ++g_render_recording->null_gl_id_next;
+}
+
+static void GenNullGLIDs(const GLsizei n, GLuint* const ids) {
+    for (GLsizei i = 0; i < n; i++) {
+        ids[i] = GenNullGLID();
+    }
+}
+
+static GLint NullGLInteger(const GLenum pname) {
+    switch (pname) {
+        case GL_MAX_TEXTURE_IMAGE_UNITS:
+            return RENDER_BATCH_TEX_SLOT_LIMIT;
+
+        default:
+            return 0;
+    }
+}
+
+static void NullGLInfoLog(const GLsizei buf_size, GLsizei* const length, GLchar* const str) {
+    const GLsizei len = buf_size > 0 ? MIN((GLsizei)strlen(NULL_GL_INFO_LOG), buf_size - 1) : 0;
+
+    if (buf_size > 0) {
+        memcpy(str, NULL_GL_INFO_LOG, len);
+        str[len] = '\0';
+    }
+
+    if (length) {
+        *length = len;
+    }
+}
+
+static void* MapNullGLBuffer(const GLsizeiptr length) {
+    // Writes into a mapped buffer go into scratch memory, which is grown to fit the largest mapping made.
+    s_render_recording* const rec = g_render_recording;
+
+    if (length > rec->null_map_buf_size) {
+        t_byte* const buf_new = realloc(rec->null_map_buf, length);
+
+        if (!buf_new) {
+            return NULL;
+        }
+
+        rec->null_map_buf = buf_new;
+        rec->null_map_buf_size = length;
+    }
+
+    return rec->null_map_buf;
+}
+
+//
+// Recording Functions
+//
+static void APIENTRY RecordActiveTexture(const GLenum texture) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_bind, "glActiveTexture", (int64_t)(texture - GL_TEXTURE0), 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ActiveTexture(texture);
+    }
+}
+
+static void APIENTRY RecordAttachShader(const GLuint program, const GLuint shader) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glAttachShader", (int64_t)program, (int64_t)shader, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.AttachShader(program, shader);
+    }
+}
+
+static void APIENTRY RecordBeginQuery(const GLenum target, const GLuint id) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glBeginQuery", (int64_t)target, (int64_t)id, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BeginQuery(target, id);
+    }
+}
+
+static void APIENTRY RecordBindBuffer(const GLenum target, const GLuint buffer) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_bind, "glBindBuffer", (int64_t)target, (int64_t)buffer, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BindBuffer(target, buffer);
+    }
+}
+
+static void APIENTRY RecordBindBufferBase(const GLenum target, const GLuint index, const GLuint buffer) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_bind, "glBindBufferBase", (int64_t)target, (int64_t)index, (int64_t)buffer, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BindBufferBase(target, index, buffer);
+    }
+}
+
+static void APIENTRY RecordBindFramebuffer(const GLenum target, const GLuint framebuffer) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_bind, "glBindFramebuffer", (int64_t)target, (int64_t)framebuffer, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BindFramebuffer(target, framebuffer);
+    }
+}
+
+static void APIENTRY RecordBindTexture(const GLenum target, const GLuint texture) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_bind, "glBindTexture", (int64_t)target, (int64_t)texture, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BindTexture(target, texture);
+    }
+}
+
+static void APIENTRY RecordBindVertexArray(const GLuint array) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_bind, "glBindVertexArray", (int64_t)array, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BindVertexArray(array);
+    }
+}
+
+static void APIENTRY RecordBlendFunc(const GLenum sfactor, const GLenum dfactor) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glBlendFunc", (int64_t)sfactor, (int64_t)dfactor, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BlendFunc(sfactor, dfactor);
+    }
+}
+
+static void APIENTRY RecordBlitFramebuffer(const GLint src_x0, const GLint src_y0, const GLint src_x1, const GLint src_y1, const GLint dst_x0, const GLint dst_y0, const GLint dst_x1, const GLint dst_y1, const GLbitfield mask, const GLenum filter) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_blit, "glBlitFramebuffer", (int64_t)(dst_x1 - dst_x0), (int64_t)(dst_y1 - dst_y0), (int64_t)mask, (int64_t)filter, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1, mask, filter);
+    }
+}
+
+static void APIENTRY RecordBufferData(const GLenum target, const GLsizeiptr size, const void* const data, const GLenum usage) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glBufferData", (int64_t)target, (int64_t)size, (int64_t)usage, 0, (int64_t)(data ? size : 0));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BufferData(target, size, data, usage);
+    }
+}
+
+static void APIENTRY RecordBufferSubData(const GLenum target, const GLintptr offset, const GLsizeiptr size, const void* const data) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glBufferSubData", (int64_t)target, (int64_t)offset, (int64_t)size, 0, (int64_t)size);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.BufferSubData(target, offset, size, data);
+    }
+}
+
+static GLenum APIENTRY RecordCheckFramebufferStatus(const GLenum target) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glCheckFramebufferStatus", (int64_t)target, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.CheckFramebufferStatus(target);
+    }
+
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void APIENTRY RecordClear(const GLbitfield mask) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_clear, "glClear", (int64_t)mask, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.Clear(mask);
+    }
+}
+
+static void APIENTRY RecordClearColor(const GLfloat red, const GLfloat green, const GLfloat blue, const GLfloat alpha) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glClearColor", 0, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ClearColor(red, green, blue, alpha);
+    }
+}
+
+static GLenum APIENTRY RecordClientWaitSync(const GLsync sync, const GLbitfield flags, const GLuint64 timeout) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_sync, "glClientWaitSync", (int64_t)flags, (int64_t)timeout, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.ClientWaitSync(sync, flags, timeout);
+    }
+
+    return GL_ALREADY_SIGNALED;
+}
+
+static void APIENTRY RecordCompileShader(const GLuint shader) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glCompileShader", (int64_t)shader, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.CompileShader(shader);
+    }
+}
+
+static GLuint APIENTRY RecordCreateProgram(void) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glCreateProgram", 0, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.CreateProgram();
+    }
+
+    return GenNullGLID();
+}
+
+static GLuint APIENTRY RecordCreateShader(const GLenum type) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glCreateShader", (int64_t)type, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.CreateShader(type);
+    }
+
+    return GenNullGLID();
+}
+
+static void APIENTRY RecordDeleteBuffers(const GLsizei n, const GLuint* const buffers) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDeleteBuffers", (int64_t)n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DeleteBuffers(n, buffers);
+    }
+}
+
+static void APIENTRY RecordDeleteFramebuffers(const GLsizei n, const GLuint* const framebuffers) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDeleteFramebuffers", (int64_t)n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DeleteFramebuffers(n, framebuffers);
+    }
+}
+
+static void APIENTRY RecordDeleteProgram(const GLuint program) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDeleteProgram", (int64_t)program, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DeleteProgram(program);
+    }
+}
+
+static void APIENTRY RecordDeleteQueries(const GLsizei n, const GLuint* const ids) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDeleteQueries", (int64_t)n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DeleteQueries(n, ids);
+    }
+}
+
+static void APIENTRY RecordDeleteShader(const GLuint shader) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDeleteShader", (int64_t)shader, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DeleteShader(shader);
+    }
+}
+
+static void APIENTRY RecordDeleteSync(const GLsync sync) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDeleteSync", 0, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DeleteSync(sync);
+    }
+}
+
+static void APIENTRY RecordDeleteTextures(const GLsizei n, const GLuint* const textures) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDeleteTextures", (int64_t)n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DeleteTextures(n, textures);
+    }
+}
+
+static void APIENTRY RecordDeleteVertexArrays(const GLsizei n, const GLuint* const arrays) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDeleteVertexArrays", (int64_t)n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DeleteVertexArrays(n, arrays);
+    }
+}
+
+static void APIENTRY RecordDetachShader(const GLuint program, const GLuint shader) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glDetachShader", (int64_t)program, (int64_t)shader, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DetachShader(program, shader);
+    }
+}
+
+static void APIENTRY RecordDispatchCompute(const GLuint num_groups_x, const GLuint num_groups_y, const GLuint num_groups_z) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_dispatch, "glDispatchCompute", (int64_t)num_groups_x, (int64_t)num_groups_y, (int64_t)num_groups_z, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DispatchCompute(num_groups_x, num_groups_y, num_groups_z);
+    }
+}
+
+static void APIENTRY RecordDispatchComputeIndirect(const GLintptr indirect) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_dispatch, "glDispatchComputeIndirect", (int64_t)indirect, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DispatchComputeIndirect(indirect);
+    }
+}
+
+static void APIENTRY RecordDrawArraysIndirect(const GLenum mode, const void* const indirect) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_draw, "glDrawArraysIndirect", (int64_t)mode, (int64_t)(intptr_t)indirect, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DrawArraysIndirect(mode, indirect);
+    }
+}
+
+static void APIENTRY RecordDrawElements(const GLenum mode, const GLsizei count, const GLenum type, const void* const indices) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_draw, "glDrawElements", (int64_t)mode, (int64_t)count, 1, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DrawElements(mode, count, type, indices);
+    }
+}
+
+static void APIENTRY RecordDrawElementsBaseVertex(const GLenum mode, const GLsizei count, const GLenum type, const void* const indices, const GLint basevertex) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_draw, "glDrawElementsBaseVertex", (int64_t)mode, (int64_t)count, 1, (int64_t)basevertex, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DrawElementsBaseVertex(mode, count, type, indices, basevertex);
+    }
+}
+
+static void APIENTRY RecordDrawElementsInstancedBaseInstance(const GLenum mode, const GLsizei count, const GLenum type, const void* const indices, const GLsizei instancecount, const GLuint baseinstance) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_draw, "glDrawElementsInstancedBaseInstance", (int64_t)mode, (int64_t)count, (int64_t)instancecount, (int64_t)baseinstance, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.DrawElementsInstancedBaseInstance(mode, count, type, indices, instancecount, baseinstance);
+    }
+}
+
+static void APIENTRY RecordEnable(const GLenum cap) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glEnable", (int64_t)cap, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.Enable(cap);
+    }
+}
+
+static void APIENTRY RecordEnableVertexAttribArray(const GLuint index) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glEnableVertexAttribArray", (int64_t)index, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.EnableVertexAttribArray(index);
+    }
+}
+
+static void APIENTRY RecordEndQuery(const GLenum target) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glEndQuery", (int64_t)target, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.EndQuery(target);
+    }
+}
+
+static GLsync APIENTRY RecordFenceSync(const GLenum condition, const GLbitfield flags) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_sync, "glFenceSync", (int64_t)condition, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.FenceSync(condition, flags);
+    }
+
+    return (GLsync)&g_render_recording;
+}
+
+static void APIENTRY RecordFlushMappedBufferRange(const GLenum target, const GLintptr offset, const GLsizeiptr length) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glFlushMappedBufferRange", (int64_t)target, (int64_t)offset, (int64_t)length, 0, (int64_t)length);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.FlushMappedBufferRange(target, offset, length);
+    }
+}
+
+static void APIENTRY RecordFramebufferTexture2D(const GLenum target, const GLenum attachment, const GLenum textarget, const GLuint texture, const GLint level) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glFramebufferTexture2D", (int64_t)attachment, (int64_t)texture, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.FramebufferTexture2D(target, attachment, textarget, texture, level);
+    }
+}
+
+static void APIENTRY RecordGenBuffers(const GLsizei n, GLuint* const buffers) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glGenBuffers", n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GenBuffers(n, buffers);
+    } else {
+        GenNullGLIDs(n, buffers);
+    }
+}
+
+static void APIENTRY RecordGenFramebuffers(const GLsizei n, GLuint* const framebuffers) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glGenFramebuffers", n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GenFramebuffers(n, framebuffers);
+    } else {
+        GenNullGLIDs(n, framebuffers);
+    }
+}
+
+static void APIENTRY RecordGenQueries(const GLsizei n, GLuint* const ids) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glGenQueries", n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GenQueries(n, ids);
+    } else {
+        GenNullGLIDs(n, ids);
+    }
+}
+
+static void APIENTRY RecordGenTextures(const GLsizei n, GLuint* const textures) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glGenTextures", n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GenTextures(n, textures);
+    } else {
+        GenNullGLIDs(n, textures);
+    }
+}
+
+static void APIENTRY RecordGenVertexArrays(const GLsizei n, GLuint* const arrays) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glGenVertexArrays", n, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GenVertexArrays(n, arrays);
+    } else {
+        GenNullGLIDs(n, arrays);
+    }
+}
+
+static void APIENTRY RecordGetIntegerv(const GLenum pname, GLint* const data) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetIntegerv", (int64_t)pname, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetIntegerv(pname, data);
+    } else {
+        *data = NullGLInteger(pname);
+    }
+}
+
+static void APIENTRY RecordGetProgramBinary(const GLuint program, const GLsizei buf_size, GLsizei* const length, GLenum* const binary_format, void* const binary) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_readback, "glGetProgramBinary", (int64_t)program, (int64_t)buf_size, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetProgramBinary(program, buf_size, length, binary_format, binary);
+    } else if (length) {
+        *length = 0;
+    }
+}
+
+static void APIENTRY RecordGetProgramInfoLog(const GLuint program, const GLsizei buf_size, GLsizei* const length, GLchar* const info_log) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetProgramInfoLog", (int64_t)program, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetProgramInfoLog(program, buf_size, length, info_log);
+    } else {
+        NullGLInfoLog(buf_size, length, info_log);
+    }
+}
+
+static void APIENTRY RecordGetProgramInterfaceiv(const GLuint program, const GLenum program_interface, const GLenum pname, GLint* const params) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetProgramInterfaceiv", (int64_t)program, (int64_t)program_interface, (int64_t)pname, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetProgramInterfaceiv(program, program_interface, pname, params);
+    } else {
+        *params = 0;
+    }
+}
+
+static void APIENTRY RecordGetProgramResourceName(const GLuint program, const GLenum program_interface, const GLuint index, const GLsizei buf_size, GLsizei* const length, GLchar* const name) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetProgramResourceName", (int64_t)program, (int64_t)index, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetProgramResourceName(program, program_interface, index, buf_size, length, name);
+    } else {
+        NullGLInfoLog(buf_size, length, name);
+    }
+}
+
+static void APIENTRY RecordGetProgramResourceiv(const GLuint program, const GLenum program_interface, const GLuint index, const GLsizei prop_count, const GLenum* const props, const GLsizei count, GLsizei* const length, GLint* const params) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetProgramResourceiv", (int64_t)program, (int64_t)index, (int64_t)prop_count, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetProgramResourceiv(program, program_interface, index, prop_count, props, count, length, params);
+    } else {
+        for (int i = 0; i < count; i++) {
+            params[i] = 0;
+        }
+
+        if (length) {
+            *length = count;
+        }
+    }
+}
+
+static void APIENTRY RecordGetProgramiv(const GLuint program, const GLenum pname, GLint* const params) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetProgramiv", (int64_t)program, (int64_t)pname, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetProgramiv(program, pname, params);
+    } else {
+        *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+    }
+}
+
+static void APIENTRY RecordGetQueryObjectiv(const GLuint id, const GLenum pname, GLint* const params) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_readback, "glGetQueryObjectiv", (int64_t)id, (int64_t)pname, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetQueryObjectiv(id, pname, params);
+    } else {
+        *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+    }
+}
+
+static void APIENTRY RecordGetQueryObjectui64v(const GLuint id, const GLenum pname, GLuint64* const params) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_readback, "glGetQueryObjectui64v", (int64_t)id, (int64_t)pname, 0, 0, (int64_t)sizeof(*params));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetQueryObjectui64v(id, pname, params);
+    } else {
+        *params = 0;
+    }
+}
+
+static void APIENTRY RecordGetShaderInfoLog(const GLuint shader, const GLsizei buf_size, GLsizei* const length, GLchar* const info_log) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetShaderInfoLog", (int64_t)shader, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetShaderInfoLog(shader, buf_size, length, info_log);
+    } else {
+        NullGLInfoLog(buf_size, length, info_log);
+    }
+}
+
+static void APIENTRY RecordGetShaderiv(const GLuint shader, const GLenum pname, GLint* const params) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetShaderiv", (int64_t)shader, (int64_t)pname, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.GetShaderiv(shader, pname, params);
+    } else {
+        *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+    }
+}
+
+static const GLubyte* APIENTRY RecordGetString(const GLenum name) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetString", (int64_t)name, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.GetString(name);
+    }
+
+    return (const GLubyte*)NULL_GL_VERSION;
+}
+
+static GLuint APIENTRY RecordGetUniformBlockIndex(const GLuint program, const GLchar* const uniform_block_name) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetUniformBlockIndex", (int64_t)program, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.GetUniformBlockIndex(program, uniform_block_name);
+    }
+
+    return GL_INVALID_INDEX;
+}
+
+static GLint APIENTRY RecordGetUniformLocation(const GLuint program, const GLchar* const name) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_query, "glGetUniformLocation", (int64_t)program, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.GetUniformLocation(program, name);
+    }
+
+    return 0;
+}
+
+static void APIENTRY RecordLinkProgram(const GLuint program) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glLinkProgram", (int64_t)program, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.LinkProgram(program);
+    }
+}
+
+static void* APIENTRY RecordMapBufferRange(const GLenum target, const GLintptr offset, const GLsizeiptr length, const GLbitfield access) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glMapBufferRange", (int64_t)target, (int64_t)offset, (int64_t)length, (int64_t)access, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.MapBufferRange(target, offset, length, access);
+    }
+
+    t_byte* const mapped = MapNullGLBuffer(length);
+
+    // There's nothing to read back without GL, so reads see zeroes rather than whatever was last written.
+    if (mapped && (access & GL_MAP_READ_BIT)) {
+        memset(mapped, 0, length);
+    }
+
+    return mapped;
+}
+
+static void APIENTRY RecordMemoryBarrier(const GLbitfield barriers) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glMemoryBarrier", (int64_t)barriers, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.MemoryBarrier(barriers);
+    }
+}
+
+static void APIENTRY RecordMultiDrawElementsIndirect(const GLenum mode, const GLenum type, const void* const indirect, const GLsizei drawcount, const GLsizei stride) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_draw, "glMultiDrawElementsIndirect", (int64_t)mode, (int64_t)type, (int64_t)drawcount, (int64_t)stride, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.MultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+    }
+}
+
+static void APIENTRY RecordProgramBinary(const GLuint program, const GLenum binary_format, const void* const binary, const GLsizei length) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glProgramBinary", (int64_t)program, (int64_t)binary_format, 0, 0, (int64_t)length);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramBinary(program, binary_format, binary, length);
+    }
+}
+
+static void APIENTRY RecordProgramParameteri(const GLuint program, const GLenum pname, const GLint value) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glProgramParameteri", (int64_t)program, (int64_t)pname, (int64_t)value, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramParameteri(program, pname, value);
+    }
+}
+
+static void APIENTRY RecordProgramUniform1f(const GLuint program, const GLint location, const GLfloat v0) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glProgramUniform1f", (int64_t)program, (int64_t)location, 0, 0, (int64_t)sizeof(GLfloat));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramUniform1f(program, location, v0);
+    }
+}
+
+static void APIENTRY RecordProgramUniform1i(const GLuint program, const GLint location, const GLint v0) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glProgramUniform1i", (int64_t)program, (int64_t)location, 0, 0, (int64_t)sizeof(GLint));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramUniform1i(program, location, v0);
+    }
+}
+
+static void APIENTRY RecordProgramUniform1iv(const GLuint program, const GLint location, const GLsizei count, const GLint* const value) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glProgramUniform1iv", (int64_t)program, (int64_t)location, (int64_t)count, 0, (int64_t)(sizeof(GLint) * count));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramUniform1iv(program, location, count, value);
+    }
+}
+
+static void APIENTRY RecordProgramUniform2f(const GLuint program, const GLint location, const GLfloat v0, const GLfloat v1) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glProgramUniform2f", (int64_t)program, (int64_t)location, 0, 0, (int64_t)(sizeof(GLfloat) * 2));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramUniform2f(program, location, v0, v1);
+    }
+}
+
+static void APIENTRY RecordProgramUniform3f(const GLuint program, const GLint location, const GLfloat v0, const GLfloat v1, const GLfloat v2) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glProgramUniform3f", (int64_t)program, (int64_t)location, 0, 0, (int64_t)(sizeof(GLfloat) * 3));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramUniform3f(program, location, v0, v1, v2);
+    }
+}
+
+static void APIENTRY RecordProgramUniform4f(const GLuint program, const GLint location, const GLfloat v0, const GLfloat v1, const GLfloat v2, const GLfloat v3) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glProgramUniform4f", (int64_t)program, (int64_t)location, 0, 0, (int64_t)(sizeof(GLfloat) * 4));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramUniform4f(program, location, v0, v1, v2, v3);
+    }
+}
+
+static void APIENTRY RecordProgramUniformMatrix4fv(const GLuint program, const GLint location, const GLsizei count, const GLboolean transpose, const GLfloat* const value) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glProgramUniformMatrix4fv", (int64_t)program, (int64_t)location, (int64_t)count, 0, (int64_t)(sizeof(GLfloat) * 16 * count));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ProgramUniformMatrix4fv(program, location, count, transpose, value);
+    }
+}
+
+static void APIENTRY RecordReadPixels(const GLint x, const GLint y, const GLsizei width, const GLsizei height, const GLenum format, const GLenum type, void* const pixels) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_readback, "glReadPixels", (int64_t)width, (int64_t)height, (int64_t)format, (int64_t)type, (int64_t)width * height * TexelSize(format, type));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ReadPixels(x, y, width, height, format, type, pixels);
+    }
+}
+
+static void APIENTRY RecordShaderSource(const GLuint shader, const GLsizei count, const GLchar* const* const string, const GLint* const length) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glShaderSource", (int64_t)shader, (int64_t)count, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.ShaderSource(shader, count, string, length);
+    }
+}
+
+static void APIENTRY RecordTexImage2D(const GLenum target, const GLint level, const GLint internalformat, const GLsizei width, const GLsizei height, const GLint border, const GLenum format, const GLenum type, const void* const pixels) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glTexImage2D", (int64_t)width, (int64_t)height, (int64_t)internalformat, 0, (int64_t)(pixels ? (int64_t)width * height * TexelSize(format, type) : 0));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+    }
+}
+
+static void APIENTRY RecordTexParameteri(const GLenum target, const GLenum pname, const GLint param) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glTexParameteri", (int64_t)pname, (int64_t)param, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.TexParameteri(target, pname, param);
+    }
+}
+
+static void APIENTRY RecordUniform1i(const GLint location, const GLint v0) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glUniform1i", (int64_t)location, 0, 0, 0, (int64_t)sizeof(GLint));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.Uniform1i(location, v0);
+    }
+}
+
+static void APIENTRY RecordUniform1ui(const GLint location, const GLuint v0) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glUniform1ui", (int64_t)location, 0, 0, 0, (int64_t)sizeof(GLuint));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.Uniform1ui(location, v0);
+    }
+}
+
+static void APIENTRY RecordUniform4f(const GLint location, const GLfloat v0, const GLfloat v1, const GLfloat v2, const GLfloat v3) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_upload, "glUniform4f", (int64_t)location, 0, 0, 0, (int64_t)(sizeof(GLfloat) * 4));
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.Uniform4f(location, v0, v1, v2, v3);
+    }
+}
+
+static void APIENTRY RecordUniformBlockBinding(const GLuint program, const GLuint uniform_block_index, const GLuint uniform_block_binding) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glUniformBlockBinding", (int64_t)program, (int64_t)uniform_block_index, (int64_t)uniform_block_binding, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.UniformBlockBinding(program, uniform_block_index, uniform_block_binding);
+    }
+}
+
+static GLboolean APIENTRY RecordUnmapBuffer(const GLenum target) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_resource, "glUnmapBuffer", (int64_t)target, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        return g_gl_funcs.UnmapBuffer(target);
+    }
+
+    return GL_TRUE;
+}
+
+static void APIENTRY RecordUseProgram(const GLuint program) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_bind, "glUseProgram", (int64_t)program, 0, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.UseProgram(program);
+    }
+}
+
+static void APIENTRY RecordVertexAttribDivisor(const GLuint index, const GLuint divisor) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glVertexAttribDivisor", (int64_t)index, (int64_t)divisor, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.VertexAttribDivisor(index, divisor);
+    }
+}
+
+static void APIENTRY RecordVertexAttribIPointer(const GLuint index, const GLint size, const GLenum type, const GLsizei stride, const void* const pointer) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glVertexAttribIPointer", (int64_t)index, (int64_t)size, (int64_t)type, (int64_t)stride, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.VertexAttribIPointer(index, size, type, stride, pointer);
+    }
+}
+
+static void APIENTRY RecordVertexAttribPointer(const GLuint index, const GLint size, const GLenum type, const GLboolean normalized, const GLsizei stride, const void* const pointer) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glVertexAttribPointer", (int64_t)index, (int64_t)size, (int64_t)type, (int64_t)stride, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.VertexAttribPointer(index, size, type, normalized, stride, pointer);
+    }
+}
+
+static void APIENTRY RecordViewport(const GLint x, const GLint y, const GLsizei width, const GLsizei height) {
+    RecordGLCmd(ek_recorded_gl_cmd_type_state, "glViewport", (int64_t)width, (int64_t)height, 0, 0, 0);
+
+    if (g_render_recording->forward_to_gl) {
+        g_gl_funcs.Viewport(x, y, width, height);
+    }
+}
+
+//
+// Null GL Loading
+//
+static void APIENTRY TrapUnhookedGLFunc(void) {
+    fprintf(stderr, "A GL function was called that the render recording doesn't stand in for, with no GL loaded to fall back on! It needs adding to RENDER_RECORDING_GL_FUNCS.\n");
+    assert(false);
+    abort();
+}
+
+// glad queries the version and extensions through these while loading, so they can't record.
+static const GLubyte* APIENTRY NullGLGetString(const GLenum name) {
+    (void)name;
+    return (const GLubyte*)NULL_GL_VERSION;
+}
+
+static void APIENTRY NullGLGetIntegerv(const GLenum pname, GLint* const data) {
+    *data = NullGLInteger(pname);
+}
+
+static void* LoadNullGLQueryFunc(const char* const name) {
+    if (strcmp(name, "glGetString") == 0) {
+        return (void*)NullGLGetString;
+    }
+
+    if (strcmp(name, "glGetIntegerv") == 0) {
+        return (void*)NullGLGetIntegerv;
+    }
+
+    return NULL;
+}
+
+static void* LoadNullGLFunc(const char* const name) {
+    void* const query_func = LoadNullGLQueryFunc(name);
+    return query_func ? query_func : (void*)TrapUnhookedGLFunc;
+}
+
+// For recording without GL ever having been loaded. Every function glad knows of is pointed at
+// the trap, so that an unhooked call is reported instead of jumping through a null pointer.
+static void LoadNullGL(void) {
+    assert(!g_null_gl.loaded);
+
+    g_null_gl.loaded = true;
+    g_null_gl.version = GLVersion;
+
+#define X(ver) g_null_gl.version_flags.v##ver = GLAD_GL_VERSION_##ver;
+    NULL_GL_VERSION_FLAGS
+#undef X
+
+    // glad reports failure here due to there being no extensions, but every core function is set by then.
+    gladLoadGLLoader(LoadNullGLFunc);
+}
+
+// Puts glad back as it was before the null GL was loaded. GL wasn't loaded then, so every function
+// is cleared, along with what glad found out about the version.
+static void UnloadNullGL(void) {
+    assert(g_null_gl.loaded);
+
+    gladLoadGLLoader(LoadNullGLQueryFunc);
+    glad_glGetString = NULL;
+    glad_glGetIntegerv = NULL;
+
+    GLVersion = g_null_gl.version;
+
+#define X(ver) GLAD_GL_VERSION_##ver = g_null_gl.version_flags.v##ver;
+    NULL_GL_VERSION_FLAGS
+#undef X
+
+    ZeroOut(&g_null_gl, sizeof(g_null_gl));
+}
+
+//
+// Recordings
+//
+bool BeginRenderRecording(s_render_recording* const recording, const bool forward_to_gl) {
+    assert(recording);
+    assert(IsZero(recording, sizeof(*recording)));
+
+    if (g_render_recording) {
+        fprintf(stderr, "Failed to begin render recording as another is already active!\n");
+        return false;
+    }
+
+    if (forward_to_gl && !glad_glDrawElements) {
+        fprintf(stderr, "Failed to begin render recording as GL calls are to be forwarded but GL has not been loaded!\n");
+        return false;
+    }
+
+    recording->forward_to_gl = forward_to_gl;
+    g_render_recording = recording;
+
+    if (!forward_to_gl && !glad_glDrawElements) {
+        LoadNullGL();
+    }
+
+#define X(name, upper) g_gl_funcs.name = glad_gl##name; glad_gl##name = Record##name;
+    RENDER_RECORDING_GL_FUNCS
+#undef X
+
+    return true;
+}
+
+void EndRenderRecording(s_render_recording* const recording) {
+    assert(recording);
+    assert(g_render_recording == recording);
+
+#define X(name, upper) glad_gl##name = g_gl_funcs.name;
+    RENDER_RECORDING_GL_FUNCS
+#undef X
+
+    if (g_null_gl.loaded) {
+        UnloadNullGL();
+    }
+
+    g_render_recording = NULL;
+}
+
+void ResetRenderRecording(s_render_recording* const recording) {
+    assert(recording);
+
+    recording->cmd_cnt = 0;
+    memset(recording->type_cnts, 0, sizeof(recording->type_cnts));
+    recording->upload_byte_cnt = 0;
+    recording->readback_byte_cnt = 0;
+}
+
+void CleanRenderRecording(s_render_recording* const recording) {
+    assert(recording);
+    assert(g_render_recording != recording);
+
+    free(recording->cmds);
+    free(recording->null_map_buf);
+
+    ZeroOut(recording, sizeof(*recording));
+}
+
+bool WriteRenderRecording(const s_render_recording* const recording, const char* const file_path) {
+    assert(recording);
+    assert(file_path);
+
+    FILE* const fs = fopen(file_path, "w");
+
+    if (!fs) {
+        fprintf(stderr, "Failed to open \"%s\" for writing the render recording!\n", file_path);
+        return false;
+    }
+
+    // Each command is written as a line of its type, function name, key arguments, and byte count, so that recordings can be diffed against golden ones.
+    for (int i = 0; i < recording->cmd_cnt; i++) {
+        const s_recorded_gl_cmd* const cmd = &recording->cmds[i];
+
+        fprintf(fs, "%s %s", g_recorded_gl_cmd_type_names[cmd->type], cmd->name);
+
+        for (int j = 0; j < RENDER_RECORDING_GL_CMD_ARG_CNT; j++) {
+            fprintf(fs, " %lld", (long long)cmd->args[j]);
+        }
+
+        fprintf(fs, " %lld\n", (long long)cmd->byte_cnt);
+    }
+
+    for (int i = 0; i < eks_recorded_gl_cmd_type_cnt; i++) {
+        fprintf(fs, "# %s %d\n", g_recorded_gl_cmd_type_names[i], recording->type_cnts[i]);
+    }
+
+    fprintf(fs, "# upload_bytes %lld\n", (long long)recording->upload_byte_cnt);
+    fprintf(fs, "# readback_bytes %lld\n", (long long)recording->readback_byte_cnt);
+
+    const bool success = !ferror(fs);
+
+    if (fclose(fs) != 0 || !success) {
+        fprintf(stderr, "Failed to write the render recording to \"%s\"!\n", file_path);
+        return false;
+    }
+
+    return true;
+}
+
+// Counts the recorded calls of the GL function with the given name (e.g. "glDrawArraysIndirect").
+int RenderRecordingCmdCnt(const s_render_recording* const recording, const char* const name) {
+    assert(recording);
+    assert(name);
+
+    int cnt = 0;
+
+    for (int i = 0; i < recording->cmd_cnt; i++) {
+        if (strcmp(recording->cmds[i].name, name) == 0) {
+            cnt++;
+        }
+    }
+
+    return cnt;
+}
+
+const char* RecordedGLCmdTypeName(const e_recorded_gl_cmd_type type) {
+    assert(type >= 0 && type < eks_recorded_gl_cmd_type_cnt);
+    return g_recorded_gl_cmd_type_names[type];
+}
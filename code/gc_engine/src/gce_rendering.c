@@ -1,82 +1,400 @@
 #include "gce_utils.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
 #include <math.h>
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RENDER_USE_SSE2
+#endif
 #include <stb_image.h>
 #include <stb_truetype.h>
 #include <gce_rendering.h>
 
-static t_gl_id CreateShaderFromSrc(const char* const src, const bool frag) {
-    assert(src);
+// For compute programs only the compute source is set, otherwise only the vertex and fragment sources are.
+typedef struct {
+    const char* vert_src;
+    const char* frag_src;
+    const char* comp_src;
+} s_shader_prog_srcs;
+
+static uint64_t HashBytes(uint64_t hash, const char* const str) {
+    // FNV-1a, with the terminator included so that adjacent strings can't run into each other.
+    for (int i = 0; ; i++) {
+        hash ^= (uint8_t)str[i];
+        hash *= 1099511628211ull;
+
+        if (!str[i]) {
+            return hash;
+        }
+    }
+}
+
+// The key covers the driver as well as the sources, since binaries from one driver (or version of it) are no good to another.
+static uint64_t GenShaderProgCacheKey(const s_shader_prog_srcs* const srcs) {
+    uint64_t hash = 14695981039346656037ull;
+
+    hash = HashBytes(hash, (const char*)glGetString(GL_VENDOR));
+    hash = HashBytes(hash, (const char*)glGetString(GL_RENDERER));
+    hash = HashBytes(hash, (const char*)glGetString(GL_VERSION));
+
+    hash = HashBytes(hash, srcs->vert_src ? srcs->vert_src : "");
+    hash = HashBytes(hash, srcs->frag_src ? srcs->frag_src : "");
+    hash = HashBytes(hash, srcs->comp_src ? srcs->comp_src : "");
+
+    return hash;
+}
+
+static void GenShaderProgCacheFilePath(char* const buf, const int buf_size, const char* const cache_dir, const uint64_t key) {
+    const int len = snprintf(buf, buf_size, "%s/%016llx.bin", cache_dir, (unsigned long long)key);
+    assert(len > 0 && len < buf_size);
+}
+
+static bool IsProgramBinaryFormatSupported(const GLenum binary_format) {
+    GLint format_cnt;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_cnt);
+
+    if (format_cnt <= 0) {
+        return false;
+    }
+
+    GLint* const formats = malloc(sizeof(*formats) * format_cnt);
+
+    if (!formats) {
+        return false;
+    }
+
+    glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats);
+
+    bool supported = false;
+
+    for (int i = 0; i < format_cnt; i++) {
+        if ((GLenum)formats[i] == binary_format) {
+            supported = true;
+            break;
+        }
+    }
+
+    free(formats);
+
+    return supported;
+}
+
+// Returns true if the program was successfully loaded from a cached binary, in which case it's already linked. The binary is only trusted once the driver reports the program as linked.
+static bool LoadShaderProgFromCache(const t_gl_id prog_gl_id, const char* const file_path) {
+    FILE* const fs = fopen(file_path, "rb");
+
+    if (!fs) {
+        return false;
+    }
+
+    bool success = false;
 
-    const GLenum shader_type = frag ? GL_FRAGMENT_SHADER : GL_VERTEX_SHADER;
-    const t_gl_id shader_gl_id = glCreateShader(shader_type);
-    glShaderSource(shader_gl_id, 1, &src, NULL);
-    glCompileShader(shader_gl_id);
+    GLenum binary_format;
+    GLint binary_size;
 
-    GLint success;
-    glGetShaderiv(shader_gl_id, GL_COMPILE_STATUS, &success);
+    if (fread(&binary_format, sizeof(binary_format), 1, fs) == 1 && fread(&binary_size, sizeof(binary_size), 1, fs) == 1 && binary_size > 0 && IsProgramBinaryFormatSupported(binary_format)) {
+        void* const binary = malloc(binary_size);
+
+        if (binary && fread(binary, 1, binary_size, fs) == (size_t)binary_size) {
+            glProgramBinary(prog_gl_id, binary_format, binary, binary_size);
+
+            // The driver rejects binaries it can no longer use, in which case we just compile from source.
+            GLint link_status;
+            glGetProgramiv(prog_gl_id, GL_LINK_STATUS, &link_status);
+            success = link_status == GL_TRUE;
+        }
+
+        free(binary);
+    }
+
+    fclose(fs);
+
+    return success;
+}
+
+static void SaveShaderProgToCache(const t_gl_id prog_gl_id, const char* const file_path) {
+    GLint binary_size;
+    glGetProgramiv(prog_gl_id, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+
+    if (binary_size <= 0) {
+        return;
+    }
+
+    void* const binary = malloc(binary_size);
+
+    if (!binary) {
+        return;
+    }
+
+    GLenum binary_format;
+    glGetProgramBinary(prog_gl_id, binary_size, NULL, &binary_format, binary);
+
+    // The binary is written to a temporary file which then replaces the cached one, so that a write cut short (or another instance reading at the same time) never leaves a partial binary under the real name.
+    char temp_file_path[256];
+    const int temp_file_path_len = snprintf(temp_file_path, sizeof(temp_file_path), "%s.tmp", file_path);
+    assert(temp_file_path_len > 0 && temp_file_path_len < (int)sizeof(temp_file_path));
+
+    FILE* const fs = fopen(temp_file_path, "wb");
+
+    bool success = false;
+
+    if (fs) {
+        success = fwrite(&binary_format, sizeof(binary_format), 1, fs) == 1
+            && fwrite(&binary_size, sizeof(binary_size), 1, fs) == 1
+            && fwrite(binary, 1, binary_size, fs) == (size_t)binary_size;
+
+        success = fclose(fs) == 0 && success;
+
+        // Renaming over an existing file fails on Windows, in which case the old one has to go first.
+        if (success && rename(temp_file_path, file_path) != 0) {
+            remove(file_path);
+            success = rename(temp_file_path, file_path) == 0;
+        }
+
+        if (!success) {
+            remove(temp_file_path);
+        }
+    }
 
     if (!success) {
-        glDeleteShader(shader_gl_id);
-        return 0;
+        fprintf(stderr, "Failed to write shader program binary to \"%s\"!\n", file_path);
+    }
+
+    free(binary);
+}
+
+static void LogShaderProgLinkFailure(const t_gl_id prog_gl_id, const t_gl_id* const shader_gl_ids, const int shader_cnt) {
+    char log[1024];
+
+    for (int i = 0; i < shader_cnt; i++) {
+        GLint compile_status;
+        glGetShaderiv(shader_gl_ids[i], GL_COMPILE_STATUS, &compile_status);
+
+        if (compile_status != GL_TRUE) {
+            glGetShaderInfoLog(shader_gl_ids[i], sizeof(log), NULL, log);
+            fprintf(stderr, "Failed to compile shader!\n%s\n", log);
+        }
     }
 
-    return shader_gl_id;
+    glGetProgramInfoLog(prog_gl_id, sizeof(log), NULL, log);
+    fprintf(stderr, "Failed to link shader program!\n%s\n", log);
 }
 
-static t_gl_id CreateShaderProgFromSrcs(const char* const vert_src, const char* const frag_src) {
-    assert(vert_src);
-    assert(frag_src);
+// Loads cached program binaries where it can, and issues every other compile and link before
+// querying any status so the driver can work on them in parallel. On failure all are deleted.
+static bool CreateShaderProgs(t_gl_id* const gl_ids, const s_shader_prog_srcs* const srcs_list, const int cnt, const char* const cache_dir) {
+    assert(gl_ids);
+    assert(srcs_list);
+    assert(cnt > 0);
+
+    bool use_cache = false;
+
+    if (cache_dir) {
+        GLint binary_format_cnt;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_format_cnt);
+
+        use_cache = binary_format_cnt > 0 && CreateDirIfMissing(cache_dir);
+    }
+
+    t_gl_id (* const shader_gl_ids)[2] = calloc(cnt, sizeof(*shader_gl_ids));
+    int* const shader_cnts = calloc(cnt, sizeof(*shader_cnts));
+
+    if (!shader_gl_ids || !shader_cnts) {
+        fprintf(stderr, "Failed to allocate shader program creation buffers!\n");
+        free(shader_gl_ids);
+        free(shader_cnts);
+        return false;
+    }
+
+    char cache_fp[256];
+
+    // Issue the compiles and links.
+    for (int i = 0; i < cnt; i++) {
+        const s_shader_prog_srcs* const srcs = &srcs_list[i];
+        assert(srcs->comp_src ? !srcs->vert_src && !srcs->frag_src : srcs->vert_src && srcs->frag_src);
+
+        gl_ids[i] = glCreateProgram();
+
+        if (use_cache) {
+            GenShaderProgCacheFilePath(cache_fp, sizeof(cache_fp), cache_dir, GenShaderProgCacheKey(srcs));
+
+            if (LoadShaderProgFromCache(gl_ids[i], cache_fp)) {
+                continue;
+            }
+
+            glProgramParameteri(gl_ids[i], GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        const struct {
+            const char* src;
+            GLenum type;
+        } stages[] = {
+            {srcs->vert_src, GL_VERTEX_SHADER},
+            {srcs->frag_src, GL_FRAGMENT_SHADER},
+            {srcs->comp_src, GL_COMPUTE_SHADER}
+        };
+
+        for (int j = 0; j < 3; j++) {
+            if (!stages[j].src) {
+                continue;
+            }
+
+            const t_gl_id shader_gl_id = glCreateShader(stages[j].type);
+            glShaderSource(shader_gl_id, 1, &stages[j].src, NULL);
+            glCompileShader(shader_gl_id);
+            glAttachShader(gl_ids[i], shader_gl_id);
+
+            shader_gl_ids[i][shader_cnts[i]] = shader_gl_id;
+            shader_cnts[i]++;
+        }
+
+        glLinkProgram(gl_ids[i]);
+    }
+
+    // Now wait on the results.
+    bool success = true;
+
+    for (int i = 0; i < cnt; i++) {
+        if (shader_cnts[i] == 0) {
+            continue; // Loaded from the cache.
+        }
+
+        GLint link_status;
+        glGetProgramiv(gl_ids[i], GL_LINK_STATUS, &link_status);
 
-    const t_gl_id vert_shader_gl_id = CreateShaderFromSrc(vert_src, false);
+        if (link_status == GL_TRUE) {
+            if (use_cache) {
+                GenShaderProgCacheFilePath(cache_fp, sizeof(cache_fp), cache_dir, GenShaderProgCacheKey(&srcs_list[i]));
+                SaveShaderProgToCache(gl_ids[i], cache_fp);
+            }
+        } else {
+            LogShaderProgLinkFailure(gl_ids[i], shader_gl_ids[i], shader_cnts[i]);
+            success = false;
+        }
 
-    if (!vert_shader_gl_id) {
-        return 0;
+        for (int j = 0; j < shader_cnts[i]; j++) {
+            glDetachShader(gl_ids[i], shader_gl_ids[i][j]);
+            glDeleteShader(shader_gl_ids[i][j]);
+        }
     }
 
-    const t_gl_id frag_shader_gl_id = CreateShaderFromSrc(frag_src, true);
+    free(shader_gl_ids);
+    free(shader_cnts);
 
-    if (!frag_shader_gl_id) {
-        glDeleteShader(vert_shader_gl_id);
-        return 0;
+    if (!success) {
+        for (int i = 0; i < cnt; i++) {
+            glDeleteProgram(gl_ids[i]);
+            gl_ids[i] = 0;
+        }
     }
 
-    const t_gl_id prog_gl_id = glCreateProgram();
-    glAttachShader(prog_gl_id, vert_shader_gl_id);
-    glAttachShader(prog_gl_id, frag_shader_gl_id);
-    glLinkProgram(prog_gl_id);
+    return success;
+}
 
-    glDeleteShader(vert_shader_gl_id);
-    glDeleteShader(frag_shader_gl_id);
+static void UseShaderProg(s_gl_state_cache* const cache, const t_gl_id gl_id) {
+    if (!(cache->known_bindings & ek_gl_binding_shader_prog) || cache->shader_prog_gl_id != gl_id) {
+        glUseProgram(gl_id);
+        cache->shader_prog_gl_id = gl_id;
+        cache->known_bindings |= ek_gl_binding_shader_prog;
+    }
+}
 
-    return prog_gl_id;
+static void BindVertArray(s_gl_state_cache* const cache, const t_gl_id gl_id) {
+    if (!(cache->known_bindings & ek_gl_binding_vert_array) || cache->vert_array_gl_id != gl_id) {
+        glBindVertexArray(gl_id);
+        cache->vert_array_gl_id = gl_id;
+        cache->known_bindings |= ek_gl_binding_vert_array;
+    }
 }
 
-static t_gl_id CreateShaderProgFromFiles(const s_shader_prog_file_paths fps, s_mem_arena* const temp_mem_arena) {
-    assert(temp_mem_arena);
+static void BindArrayBuf(s_gl_state_cache* const cache, const t_gl_id gl_id) {
+    if (!(cache->known_bindings & ek_gl_binding_array_buf) || cache->array_buf_gl_id != gl_id) {
+        glBindBuffer(GL_ARRAY_BUFFER, gl_id);
+        cache->array_buf_gl_id = gl_id;
+        cache->known_bindings |= ek_gl_binding_array_buf;
+    }
+}
 
-    const char* const vs_src = (const char*)PushEntireFileContents(fps.vs_fp, temp_mem_arena, true);
+static void BindFramebuffer(s_gl_state_cache* const cache, const t_gl_id gl_id) {
+    if (!(cache->known_bindings & ek_gl_binding_framebuffer) || cache->framebuffer_gl_id != gl_id) {
+        glBindFramebuffer(GL_FRAMEBUFFER, gl_id);
+        cache->framebuffer_gl_id = gl_id;
+        cache->known_bindings |= ek_gl_binding_framebuffer;
+    }
+}
 
-    if (!vs_src) {
-        return 0;
+static void SetViewport(s_gl_state_cache* const cache, const s_vec_2d_i size) {
+    if (!(cache->known_bindings & ek_gl_binding_viewport) || !Vec2DIsEqual(cache->viewport_size, size)) {
+        glViewport(0, 0, size.x, size.y);
+        cache->viewport_size = size;
+        cache->known_bindings |= ek_gl_binding_viewport;
     }
+}
+
+static void BindTexture(s_gl_state_cache* const cache, const int unit, const t_gl_id gl_id) {
+    assert(unit >= 0 && unit < RENDER_BATCH_TEX_SLOT_LIMIT);
 
-    const char* const fs_src = (const char*)PushEntireFileContents(fps.fs_fp, temp_mem_arena, true);
+    const uint32_t unit_bit = (uint32_t)1 << unit;
 
-    if (!fs_src) {
-        return 0;
+    if ((cache->known_tex_units & unit_bit) && cache->tex_gl_ids[unit] == gl_id) {
+        return;
+    }
+
+    if (!(cache->known_bindings & ek_gl_binding_active_tex_unit) || cache->active_tex_unit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        cache->active_tex_unit = unit;
+        cache->known_bindings |= ek_gl_binding_active_tex_unit;
     }
 
-    return CreateShaderProgFromSrcs(vs_src, fs_src);
+    glBindTexture(GL_TEXTURE_2D, gl_id);
+    cache->tex_gl_ids[unit] = gl_id;
+    cache->known_tex_units |= unit_bit;
+}
+
+// Points the frame uniform block of the program (if it declares one) at the shared binding.
+static void BindFrameUniformBlock(const t_gl_id prog_gl_id) {
+    assert(prog_gl_id != 0);
+
+    const GLuint block_index = glGetUniformBlockIndex(prog_gl_id, RENDER_FRAME_UNIFORM_BLOCK_NAME);
+
+    if (block_index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(prog_gl_id, block_index, RENDER_FRAME_UNIFORM_BLOCK_BINDING);
+    }
 }
 
-bool InitPersRenderData(s_pers_render_data* const render_data, const s_vec_2d_i display_size) {
+// The shader program cache directory is optional, with nothing being cached if it's NULL.
+bool InitPersRenderData(s_pers_render_data* const render_data, const int batch_slot_cnt, const char* const shader_prog_cache_dir) {
     assert(render_data);
     assert(IsZero(render_data, sizeof(*render_data)));
-    assert(display_size.x > 0 && display_size.y > 0);
+    assert(batch_slot_cnt > 0 && batch_slot_cnt <= RENDER_BATCH_SLOT_CNT_LIMIT);
+
+    render_data->batch_slot_cnt = batch_slot_cnt;
+    render_data->batch_ring.batch_size = RENDER_BATCH_SLOT_SIZE * batch_slot_cnt;
+    render_data->batch_ring.region_size = render_data->batch_ring.batch_size * RENDER_BATCH_RING_REGION_BATCH_CNT;
+
+    render_data->queue.cmds = malloc(sizeof(*render_data->queue.cmds) * RENDER_QUEUE_CMD_LIMIT);
+    render_data->queue.keys = malloc(sizeof(*render_data->queue.keys) * RENDER_QUEUE_CMD_LIMIT);
+    render_data->queue.keys_temp = malloc(sizeof(*render_data->queue.keys_temp) * RENDER_QUEUE_CMD_LIMIT);
+
+    if (!render_data->queue.cmds || !render_data->queue.keys || !render_data->queue.keys_temp) {
+        fprintf(stderr, "Failed to allocate render queue buffers!\n");
+        return false;
+    }
+
+    {
+        int max_tex_units;
+        glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_tex_units);
+        render_data->batch_tex_slot_cnt = MIN(max_tex_units, RENDER_BATCH_TEX_SLOT_LIMIT);
+    }
 
-    render_data->batch_shader_prog = LoadRenderBatchShaderProg();
-    render_data->batch_gl_ids = GenRenderBatch();
+    if (!LoadRenderBatchShaderProgs(render_data->batch_shader_progs, render_data->batch_tex_slot_cnt, shader_prog_cache_dir)) {
+        fprintf(stderr, "Failed to load batch shader programs!\n");
+        return false;
+    }
+
+    render_data->batch_gl_ids = GenRenderBatch(render_data->batch_ring.region_size * RENDER_BATCH_RING_REGION_CNT);
 
     // Generate the pixel texture.
     {
@@ -86,12 +404,16 @@ bool InitPersRenderData(s_pers_render_data* const render_data, const s_vec_2d_i
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, px_data);
     }
 
+    // Generate the frame uniform buffer.
+    glGenBuffers(1, &render_data->frame_uniform_buf_gl_id);
+    glBindBuffer(GL_UNIFORM_BUFFER, render_data->frame_uniform_buf_gl_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(s_render_frame_uniforms), NULL, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, RENDER_FRAME_UNIFORM_BLOCK_BINDING, render_data->frame_uniform_buf_gl_id);
+
     //
     // Surfaces
     //
-    if (!InitRenderSurfaces(&render_data->surfs, display_size)) {
-        return false;
-    }
+    InitRenderSurfaces(&render_data->surfs);
 
     glGenVertexArrays(1, &render_data->surf_vert_array_gl_id);
     glBindVertexArray(render_data->surf_vert_array_gl_id);
@@ -107,7 +429,12 @@ bool InitPersRenderData(s_pers_render_data* const render_data, const s_vec_2d_i
             -1.0,  1.0, 0.0, 1.0
         };
 
-        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), &verts[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(verts) * RENDER_SURFACE_LIMIT, NULL, GL_DYNAMIC_DRAW);
+
+        for (int i = 0; i < RENDER_SURFACE_LIMIT; i++) {
+            glBufferSubData(GL_ARRAY_BUFFER, sizeof(verts) * i, sizeof(verts), &verts[0]);
+            render_data->surf_tex_coords_scales[i] = (s_vec_2d){1.0f, 1.0f};
+        }
     }
 
     glGenBuffers(1, &render_data->surf_elem_buf_gl_id);
@@ -133,112 +460,267 @@ bool InitPersRenderData(s_pers_render_data* const render_data, const s_vec_2d_i
     return true;
 }
 
+static void CleanRenderCmdListWorkers(s_render_cmd_list_workers* const workers) {
+    if (!workers->sync_inited) {
+        return;
+    }
+
+    LockMutex(&workers->mtx);
+    workers->quit = true;
+    BroadcastCond(&workers->job_cnd);
+    UnlockMutex(&workers->mtx);
+
+    for (int i = 0; i < workers->thread_cnt; i++) {
+        JoinThread(&workers->threads[i]);
+    }
+
+    CleanCond(&workers->done_cnd);
+    CleanCond(&workers->job_cnd);
+    CleanMutex(&workers->mtx);
+
+    ZeroOut(workers, sizeof(*workers));
+}
+
 void CleanPersRenderData(s_pers_render_data* const render_data) {
     assert(render_data);
 
+    free(render_data->queue.cmds);
+    free(render_data->queue.keys);
+    free(render_data->queue.keys_temp);
+
+    CleanRenderCmdListWorkers(&render_data->cmd_list_workers);
+
     glDeleteTextures(1, &render_data->px_tex_gl_id);
 
+    glDeleteBuffers(1, &render_data->frame_uniform_buf_gl_id);
+
+    CleanRenderSurfaces(&render_data->surfs);
+    glDeleteVertexArrays(1, &render_data->surf_vert_array_gl_id);
+    glDeleteBuffers(1, &render_data->surf_vert_buf_gl_id);
+    glDeleteBuffers(1, &render_data->surf_elem_buf_gl_id);
+
+    for (int i = 0; i < RENDER_BATCH_RING_REGION_CNT; i++) {
+        if (render_data->batch_ring.region_fences[i]) {
+            glDeleteSync(render_data->batch_ring.region_fences[i]);
+        }
+    }
+
     glDeleteVertexArrays(1, &render_data->batch_gl_ids.vert_array_gl_id);
-    glDeleteBuffers(1, &render_data->batch_gl_ids.vert_buf_gl_id);
+    glDeleteBuffers(1, &render_data->batch_gl_ids.quad_vert_buf_gl_id);
+    glDeleteBuffers(1, &render_data->batch_gl_ids.slot_buf_gl_id);
     glDeleteBuffers(1, &render_data->batch_gl_ids.elem_buf_gl_id);
 
-    glDeleteProgram(render_data->batch_shader_prog.gl_id);
+    for (int i = 0; i < RENDER_BATCH_SHADER_PROG_VARIANT_CNT; i++) {
+        glDeleteProgram(render_data->batch_shader_progs[i].gl_id);
+    }
+
 
     ZeroOut(render_data, sizeof(*render_data));
 }
 
-s_render_batch_shader_prog LoadRenderBatchShaderProg() {
-    const char* const vert_shader_src = "#version 430 core\n"
+// Loads every variant of the batch shader program up front, indexed by the features it covers.
+bool LoadRenderBatchShaderProgs(s_render_batch_shader_prog* const progs, const int tex_slot_cnt, const char* const cache_dir) {
+    assert(progs);
+    assert(tex_slot_cnt > 0 && tex_slot_cnt <= RENDER_BATCH_TEX_SLOT_LIMIT);
+
+    const char* const vert_shader_body_src =
         "layout (location = 0) in vec2 a_vert;\n"
         "layout (location = 1) in vec2 a_pos;\n"
         "layout (location = 2) in vec2 a_size;\n"
         "layout (location = 3) in float a_rot;\n"
-        "layout (location = 4) in vec2 a_tex_coord;\n"
-        "layout (location = 5) in vec4 a_blend;\n"
+        "layout (location = 4) in vec2 a_origin;\n"
+        "layout (location = 5) in vec4 a_tex_coords;\n"
+        "layout (location = 6) in vec4 a_blend;\n"
+        "layout (location = 7) in uint a_tex_slot;\n"
+        "layout (location = 8) in vec4 a_flash;\n"
+        "layout (location = 9) in uint a_segment;\n"
         "out vec2 v_tex_coord;\n"
         "out vec4 v_blend;\n"
-        "uniform mat4 u_view;\n"
-        "uniform mat4 u_proj;\n"
+        "out vec4 v_flash;\n"
+        "flat out uint v_tex_slot;\n"
+        "layout (std140) uniform FrameUniforms {\n"
+        "    mat4 u_proj;\n"
+        "    mat4 u_view;\n"
+        "    vec2 u_display_size;\n"
+        "    float u_time;\n"
+        "};\n"
         "void main() {\n"
-        "    float rot_cos = cos(a_rot);\n"
-        "    float rot_sin = -sin(a_rot);\n"
-        "    mat4 model = mat4(\n"
-        "        vec4(a_size.x * rot_cos, a_size.x * rot_sin, 0.0, 0.0),\n"
-        "        vec4(a_size.y * -rot_sin, a_size.y * rot_cos, 0.0, 0.0),\n"
-        "        vec4(0.0, 0.0, 1.0, 0.0),\n"
-        "        vec4(a_pos.x, a_pos.y, 0.0, 1.0));\n"
-        "    gl_Position = u_proj * u_view * model * vec4(a_vert, 0.0, 1.0);\n"
-        "    v_tex_coord = a_tex_coord;\n"
+        "    vec2 world_pos;\n"
+        "#ifndef NO_SEGMENT\n"
+        "    if (a_segment != 0u) {\n"
+        "        float seg_len_sq = dot(a_size, a_size);\n"
+        "        vec2 seg_dir = seg_len_sq > 0.0 ? a_size * inversesqrt(seg_len_sq) : vec2(0.0);\n"
+        "        float seg_miter = ((mix(a_origin.x, a_origin.y, a_vert.x) * 2.0) - 1.0) * MITER_LIMIT;\n"
+        "        world_pos = a_pos + (a_size * a_vert.x) + ((a_vert.y - 0.5) * a_rot * (vec2(-seg_dir.y, seg_dir.x) + (seg_dir * seg_miter)));\n"
+        "    } else\n"
+        "#endif\n"
+        "    {\n"
+        "        vec2 local_pos = (a_vert - a_origin) * a_size;\n"
+        "#ifdef NO_ROTATION\n"
+        "        world_pos = local_pos + a_pos;\n"
+        "#else\n"
+        "        float rot_cos = cos(a_rot);\n"
+        "        float rot_sin = -sin(a_rot);\n"
+        "        world_pos = vec2(\n"
+        "            (local_pos.x * rot_cos) - (local_pos.y * rot_sin),\n"
+        "            (local_pos.x * rot_sin) + (local_pos.y * rot_cos)) + a_pos;\n"
+        "#endif\n"
+        "    }\n"
+        "    gl_Position = u_proj * u_view * vec4(world_pos, 0.0, 1.0);\n"
+        "    v_tex_coord = mix(a_tex_coords.xy, a_tex_coords.zw, a_vert);\n"
         "    v_blend = a_blend;\n"
+        "    v_flash = a_flash;\n"
+        "    v_tex_slot = a_tex_slot;\n"
         "}";
 
-    const char* const frag_shader_src = "#version 430 core\n"
+    // Sampler arrays can only be indexed with dynamically uniform expressions, so we loop over the slots with a constant bound rather than indexing by the slot directly. An explicit LOD is used since implicit derivatives are undefined in non-uniform control flow; batch textures have no mipmaps anyway. Quads given RENDER_BATCH_TEX_SLOT_NONE match none of the slots and so are left untextured.
+    const char* const frag_shader_body_src =
         "in vec2 v_tex_coord;\n"
         "in vec4 v_blend;\n"
+        "in vec4 v_flash;\n"
+        "flat in uint v_tex_slot;\n"
         "out vec4 o_frag_color;\n"
-        "uniform sampler2D u_tex;\n"
+        "uniform sampler2D u_textures[TEX_SLOT_CNT];\n"
         "void main() {\n"
-        "    vec4 tex_color = texture(u_tex, v_tex_coord);\n"
+        "    vec4 tex_color = vec4(1.0);\n"
+        "#ifndef NO_TEXTURE\n"
+        "    for (int i = 0; i < TEX_SLOT_CNT; i++) {\n"
+        "        if (uint(i) == v_tex_slot) {\n"
+        "            tex_color = textureLod(u_textures[i], v_tex_coord, 0.0);\n"
+        "            break;\n"
+        "        }\n"
+        "    }\n"
+        "#endif\n"
         "    o_frag_color = tex_color * v_blend;\n"
+        "    o_frag_color.rgb = mix(o_frag_color.rgb, v_flash.rgb, v_flash.a);\n"
         "}";
 
-    s_render_batch_shader_prog prog = {0};
-    prog.gl_id = CreateShaderProgFromSrcs(vert_shader_src, frag_shader_src);
-    assert(prog.gl_id != 0);
+    // Each variant is picked out through defines placed ahead of the shared sources.
+    char vert_shader_srcs[RENDER_BATCH_SHADER_PROG_VARIANT_CNT][4096];
+    char frag_shader_srcs[RENDER_BATCH_SHADER_PROG_VARIANT_CNT][2048];
+    s_shader_prog_srcs srcs_list[RENDER_BATCH_SHADER_PROG_VARIANT_CNT];
+
+    for (int features = 0; features < RENDER_BATCH_SHADER_PROG_VARIANT_CNT; features++) {
+        char defines[256];
+
+        const int defines_len = snprintf(
+            defines,
+            sizeof(defines),
+            "#version 430 core\n#define TEX_SLOT_CNT %d\n#define MITER_LIMIT %f\n%s%s%s",
+            tex_slot_cnt,
+            RENDER_POLYLINE_MITER_LIMIT,
+            features & ek_render_batch_feature_rotation ? "" : "#define NO_ROTATION\n",
+            features & ek_render_batch_feature_texture ? "" : "#define NO_TEXTURE\n",
+            features & ek_render_batch_feature_segment ? "" : "#define NO_SEGMENT\n"
+        );
+
+        assert(defines_len > 0 && defines_len < (int)sizeof(defines));
+
+        const int vert_shader_src_len = snprintf(vert_shader_srcs[features], sizeof(vert_shader_srcs[features]), "%s%s", defines, vert_shader_body_src);
+        assert(vert_shader_src_len > 0 && vert_shader_src_len < (int)sizeof(vert_shader_srcs[features]));
+
+        const int frag_shader_src_len = snprintf(frag_shader_srcs[features], sizeof(frag_shader_srcs[features]), "%s%s", defines, frag_shader_body_src);
+        assert(frag_shader_src_len > 0 && frag_shader_src_len < (int)sizeof(frag_shader_srcs[features]));
+
+        srcs_list[features] = (s_shader_prog_srcs){.vert_src = vert_shader_srcs[features], .frag_src = frag_shader_srcs[features]};
+    }
+
+    t_gl_id gl_ids[RENDER_BATCH_SHADER_PROG_VARIANT_CNT];
+
+    if (!CreateShaderProgs(gl_ids, srcs_list, RENDER_BATCH_SHADER_PROG_VARIANT_CNT, cache_dir)) {
+        return false;
+    }
+
+    for (int features = 0; features < RENDER_BATCH_SHADER_PROG_VARIANT_CNT; features++) {
+        s_render_batch_shader_prog* const prog = &progs[features];
+
+        prog->gl_id = gl_ids[features];
+
+        BindFrameUniformBlock(prog->gl_id);
+
+        prog->textures_uniform_loc = glGetUniformLocation(prog->gl_id, "u_textures");
+
+        // Each sampler in the array reads from the texture unit matching its index. This is set without binding the program, so that whatever is bound is left alone.
+        if (prog->textures_uniform_loc != -1) {
+            int tex_units[RENDER_BATCH_TEX_SLOT_LIMIT];
 
-    prog.proj_uniform_loc = glGetUniformLocation(prog.gl_id, "u_proj");
-    prog.view_uniform_loc = glGetUniformLocation(prog.gl_id, "u_view");
-    prog.textures_uniform_loc = glGetUniformLocation(prog.gl_id, "u_textures");
+            for (int i = 0; i < tex_slot_cnt; i++) {
+                tex_units[i] = i;
+            }
+
+            glProgramUniform1iv(prog->gl_id, prog->textures_uniform_loc, tex_slot_cnt, tex_units);
+        }
+    }
 
-    return prog;
+    return true;
+}
+
+// Points the per-instance attributes of the bound vertex array at the slot buffer currently bound to GL_ARRAY_BUFFER.
+static void SetUpRenderBatchSlotAttribs(void) {
+    const GLsizei stride = sizeof(s_render_batch_slot);
+
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(s_render_batch_slot, pos));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(s_render_batch_slot, size));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(s_render_batch_slot, rot));
+    glVertexAttribPointer(4, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(s_render_batch_slot, origin));
+    glVertexAttribPointer(5, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(s_render_batch_slot, tex_coords));
+    glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(s_render_batch_slot, blend));
+    glVertexAttribIPointer(7, 1, GL_UNSIGNED_BYTE, stride, (void*)offsetof(s_render_batch_slot, tex_slot));
+    glVertexAttribPointer(8, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(s_render_batch_slot, flash));
+    glVertexAttribIPointer(9, 1, GL_UNSIGNED_BYTE, stride, (void*)offsetof(s_render_batch_slot, segment));
+
+    for (int i = 1; i <= 9; i++) {
+        glVertexAttribDivisor(i, 1);
+        glEnableVertexAttribArray(i);
+    }
 }
 
-s_render_batch_gl_ids GenRenderBatch() {
+s_render_batch_gl_ids GenRenderBatch(const int ring_size) {
+    assert(ring_size > 0);
+
     s_render_batch_gl_ids gl_ids = {0};
 
     glGenVertexArrays(1, &gl_ids.vert_array_gl_id);
     glBindVertexArray(gl_ids.vert_array_gl_id);
 
-    glGenBuffers(1, &gl_ids.vert_buf_gl_id);
-    glBindBuffer(GL_ARRAY_BUFFER, gl_ids.vert_buf_gl_id);
-    glBufferData(GL_ARRAY_BUFFER, RENDER_BATCH_SLOT_VERTS_SIZE * RENDER_BATCH_SLOT_CNT, NULL, GL_DYNAMIC_DRAW);
-
-    glGenBuffers(1, &gl_ids.elem_buf_gl_id);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gl_ids.elem_buf_gl_id);
+    // Generate the unit quad.
+    glGenBuffers(1, &gl_ids.quad_vert_buf_gl_id);
+    glBindBuffer(GL_ARRAY_BUFFER, gl_ids.quad_vert_buf_gl_id);
 
-    uint16_t* const indices = malloc(sizeof(uint16_t) * RENDER_BATCH_SLOT_ELEM_CNT * RENDER_BATCH_SLOT_CNT);
+    {
+        const float verts[] = {
+            0.0f, 0.0f,
+            1.0f, 0.0f,
+            1.0f, 1.0f,
+            0.0f, 1.0f
+        };
 
-    for (int i = 0; i < RENDER_BATCH_SLOT_CNT; ++i) {
-        indices[(i * 6) + 0] = (uint16_t)((i * 4) + 0);
-        indices[(i * 6) + 1] = (uint16_t)((i * 4) + 1);
-        indices[(i * 6) + 2] = (uint16_t)((i * 4) + 2);
-        indices[(i * 6) + 3] = (uint16_t)((i * 4) + 2);
-        indices[(i * 6) + 4] = (uint16_t)((i * 4) + 3);
-        indices[(i * 6) + 5] = (uint16_t)((i * 4) + 0);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
     }
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * RENDER_BATCH_SLOT_ELEM_CNT * RENDER_BATCH_SLOT_CNT, indices, GL_STATIC_DRAW);
-    free(indices);
-
-    const GLsizei stride = sizeof(float) * RENDER_BATCH_SHADER_PROG_VERT_CNT;
-
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 0));
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void*)0);
     glEnableVertexAttribArray(0);
 
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 2));
-    glEnableVertexAttribArray(1);
+    glGenBuffers(1, &gl_ids.elem_buf_gl_id);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gl_ids.elem_buf_gl_id);
+
+    {
+        const uint16_t indices[RENDER_BATCH_SLOT_ELEM_CNT] = {
+            0, 1, 2,
+            2, 3, 0
+        };
 
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 4));
-    glEnableVertexAttribArray(2);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    }
 
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 6));
-    glEnableVertexAttribArray(3);
+    // Generate the slot ring, with one slot consumed per instance.
+    glGenBuffers(1, &gl_ids.slot_buf_gl_id);
+    glBindBuffer(GL_ARRAY_BUFFER, gl_ids.slot_buf_gl_id);
+    glBufferData(GL_ARRAY_BUFFER, ring_size, NULL, GL_STREAM_DRAW);
 
-    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 7));
-    glEnableVertexAttribArray(4);
+    SetUpRenderBatchSlotAttribs();
 
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 9));
-    glEnableVertexAttribArray(5);
+    glBindVertexArray(0);
 
     return gl_ids;
 }
@@ -466,460 +948,3171 @@ void UnloadFonts(s_fonts* const fonts) {
     ZeroOut(fonts, sizeof(*fonts));
 }
 
-bool LoadShaderProgsFromFiles(s_shader_progs* const progs, s_mem_arena* const mem_arena, const int prog_cnt, const t_shader_prog_index_to_file_paths prog_index_to_fps, s_mem_arena* const temp_mem_arena) {
-    assert(progs);
-    assert(IsZero(progs, sizeof(*progs)));
-    assert(mem_arena);
-    assert(prog_cnt > 0);
-    assert(prog_index_to_fps);
-    assert(temp_mem_arena);
-
-    progs->gl_ids = MEM_ARENA_PUSH_TYPE_MANY(mem_arena, t_gl_id, prog_cnt);
+static uint32_t HashShaderProgUniformName(const char* const name) {
+    // FNV-1a.
+    uint32_t hash = 2166136261u;
 
-    if (!progs->gl_ids) {
-        return false;
+    for (int i = 0; name[i]; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
     }
 
-    progs->cnt = prog_cnt;
+    return hash;
+}
 
-    for (int i = 0; i < prog_cnt; i++) {
-        const s_shader_prog_file_paths fps = prog_index_to_fps(i);
+// Returns the index of the uniform with the given name, or -1 if there isn't one.
+static int FindShaderProgUniform(const s_shader_prog_uniforms* const uniforms, const char* const name) {
+    const uint32_t mask = SHADER_PROG_UNIFORM_HASH_TABLE_SIZE - 1;
 
-        progs->gl_ids[i] = CreateShaderProgFromFiles(fps, temp_mem_arena);
+    // The table is never full, so this always hits an empty entry eventually.
+    for (uint32_t i = HashShaderProgUniformName(name) & mask; ; i = (i + 1) & mask) {
+        const int index = uniforms->hash_table[i];
 
-        if (!progs->gl_ids[i]) {
-            return false;
+        if (index == -1) {
+            return -1;
         }
-    }
 
-    return true;
+        if (strcmp(uniforms->names[index], name) == 0) {
+            return index;
+        }
+    }
 }
 
-void UnloadShaderProgs(s_shader_progs* const progs) {
-    assert(progs);
+// Returns false if the uniform isn't of a type that we can set.
+static bool ToShaderProgUniformValueType(const GLenum gl_type, e_shader_prog_uniform_value_type* const type) {
+    switch (gl_type) {
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+            *type = ek_shader_prog_uniform_value_type_int;
+            return true;
 
-    for (int i = 0; i < progs->cnt; i++) {
-        glDeleteProgram(progs->gl_ids[i]);
-    }
+        case GL_FLOAT:
+            *type = ek_shader_prog_uniform_value_type_float;
+            return true;
 
-    ZeroOut(progs, sizeof(*progs));
-}
+        case GL_FLOAT_VEC2:
+            *type = ek_shader_prog_uniform_value_type_v2;
+            return true;
 
-void BeginRendering(s_rendering_state* const state) {
-    assert(state);
-    ZeroOut(state, sizeof(*state));
-    InitIdenMatrix4x4(&state->view_mat);
-}
+        case GL_FLOAT_VEC3:
+            *type = ek_shader_prog_uniform_value_type_v3;
+            return true;
 
-void RenderClear(const s_color col) {
-    assert(IsColorValid(col));
+        case GL_FLOAT_VEC4:
+            *type = ek_shader_prog_uniform_value_type_v4;
+            return true;
 
-    glClearColor(col.r, col.g, col.b, col.a);
-    glClear(GL_COLOR_BUFFER_BIT);
+        case GL_FLOAT_MAT4:
+            *type = ek_shader_prog_uniform_value_type_mat4x4;
+            return true;
+
+        default:
+            return false;
+    }
 }
 
-void Render(const s_rendering_context* const context, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend) {
-    assert(IsOriginValid(origin));
-    assert(IsColorValid(blend));
+static bool ReflectShaderProgUniforms(s_shader_prog_uniforms* const uniforms, const t_gl_id prog_gl_id) {
+    assert(uniforms);
+    assert(IsZero(uniforms, sizeof(*uniforms)));
+    assert(prog_gl_id != 0);
 
-    s_rendering_state* const state = context->state;
+    uniforms->prog_gl_id = prog_gl_id;
+    memset(uniforms->hash_table, -1, sizeof(uniforms->hash_table));
 
-    if (state->batch_slots_used_cnt == 0) {
-        state->batch_tex_gl_id = tex_gl_id;
-    } else if (state->batch_slots_used_cnt == RENDER_BATCH_SLOT_CNT || tex_gl_id != state->batch_tex_gl_id) {
-        Flush(context);
-        Render(context, tex_gl_id, tex_coords, pos, size, origin, rot, blend);
-        return;
-    }
+    GLint active_cnt;
+    glGetProgramInterfaceiv(prog_gl_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &active_cnt);
 
-    const int slot_index = state->batch_slots_used_cnt;
-    float* const slot_verts = state->batch_slot_verts[slot_index];
-
-    slot_verts[0] = 0.0f - origin.x;
-    slot_verts[1] = 0.0f - origin.y;
-    slot_verts[2] = pos.x;
-    slot_verts[3] = pos.y;
-    slot_verts[4] = size.x;
-    slot_verts[5] = size.y;
-    slot_verts[6] = rot;
-    slot_verts[7] = tex_coords.left;
-    slot_verts[8] = tex_coords.top;
-    slot_verts[9] = blend.r;
-    slot_verts[10] = blend.g;
-    slot_verts[11] = blend.b;
-    slot_verts[12] = blend.a;
-
-    slot_verts[13] = 1.0f - origin.x;
-    slot_verts[14] = 0.0f - origin.y;
-    slot_verts[15] = pos.x;
-    slot_verts[16] = pos.y;
-    slot_verts[17] = size.x;
-    slot_verts[18] = size.y;
-    slot_verts[19] = rot;
-    slot_verts[20] = tex_coords.right;
-    slot_verts[21] = tex_coords.top;
-    slot_verts[22] = blend.r;
-    slot_verts[23] = blend.g;
-    slot_verts[24] = blend.b;
-    slot_verts[25] = blend.a;
-
-    slot_verts[26] = 1.0f - origin.x;
-    slot_verts[27] = 1.0f - origin.y;
-    slot_verts[28] = pos.x;
-    slot_verts[29] = pos.y;
-    slot_verts[30] = size.x;
-    slot_verts[31] = size.y;
-    slot_verts[32] = rot;
-    slot_verts[33] = tex_coords.right;
-    slot_verts[34] = tex_coords.bottom;
-    slot_verts[35] = blend.r;
-    slot_verts[36] = blend.g;
-    slot_verts[37] = blend.b;
-    slot_verts[38] = blend.a;
-
-    slot_verts[39] = 0.0f - origin.x;
-    slot_verts[40] = 1.0f - origin.y;
-    slot_verts[41] = pos.x;
-    slot_verts[42] = pos.y;
-    slot_verts[43] = size.x;
-    slot_verts[44] = size.y;
-    slot_verts[45] = rot;
-    slot_verts[46] = tex_coords.left;
-    slot_verts[47] = tex_coords.bottom;
-    slot_verts[48] = blend.r;
-    slot_verts[49] = blend.g;
-    slot_verts[50] = blend.b;
-    slot_verts[51] = blend.a;
+    for (int i = 0; i < active_cnt; i++) {
+        const GLenum props[] = {GL_TYPE, GL_LOCATION, GL_BLOCK_INDEX, GL_NAME_LENGTH};
+        GLint prop_vals[4];
+        glGetProgramResourceiv(prog_gl_id, GL_UNIFORM, i, 4, props, 4, NULL, prop_vals);
 
-    state->batch_slots_used_cnt++;
-}
+        // Those in uniform blocks are set through buffers instead.
+        if (prop_vals[1] == -1 || prop_vals[2] != -1) {
+            continue;
+        }
 
-void RenderTexture(const s_rendering_context* const context, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend) {
-    assert(tex_index >= 0 && tex_index < textures->cnt);
-    assert(IsOriginValid(origin));
-    assert(IsColorValid(blend));
+        e_shader_prog_uniform_value_type type;
 
-    const s_vec_2d_i tex_size = textures->sizes[tex_index];
-    const s_rect_edges tex_coords = CalcTextureCoords(src_rect, tex_size);
+        if (!ToShaderProgUniformValueType((GLenum)prop_vals[0], &type)) {
+            continue;
+        }
 
-    const s_vec_2d size_scaled = {src_rect.width * scale.x, src_rect.height * scale.y};
+        if (uniforms->cnt == SHADER_PROG_UNIFORM_LIMIT) {
+            fprintf(stderr, "Shader program has too many uniforms!\n");
+            return false;
+        }
+
+        if (prop_vals[3] > SHADER_PROG_UNIFORM_NAME_SIZE) {
+            fprintf(stderr, "Shader program uniform name is too long!\n");
+            return false;
+        }
+
+        char* const name = uniforms->names[uniforms->cnt];
+        glGetProgramResourceName(prog_gl_id, GL_UNIFORM, i, SHADER_PROG_UNIFORM_NAME_SIZE, NULL, name);
+
+        // Arrays are reported with a "[0]" suffix, which is dropped so that they can be looked up by their plain names.
+        char* const bracket = strchr(name, '[');
+
+        if (bracket) {
+            *bracket = '\0';
+        }
+
+        uniforms->locs[uniforms->cnt] = prop_vals[1];
+        uniforms->types[uniforms->cnt] = type;
 
-    Render(context, textures->gl_ids[tex_index], tex_coords, pos, size_scaled, origin, rot, blend);
+        const uint32_t mask = SHADER_PROG_UNIFORM_HASH_TABLE_SIZE - 1;
+        uint32_t entry_index = HashShaderProgUniformName(name) & mask;
+
+        while (uniforms->hash_table[entry_index] != -1) {
+            entry_index = (entry_index + 1) & mask;
+        }
+
+        uniforms->hash_table[entry_index] = (int8_t)uniforms->cnt;
+
+        uniforms->cnt++;
+    }
+
+    return true;
 }
 
-bool RenderStr(
-    const s_rendering_context* const context,
-    const char* const str,
-    const int font_index,
-    const s_fonts* const fonts,
-    const s_vec_2d pos,
-    const e_str_hor_align hor_align,
-    const e_str_ver_align ver_align,
-    const s_color blend,
-    s_mem_arena* const temp_mem_arena
-) {
+// The cache directory is optional, with nothing being cached if it's NULL.
+bool LoadShaderProgsFromFiles(s_shader_progs* const progs, s_mem_arena* const mem_arena, const int prog_cnt, const t_shader_prog_index_to_file_paths prog_index_to_fps, const char* const cache_dir, s_mem_arena* const temp_mem_arena) {
+    assert(progs);
+    assert(IsZero(progs, sizeof(*progs)));
+    assert(mem_arena);
+    assert(prog_cnt > 0);
+    assert(prog_index_to_fps);
+    assert(temp_mem_arena);
+
+    progs->gl_ids = MEM_ARENA_PUSH_TYPE_MANY(mem_arena, t_gl_id, prog_cnt);
+
+    if (!progs->gl_ids) {
+        return false;
+    }
+
+    progs->uniforms = MEM_ARENA_PUSH_TYPE_MANY(mem_arena, s_shader_prog_uniforms, prog_cnt);
+
+    if (!progs->uniforms) {
+        return false;
+    }
+
+    progs->cnt = prog_cnt;
+
+    // All sources are read in up front so that the programs can be created together.
+    s_shader_prog_srcs* const srcs_list = MEM_ARENA_PUSH_TYPE_MANY(temp_mem_arena, s_shader_prog_srcs, prog_cnt);
+
+    if (!srcs_list) {
+        return false;
+    }
+
+    for (int i = 0; i < prog_cnt; i++) {
+        const s_shader_prog_file_paths fps = prog_index_to_fps(i);
+
+        srcs_list[i].vert_src = (const char*)PushEntireFileContents(fps.vs_fp, temp_mem_arena, true);
+
+        if (!srcs_list[i].vert_src) {
+            return false;
+        }
+
+        srcs_list[i].frag_src = (const char*)PushEntireFileContents(fps.fs_fp, temp_mem_arena, true);
+
+        if (!srcs_list[i].frag_src) {
+            return false;
+        }
+    }
+
+    if (!CreateShaderProgs(progs->gl_ids, srcs_list, prog_cnt, cache_dir)) {
+        return false;
+    }
+
+    for (int i = 0; i < prog_cnt; i++) {
+        BindFrameUniformBlock(progs->gl_ids[i]);
+
+        if (!ReflectShaderProgUniforms(&progs->uniforms[i], progs->gl_ids[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Meant to be called once up front, with the handle being kept around for setting the uniform.
+s_shader_prog_uniform_handle GetShaderProgUniformHandle(const s_shader_progs* const progs, const int prog_index, const char* const name) {
+    assert(progs);
+    assert(prog_index >= 0 && prog_index < progs->cnt);
+    assert(name);
+
+    s_shader_prog_uniforms* const uniforms = &progs->uniforms[prog_index];
+
+    const int index = FindShaderProgUniform(uniforms, name);
+    assert(index != -1 && "Failed to find shader uniform!");
+
+    return (s_shader_prog_uniform_handle){
+        .uniforms = uniforms,
+        .index = index,
+        .type = uniforms->types[index]
+    };
+}
+
+void UnloadShaderProgs(s_shader_progs* const progs) {
+    assert(progs);
+
+    for (int i = 0; i < progs->cnt; i++) {
+        glDeleteProgram(progs->gl_ids[i]);
+    }
+
+    ZeroOut(progs, sizeof(*progs));
+}
+
+void BeginRendering(s_rendering_state* const state) {
+    assert(state);
+    ZeroOut(state, sizeof(*state));
+    InitIdenMatrix4x4(&state->view_mat);
+    state->frame_uniforms_dirty = true;
+}
+
+void SetViewMatrix(const s_rendering_context* const context, const t_matrix_4x4* const mat) {
     assert(context);
-    assert(str);
-    assert(fonts);
+    assert(mat);
+
+    // Whatever has been rendered so far needs to go out with the previous view matrix.
+    Flush(context);
+
+    memcpy(context->state->view_mat, *mat, sizeof(context->state->view_mat));
+    context->state->frame_uniforms_dirty = true;
+}
+
+static void UploadFrameUniforms(const s_rendering_context* const context) {
+    s_render_frame_uniforms uniforms = {
+        .display_size = {(float)context->display_size.x, (float)context->display_size.y},
+        .time = context->time
+    };
+
+    if (context->state->virtual_res_scale == 0) {
+        InitOrthoMatrix4x4(&uniforms.proj_mat, 0.0f, (float)context->display_size.x, (float)context->display_size.y, 0.0f, -1.0f, 1.0f);
+    } else {
+        // The surface of a virtual resolution pass has a margin of a virtual pixel on each side.
+        const float scale = (float)context->state->virtual_res_scale;
+        const s_vec_2d_i surf_size = context->pers->surfs.sizes[context->state->virtual_res_surf_index];
+        InitOrthoMatrix4x4(&uniforms.proj_mat, -scale, (surf_size.x - 1) * scale, (surf_size.y - 1) * scale, -scale, -1.0f, 1.0f);
+    }
+    memcpy(uniforms.view_mat, context->state->view_mat, sizeof(uniforms.view_mat));
+
+    // The buffer is orphaned rather than updated in place, so we never wait on draws still reading the old contents.
+    glBindBuffer(GL_UNIFORM_BUFFER, context->pers->frame_uniform_buf_gl_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(uniforms), &uniforms, GL_STREAM_DRAW);
+
+    context->state->frame_uniforms_dirty = false;
+    context->state->frame_uniforms_display_size = context->display_size;
+}
+
+void RenderClear(const s_color col) {
+    assert(IsColorValid(col));
+
+    glClearColor(col.r, col.g, col.b, col.a);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+static uint16_t ToUnorm16(const float val) {
+    assert(val >= 0.0f && val <= 1.0f);
+    return (uint16_t)((val * 65535.0f) + 0.5f);
+}
+
+static uint8_t ToUnorm8(const float val) {
+    assert(val >= 0.0f && val <= 1.0f);
+    return (uint8_t)((val * 255.0f) + 0.5f);
+}
+
+static void WaitForRenderBatchRingRegion(s_render_batch_ring* const ring, const int region_index) {
+    assert(ring);
+    assert(region_index >= 0 && region_index < RENDER_BATCH_RING_REGION_CNT);
+
+    GLsync* const fence = &ring->region_fences[region_index];
+
+    if (!*fence) {
+        return;
+    }
+
+    GLenum wait_res;
+
+    do {
+        wait_res = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, RENDER_BATCH_RING_FENCE_TIMEOUT);
+    } while (wait_res == GL_TIMEOUT_EXPIRED);
+
+    assert(wait_res != GL_WAIT_FAILED);
+
+    glDeleteSync(*fence);
+    *fence = NULL;
+}
+
+// Maps the range of the batch ring that the next batch will be written into. The range is mapped unsynchronised, as the region fences already guarantee that the GPU is done with it.
+static s_render_batch_slot* MapRenderBatchRing(s_pers_render_data* const pers, s_gl_state_cache* const gl_state_cache) {
+    assert(pers);
+    assert(gl_state_cache);
+
+    s_render_batch_ring* const ring = &pers->batch_ring;
+
+    const int region_end = (ring->region_index + 1) * ring->region_size;
+
+    if (ring->write_offs + ring->batch_size > region_end) {
+        // The current region cannot hold another full batch, so fence it off and move onto the next.
+        ring->region_fences[ring->region_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ring->region_index = (ring->region_index + 1) % RENDER_BATCH_RING_REGION_CNT;
+        ring->write_offs = ring->region_index * ring->region_size;
+
+        WaitForRenderBatchRingRegion(ring, ring->region_index);
+    }
+
+    BindArrayBuf(gl_state_cache, pers->batch_gl_ids.slot_buf_gl_id);
+
+    return glMapBufferRange(
+        GL_ARRAY_BUFFER,
+        ring->write_offs,
+        ring->batch_size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
+    );
+}
+
+static void FlushBatch(const s_rendering_context* const context);
+
+// Finds the texture slot to use, assigning the texture a new one if needed. We only need to flush if we run out of texture slots.
+static int AcquireBatchTexSlot(const s_rendering_context* const context, const t_gl_id tex_gl_id) {
+    s_rendering_state* const state = context->state;
+
+    // Sampling the pixel texture is the same as not sampling at all, so solid colour quads can go in any batch.
+    if (tex_gl_id == context->pers->px_tex_gl_id) {
+        return RENDER_BATCH_TEX_SLOT_NONE;
+    }
+
+    for (int i = state->batch_tex_slots_used_cnt - 1; i >= 0; i--) {
+        if (state->batch_tex_gl_ids[i] == tex_gl_id) {
+            return i;
+        }
+    }
+
+    if (state->batch_tex_slots_used_cnt == context->pers->batch_tex_slot_cnt) {
+        FlushBatch(context);
+    }
+
+    const int tex_slot = state->batch_tex_slots_used_cnt;
+    state->batch_tex_gl_ids[tex_slot] = tex_gl_id;
+    state->batch_tex_slots_used_cnt++;
+
+    return tex_slot;
+}
+
+static void MapBatchIfEmpty(const s_rendering_context* const context) {
+    s_rendering_state* const state = context->state;
+
+    if (state->batch_slots_used_cnt == 0) {
+        state->batch_slots = MapRenderBatchRing(context->pers, &state->gl_state_cache);
+        assert(state->batch_slots);
+    }
+}
+
+static e_render_batch_features BatchSlotFeatures(const s_rendering_context* const context, const t_gl_id tex_gl_id, const s_render_batch_slot* const slot) {
+    e_render_batch_features features = 0;
+
+    // The rotation of a segment holds its width instead.
+    if (slot->segment) {
+        features |= ek_render_batch_feature_segment;
+    } else if (slot->rot != 0.0f) {
+        features |= ek_render_batch_feature_rotation;
+    }
+
+    // Quads drawn with the pixel texture would come out the same without sampling it.
+    if (tex_gl_id != context->pers->px_tex_gl_id) {
+        features |= ek_render_batch_feature_texture;
+    }
+
+    return features;
+}
+
+static void SubmitBatchSlot(const s_rendering_context* const context, const t_gl_id tex_gl_id, s_render_batch_slot slot) {
+    s_rendering_state* const state = context->state;
+
+    if (state->batch_slots_used_cnt == context->pers->batch_slot_cnt) {
+        FlushBatch(context);
+    }
+
+    slot.tex_slot = (uint8_t)AcquireBatchTexSlot(context, tex_gl_id); // Might flush too.
+
+    MapBatchIfEmpty(context);
+
+    state->batch_features |= BatchSlotFeatures(context, tex_gl_id, &slot);
+
+    state->batch_slots[state->batch_slots_used_cnt] = slot;
+    state->batch_slots_used_cnt++;
+}
+
+// Sorts the keys in place. Keys are appended in submission order, so a stable sort on
+// the high 32 bits alone is enough to get them fully ordered.
+static void RadixSortRenderQueueKeys(uint64_t* const keys, uint64_t* const keys_temp, const int cnt) {
+    assert(keys);
+    assert(keys_temp);
+    assert(cnt > 0);
+
+    uint64_t* src = keys;
+    uint64_t* dest = keys_temp;
+
+    for (int shift = 32; shift < 64; shift += 8) {
+        int digit_offsets[256] = {0};
+
+        for (int i = 0; i < cnt; i++) {
+            digit_offsets[(src[i] >> shift) & 0xFF]++;
+        }
+
+        // Skip the pass if every key has the same digit, which is common for the layer and depth bytes.
+        if (digit_offsets[(src[0] >> shift) & 0xFF] == cnt) {
+            continue;
+        }
+
+        int offs = 0;
+
+        for (int i = 0; i < 256; i++) {
+            const int digit_cnt = digit_offsets[i];
+            digit_offsets[i] = offs;
+            offs += digit_cnt;
+        }
+
+        for (int i = 0; i < cnt; i++) {
+            const int digit = (src[i] >> shift) & 0xFF;
+            dest[digit_offsets[digit]] = src[i];
+            digit_offsets[digit]++;
+        }
+
+        uint64_t* const src_last = src;
+        src = dest;
+        dest = src_last;
+    }
+
+    if (src != keys) {
+        memcpy(keys, src, sizeof(*keys) * cnt);
+    }
+}
+
+static void SubmitRenderQueue(const s_rendering_context* const context) {
+    s_rendering_state* const state = context->state;
+    const s_render_queue* const queue = &context->pers->queue;
+
+    if (state->queue_cmd_cnt == 0) {
+        return;
+    }
+
+    RadixSortRenderQueueKeys(queue->keys, queue->keys_temp, state->queue_cmd_cnt);
+
+    for (int i = 0; i < state->queue_cmd_cnt; i++) {
+        const s_render_cmd* const cmd = &queue->cmds[queue->keys[i] & 0xFFFFFFFF];
+        SubmitBatchSlot(context, cmd->tex_gl_id, cmd->slot);
+    }
+
+    state->queue_cmd_cnt = 0;
+}
+
+// Keys are sorted on their high 32 bits, from the top: the layer, the depth, and then
+// either the command index (if stable) or the batch program variant and the texture.
+// The low 32 bits hold the command index.
+static uint64_t GenRenderQueueKeyBase(const s_rendering_state* const state) {
+    return ((uint64_t)state->layer << 56) | ((uint64_t)state->depth << 48);
+}
+
+static uint64_t GenRenderQueueKey(const s_rendering_context* const context, const uint64_t key_base, const t_gl_id tex_gl_id, const s_render_batch_slot* const slot, const int cmd_index) {
+    if (context->state->queue_stable) {
+        return key_base | ((uint64_t)cmd_index << 32) | (uint64_t)cmd_index;
+    }
+
+    const uint64_t prog_key = (uint64_t)BatchSlotFeatures(context, tex_gl_id, slot) << 44;
+    const uint64_t tex_key = (uint64_t)(tex_gl_id & 0xFFF) << 32;
+
+    return key_base | prog_key | tex_key | (uint64_t)cmd_index;
+}
+
+// Enqueues a command for each of the slots, all sharing the one texture.
+static void EnqueueRenderCmds(const s_rendering_context* const context, const t_gl_id tex_gl_id, const s_render_batch_slot* const slots, const int cnt) {
+    s_rendering_state* const state = context->state;
+    const s_render_queue* const queue = &context->pers->queue;
+
+    const uint64_t key_base = GenRenderQueueKeyBase(state);
+
+    int enqueued_cnt = 0;
+
+    while (enqueued_cnt < cnt) {
+        if (state->queue_cmd_cnt == RENDER_QUEUE_CMD_LIMIT) {
+            SubmitRenderQueue(context);
+        }
+
+        const int chunk_cnt = MIN(cnt - enqueued_cnt, RENDER_QUEUE_CMD_LIMIT - state->queue_cmd_cnt);
+
+        for (int i = 0; i < chunk_cnt; i++) {
+            const int cmd_index = state->queue_cmd_cnt + i;
+
+            queue->cmds[cmd_index] = (s_render_cmd){
+                .slot = slots[enqueued_cnt + i],
+                .tex_gl_id = tex_gl_id
+            };
+
+            queue->keys[cmd_index] = GenRenderQueueKey(context, key_base, tex_gl_id, &slots[enqueued_cnt + i], cmd_index);
+        }
+
+        state->queue_cmd_cnt += chunk_cnt;
+        enqueued_cnt += chunk_cnt;
+    }
+}
+
+// Enqueues a copy of each of the commands, which can have different textures.
+// The commands are copied in a chunk at a time rather than one by one.
+static void EnqueueRenderCmdArray(const s_rendering_context* const context, const s_render_cmd* const cmds, const int cnt) {
+    s_rendering_state* const state = context->state;
+    const s_render_queue* const queue = &context->pers->queue;
+
+    const uint64_t key_base = GenRenderQueueKeyBase(state);
+
+    int enqueued_cnt = 0;
+
+    while (enqueued_cnt < cnt) {
+        if (state->queue_cmd_cnt == RENDER_QUEUE_CMD_LIMIT) {
+            SubmitRenderQueue(context);
+        }
+
+        const int chunk_cnt = MIN(cnt - enqueued_cnt, RENDER_QUEUE_CMD_LIMIT - state->queue_cmd_cnt);
+
+        memcpy(&queue->cmds[state->queue_cmd_cnt], &cmds[enqueued_cnt], sizeof(*cmds) * chunk_cnt);
+
+        for (int i = 0; i < chunk_cnt; i++) {
+            const s_render_cmd* const cmd = &cmds[enqueued_cnt + i];
+            const int cmd_index = state->queue_cmd_cnt + i;
+
+            queue->keys[cmd_index] = GenRenderQueueKey(context, key_base, cmd->tex_gl_id, &cmd->slot, cmd_index);
+        }
+
+        state->queue_cmd_cnt += chunk_cnt;
+        enqueued_cnt += chunk_cnt;
+    }
+}
+
+static void EnqueueRenderCmd(const s_rendering_context* const context, const t_gl_id tex_gl_id, const s_render_batch_slot slot) {
+    EnqueueRenderCmds(context, tex_gl_id, &slot, 1);
+}
+
+static s_render_batch_slot GenRenderBatchSlot(const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend, const s_color flash) {
+    assert(IsOriginValid(origin));
     assert(IsColorValid(blend));
+    assert(IsColorValid(flash));
+
+    return (s_render_batch_slot){
+        .pos = pos,
+        .size = size,
+        .rot = rot,
+        .origin = {ToUnorm16(origin.x), ToUnorm16(origin.y)},
+        .tex_coords = {ToUnorm16(tex_coords.left), ToUnorm16(tex_coords.top), ToUnorm16(tex_coords.right), ToUnorm16(tex_coords.bottom)},
+        .blend = {ToUnorm8(blend.r), ToUnorm8(blend.g), ToUnorm8(blend.b), ToUnorm8(blend.a)},
+        .flash = {ToUnorm8(flash.r), ToUnorm8(flash.g), ToUnorm8(flash.b), ToUnorm8(flash.a)}
+    };
+}
+
+void Render(const s_rendering_context* const context, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend) {
+    RenderFlashed(context, tex_gl_id, tex_coords, pos, size, origin, rot, blend, (s_color){0});
+}
+
+// The flash is applied after the blend, with its alpha determining how far the sprite colour is pushed towards the flash colour. The sprite alpha is left as is.
+void RenderFlashed(const s_rendering_context* const context, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend, const s_color flash) {
+    // Fill in the slot locally first, so that the mapped memory only ever gets written to sequentially.
+    const s_render_batch_slot slot = GenRenderBatchSlot(tex_coords, pos, size, origin, rot, blend, flash);
+
+    if (context->state->queue_active) {
+        EnqueueRenderCmd(context, tex_gl_id, slot);
+    } else {
+        SubmitBatchSlot(context, tex_gl_id, slot);
+    }
+}
+
+static void ColorToUnorm8x4(const s_color col, uint8_t out[4]) {
+    assert(IsColorValid(col));
+
+#ifdef RENDER_USE_SSE2
+    const __m128 scaled = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&col.r), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+    const __m128i ints = _mm_cvttps_epi32(scaled);
+    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(ints, ints), ints);
+    const int packed_bits = _mm_cvtsi128_si32(packed);
+    memcpy(out, &packed_bits, 4);
+#else
+    out[0] = ToUnorm8(col.r);
+    out[1] = ToUnorm8(col.g);
+    out[2] = ToUnorm8(col.b);
+    out[3] = ToUnorm8(col.a);
+#endif
+}
+
+#ifdef RENDER_USE_SSE2
+// Converts four colours at once, writing each out to where it's pointed to.
+static void ColorsToUnorm8x4(const s_color* const cols, uint8_t* const outs[4]) {
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    __m128i ints[4];
+
+    for (int i = 0; i < 4; i++) {
+        assert(IsColorValid(cols[i]));
+        ints[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cols[i].r), scale), half));
+    }
+
+    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(ints[0], ints[1]), _mm_packs_epi32(ints[2], ints[3]));
+
+    uint32_t packed_words[4];
+    _mm_storeu_si128((__m128i*)packed_words, packed);
+
+    for (int i = 0; i < 4; i++) {
+        memcpy(outs[i], &packed_words[i], 4);
+    }
+}
+#endif
+
+static s_render_batch_slot GenBulkBatchSlot(const s_render_batch_slot* const base_slot, const s_render_bulk_input* const input, const int index) {
+    s_render_batch_slot slot = *base_slot;
+
+    slot.pos = input->positions[index];
+
+    if (input->scales) {
+        slot.size = (s_vec_2d){base_slot->size.x * input->scales[index].x, base_slot->size.y * input->scales[index].y};
+    }
+
+    if (input->rots) {
+        slot.rot = input->rots[index];
+    }
+
+    if (input->blends) {
+        ColorToUnorm8x4(input->blends[index], slot.blend);
+    }
+
+    if (input->flashes) {
+        ColorToUnorm8x4(input->flashes[index], slot.flash);
+    }
+
+    return slot;
+}
+
+// The slots can be in write-combined memory, so each is built locally from the base slot and
+// written out whole, in order. With SSE2, they're built four at a time.
+static void FillBulkBatchSlots(s_render_batch_slot* const slots, const s_render_batch_slot* const base_slot, const s_render_bulk_input* const input, const int begin, const int cnt) {
+    int i = 0;
+
+#ifdef RENDER_USE_SSE2
+    // Slots start with the position followed by the size, so each slot gets both in a single store.
+    assert(offsetof(s_render_batch_slot, size) == offsetof(s_render_batch_slot, pos) + sizeof(s_vec_2d));
+
+    const __m128 base_sizes = _mm_setr_ps(base_slot->size.x, base_slot->size.y, base_slot->size.x, base_slot->size.y);
+
+    for (; i + 4 <= cnt; i += 4) {
+        const int index = begin + i;
+
+        s_render_batch_slot group[4] = {*base_slot, *base_slot, *base_slot, *base_slot};
+
+        for (int j = 0; j < 4; j += 2) {
+            const __m128 poses = _mm_loadu_ps(&input->positions[index + j].x);
+            const __m128 sizes = input->scales ? _mm_mul_ps(_mm_loadu_ps(&input->scales[index + j].x), base_sizes) : base_sizes;
+
+            _mm_storeu_ps(&group[j].pos.x, _mm_movelh_ps(poses, sizes));
+            _mm_storeu_ps(&group[j + 1].pos.x, _mm_movehl_ps(sizes, poses));
+        }
+
+        if (input->rots) {
+            for (int j = 0; j < 4; j++) {
+                group[j].rot = input->rots[index + j];
+            }
+        }
+
+        if (input->blends) {
+            ColorsToUnorm8x4(&input->blends[index], (uint8_t* [4]){group[0].blend, group[1].blend, group[2].blend, group[3].blend});
+        }
+
+        if (input->flashes) {
+            ColorsToUnorm8x4(&input->flashes[index], (uint8_t* [4]){group[0].flash, group[1].flash, group[2].flash, group[3].flash});
+        }
+
+        memcpy(&slots[i], group, sizeof(group));
+    }
+#endif
+
+    for (; i < cnt; i++) {
+        slots[i] = GenBulkBatchSlot(base_slot, input, begin + i);
+    }
+}
+
+// Renders many instances of the one texture region, with texture coordinates and the like being worked out only once. Instances are written straight into the batch in chunks, with a flush between each. If a render queue is active, they are instead filled in chunks on the stack and enqueued a chunk at a time.
+void RenderTextureBulk(const s_rendering_context* const context, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d origin, const s_render_bulk_input* const input) {
+    assert(context);
+    assert(tex_index >= 0 && tex_index < textures->cnt);
+    assert(input);
+    assert(input->cnt >= 0);
+    assert(input->cnt == 0 || input->positions);
+
+    const t_gl_id tex_gl_id = textures->gl_ids[tex_index];
+    const s_rect_edges tex_coords = CalcTextureCoords(src_rect, textures->sizes[tex_index]);
+
+    s_render_batch_slot base_slot = GenRenderBatchSlot(tex_coords, (s_vec_2d){0}, (s_vec_2d){src_rect.width, src_rect.height}, origin, 0.0f, WHITE, (s_color){0});
+
+    s_rendering_state* const state = context->state;
+
+    if (state->queue_active) {
+        s_render_batch_slot slots[RENDER_BULK_ENQUEUE_CHUNK_SIZE];
+
+        for (int i = 0; i < input->cnt; i += RENDER_BULK_ENQUEUE_CHUNK_SIZE) {
+            const int chunk_cnt = MIN(input->cnt - i, RENDER_BULK_ENQUEUE_CHUNK_SIZE);
+            FillBulkBatchSlots(slots, &base_slot, input, i, chunk_cnt);
+            EnqueueRenderCmds(context, tex_gl_id, slots, chunk_cnt);
+        }
+
+        return;
+    }
+
+    int submitted_cnt = 0;
+
+    while (submitted_cnt < input->cnt) {
+        if (state->batch_slots_used_cnt == context->pers->batch_slot_cnt) {
+            FlushBatch(context);
+        }
+
+        base_slot.tex_slot = (uint8_t)AcquireBatchTexSlot(context, tex_gl_id);
+
+        MapBatchIfEmpty(context);
+
+        state->batch_features |= BatchSlotFeatures(context, tex_gl_id, &base_slot);
+
+        if (input->rots) {
+            state->batch_features |= ek_render_batch_feature_rotation; // Not worth checking each rotation for.
+        }
+
+        const int chunk_cnt = MIN(input->cnt - submitted_cnt, context->pers->batch_slot_cnt - state->batch_slots_used_cnt);
+
+        FillBulkBatchSlots(&state->batch_slots[state->batch_slots_used_cnt], &base_slot, input, submitted_cnt, chunk_cnt);
+
+        state->batch_slots_used_cnt += chunk_cnt;
+        submitted_cnt += chunk_cnt;
+    }
+}
+
+void RenderTexture(const s_rendering_context* const context, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend) {
+    RenderTextureFlashed(context, tex_index, textures, src_rect, pos, origin, scale, rot, blend, (s_color){0});
+}
+
+void RenderTextureFlashed(const s_rendering_context* const context, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend, const s_color flash) {
+    assert(tex_index >= 0 && tex_index < textures->cnt);
+    assert(IsOriginValid(origin));
+    assert(IsColorValid(blend));
+
+    const s_vec_2d_i tex_size = textures->sizes[tex_index];
+    const s_rect_edges tex_coords = CalcTextureCoords(src_rect, tex_size);
+
+    const s_vec_2d size_scaled = {src_rect.width * scale.x, src_rect.height * scale.y};
+
+    RenderFlashed(context, textures->gl_ids[tex_index], tex_coords, pos, size_scaled, origin, rot, blend, flash);
+}
+
+bool RenderStr(
+    const s_rendering_context* const context,
+    const char* const str,
+    const int font_index,
+    const s_fonts* const fonts,
+    const s_vec_2d pos,
+    const e_str_hor_align hor_align,
+    const e_str_ver_align ver_align,
+    const s_color blend,
+    s_mem_arena* const temp_mem_arena
+) {
+    assert(context);
+    assert(str);
+    assert(fonts);
+    assert(IsColorValid(blend));
+
+    if (!str[0]) {
+        return true;
+    }
+
+    const int str_len = strlen(str);
+    const s_vec_2d* const str_chr_positions = PushStrChrPositions(str, temp_mem_arena, font_index, fonts, pos, hor_align, ver_align);
+
+    if (!str_chr_positions) {
+        return false;
+    }
+
+    const t_gl_id font_tex_gl_id = fonts->tex_gl_ids[font_index];
+
+    const s_vec_2d_i font_tex_size = {
+        .x = FONT_TEXTURE_WIDTH,
+        .y = fonts->tex_heights[font_index]
+    };
+
+    for (int i = 0; i < str_len; ++i) {
+        const char c = str[i];
+
+        if (c == '\0' || c == ' ') {
+            continue;
+        }
+
+        const int chr_index = c - FONT_CHR_RANGE_BEGIN;
+        const s_rect_i chr_src_rect = fonts->arrangement_infos[font_index].chr_src_rects[chr_index];
+        const s_rect_edges chr_tex_coords = CalcTextureCoords(chr_src_rect, font_tex_size);
+
+        Render(
+            context,
+            font_tex_gl_id,
+            chr_tex_coords,
+            str_chr_positions[i],
+            (s_vec_2d){chr_src_rect.width, chr_src_rect.height},
+            VEC_2D_ZERO,
+            0.0f,
+            blend
+        );
+    }
+
+    return true;
+}
+ 
+void RenderRect(const s_rendering_context* const context, const s_rect rect, const s_color blend) {
+    assert(rect.width > 0.0f && rect.height > 0.0f);
+    assert(IsColorValid(blend));
+
+    const s_rect_edges tex_coords = {0.0f, 0.0f, 1.0f, 1.0f};
+    const s_vec_2d pos = {rect.x, rect.y};
+    const s_vec_2d size = {rect.width, rect.height};
+    Render(context, context->pers->px_tex_gl_id, tex_coords, pos, size, (s_vec_2d){0}, 0.0f, blend);
+}
+
+void RenderRectOutline(const s_rendering_context* const context, const s_rect rect, const s_color blend, const float thickness) {
+    assert(rect.width > 0.0f && rect.height > 0.0f);
+    assert(IsColorValid(blend));
+    assert(thickness > 0.0f);
+
+    const s_rect top = {rect.x - thickness, rect.y - thickness, rect.width + thickness, thickness};
+    const s_rect right = {rect.x + rect.width, rect.y - thickness, thickness, rect.height + thickness};
+    const s_rect bottom = {rect.x, rect.y + rect.height, rect.width + thickness, thickness};
+    const s_rect left = {rect.x - thickness, rect.y, thickness, rect.height + thickness};
+
+    RenderRect(context, top, blend);
+    RenderRect(context, right, blend);
+    RenderRect(context, bottom, blend);
+    RenderRect(context, left, blend);
+}
+
+// The miters offset the corners along the segment, in half widths. They're scaled down if the
+// segment is too short for its corners to keep from passing each other.
+static void RenderSegment(const s_rendering_context* const context, const s_vec_2d a, const s_vec_2d b, float miter_begin, float miter_end, const s_color blend, const float width) {
+    assert(IsColorValid(blend));
+    assert(width > 0.0f);
+    assert(miter_begin >= -RENDER_POLYLINE_MITER_LIMIT && miter_begin <= RENDER_POLYLINE_MITER_LIMIT);
+    assert(miter_end >= -RENDER_POLYLINE_MITER_LIMIT && miter_end <= RENDER_POLYLINE_MITER_LIMIT);
+
+    {
+        const float len_in_half_widths = sqrtf(((b.x - a.x) * (b.x - a.x)) + ((b.y - a.y) * (b.y - a.y))) / (width * 0.5f);
+        const float miter_diff = fabsf(miter_begin - miter_end);
+
+        if (miter_diff > len_in_half_widths) {
+            const float scale = len_in_half_widths / miter_diff;
+            miter_begin *= scale;
+            miter_end *= scale;
+        }
+    }
+
+    const s_render_batch_slot slot = {
+        .pos = a,
+        .size = {b.x - a.x, b.y - a.y},
+        .rot = width,
+        .origin = {
+            ToUnorm16(((miter_begin / RENDER_POLYLINE_MITER_LIMIT) + 1.0f) * 0.5f),
+            ToUnorm16(((miter_end / RENDER_POLYLINE_MITER_LIMIT) + 1.0f) * 0.5f)
+        },
+        .tex_coords = {0, 0, UINT16_MAX, UINT16_MAX},
+        .blend = {ToUnorm8(blend.r), ToUnorm8(blend.g), ToUnorm8(blend.b), ToUnorm8(blend.a)},
+        .segment = 1
+    };
+
+    if (context->state->queue_active) {
+        EnqueueRenderCmd(context, context->pers->px_tex_gl_id, slot);
+    } else {
+        SubmitBatchSlot(context, context->pers->px_tex_gl_id, slot);
+    }
+}
+
+void RenderLine(const s_rendering_context* const context, const s_vec_2d a, const s_vec_2d b, const s_color blend, const float width) {
+    RenderSegment(context, a, b, 0.0f, 0.0f, blend, width);
+}
+
+void RenderPolyOutline(const s_rendering_context* const context, const s_poly poly, const s_color blend, const float width) {
+    RenderPolyline(context, poly.pts, poly.cnt, true, blend, width);
+}
+
+// Returns the unit direction of the segment beginning at the given point, or zero if the segment has no length.
+static s_vec_2d CalcPolylineSegmentDir(const s_vec_2d* const pts, const int pt_cnt, const int seg_index) {
+    const s_vec_2d a = pts[seg_index];
+    const s_vec_2d b = pts[seg_index + 1 < pt_cnt ? seg_index + 1 : 0];
+    const s_vec_2d diff = {b.x - a.x, b.y - a.y};
+    const float len = sqrtf((diff.x * diff.x) + (diff.y * diff.y));
+
+    if (len == 0.0f) {
+        return (s_vec_2d){0};
+    }
+
+    return (s_vec_2d){diff.x / len, diff.y / len};
+}
+
+// Returns the miter for the start of segment direction b after segment direction a, negated for the
+// end of the first. It's the tangent of half the turn angle.
+static float CalcPolylineMiter(const s_vec_2d a, const s_vec_2d b) {
+    const float denom = 1.0f + (a.x * b.x) + (a.y * b.y);
+
+    // The line doubles back on itself, so there is no sensible miter.
+    if (denom <= 0.0f) {
+        return 0.0f;
+    }
+
+    const float miter = ((a.x * b.y) - (a.y * b.x)) / denom;
+    return CLAMP(miter, -RENDER_POLYLINE_MITER_LIMIT, RENDER_POLYLINE_MITER_LIMIT);
+}
+
+// Each segment is a single instance, mitered to meet its neighbours without gaps or overlap. Joins
+// sharper than RENDER_POLYLINE_MITER_LIMIT or between very short segments are cut short.
+void RenderPolyline(const s_rendering_context* const context, const s_vec_2d* const pts, const int pt_cnt, const bool closed, const s_color blend, const float width) {
+    assert(context);
+    assert(pts);
+    assert(pt_cnt >= 2);
+    assert(IsColorValid(blend));
+    assert(width > 0.0f);
+
+    const int seg_cnt = closed ? pt_cnt : pt_cnt - 1;
+
+    // Each direction and join is only worked out once, with them being carried over to the next segment.
+    const s_vec_2d dir_first = CalcPolylineSegmentDir(pts, pt_cnt, 0);
+    s_vec_2d dir = dir_first;
+    float miter_begin = closed ? CalcPolylineMiter(CalcPolylineSegmentDir(pts, pt_cnt, seg_cnt - 1), dir) : 0.0f;
+
+    for (int i = 0; i < seg_cnt; i++) {
+        s_vec_2d dir_next = {0};
+        float miter_end = 0.0f;
+
+        if (i + 1 < seg_cnt) {
+            dir_next = CalcPolylineSegmentDir(pts, pt_cnt, i + 1);
+            miter_end = CalcPolylineMiter(dir, dir_next);
+        } else if (closed) {
+            miter_end = CalcPolylineMiter(dir, dir_first);
+        }
+
+        RenderSegment(context, pts[i], pts[i + 1 < pt_cnt ? i + 1 : 0], miter_begin, -miter_end, blend, width);
+
+        dir = dir_next;
+        miter_begin = miter_end;
+    }
+}
+
+void RenderBarHor(const s_rendering_context* const context, const s_rect rect, const float perc, const s_color_rgb col_front, const s_color_rgb col_back) {
+    assert(perc >= 0.0f && perc <= 1.0f);
+    assert(IsColorRGBValid(col_front));
+    assert(IsColorRGBValid(col_back));
+
+    s_rect left_rect = {rect.x, rect.y, 0.0f, rect.height};
+
+    // Only render the left rectangle if percentage is not 0.
+    if (perc > 0.0f) {
+        left_rect.width = rect.width * perc;
+        const s_color col = {col_front.r, col_front.g, col_front.b, 1.0f};
+        RenderRect(context, left_rect, col);
+    }
+
+    // Only render right rectangle if percentage is not 100.
+    if (perc < 1.0f) {
+        const s_rect right_rect = {rect.x + left_rect.width, rect.y, rect.width - left_rect.width, rect.height};
+        const s_color col = {col_back.r, col_back.g, col_back.b, 1.0f};
+        RenderRect(context, right_rect, col);
+    }
+}
+
+bool InitRenderCmdList(s_render_cmd_list* const list, const int cmd_limit) {
+    assert(list);
+    assert(IsZero(list, sizeof(*list)));
+    assert(cmd_limit > 0);
+
+    list->cmds = malloc(sizeof(*list->cmds) * cmd_limit);
+
+    if (!list->cmds) {
+        fprintf(stderr, "Failed to allocate render command list commands!\n");
+        return false;
+    }
+
+    list->cmd_limit = cmd_limit;
+
+    return true;
+}
+
+void CleanRenderCmdList(s_render_cmd_list* const list) {
+    assert(list);
+
+    free(list->cmds);
+
+    ZeroOut(list, sizeof(*list));
+}
+
+void ClearRenderCmdList(s_render_cmd_list* const list) {
+    assert(list);
+    list->cmd_cnt = 0;
+}
+
+// Everything done here (colour and coordinate packing included) is what would otherwise be done on the main thread by Render().
+bool AddToRenderCmdList(s_render_cmd_list* const list, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend, const s_color flash) {
+    assert(list);
+
+    if (list->cmd_cnt == list->cmd_limit) {
+        fprintf(stderr, "Render command list is out of commands!\n");
+        return false;
+    }
+
+    list->cmds[list->cmd_cnt] = (s_render_cmd){
+        .slot = GenRenderBatchSlot(tex_coords, pos, size, origin, rot, blend, flash),
+        .tex_gl_id = tex_gl_id
+    };
+
+    list->cmd_cnt++;
+
+    return true;
+}
+
+bool AddTextureToRenderCmdList(s_render_cmd_list* const list, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend, const s_color flash) {
+    assert(tex_index >= 0 && tex_index < textures->cnt);
+
+    const s_rect_edges tex_coords = CalcTextureCoords(src_rect, textures->sizes[tex_index]);
+    const s_vec_2d size_scaled = {src_rect.width * scale.x, src_rect.height * scale.y};
+
+    return AddToRenderCmdList(list, textures->gl_ids[tex_index], tex_coords, pos, size_scaled, origin, rot, blend, flash);
+}
+
+static int RunRenderCmdListWorker(void* const workers_raw) {
+    s_render_cmd_list_workers* const workers = workers_raw;
+
+    LockMutex(&workers->mtx);
+
+    const int thread_index = workers->thread_index_next;
+    workers->thread_index_next++;
+
+    while (true) {
+        while (!workers->quit && !workers->jobs_pending[thread_index]) {
+            WaitCond(&workers->job_cnd, &workers->mtx);
+        }
+
+        if (workers->quit) {
+            break;
+        }
+
+        workers->jobs_pending[thread_index] = false;
+
+        UnlockMutex(&workers->mtx);
+
+        const int list_index = thread_index + 1;
+        workers->func(&workers->lists[list_index], list_index, workers->user_data);
+
+        LockMutex(&workers->mtx);
+
+        workers->jobs_left_cnt--;
+
+        if (workers->jobs_left_cnt == 0) {
+            SignalCond(&workers->done_cnd);
+        }
+    }
+
+    UnlockMutex(&workers->mtx);
+
+    return 0;
+}
+
+// Makes sure that there are at least the given number of worker threads running, returning false if not all could be started.
+static bool PrepareRenderCmdListWorkers(s_render_cmd_list_workers* const workers, const int thread_cnt) {
+    assert(thread_cnt >= 0 && thread_cnt <= RENDER_CMD_LIST_THREAD_LIMIT - 1);
+
+    if (!workers->sync_inited) {
+        if (thread_cnt == 0) {
+            return true;
+        }
+
+        if (!InitMutex(&workers->mtx)) {
+            return false;
+        }
+
+        if (!InitCond(&workers->job_cnd)) {
+            CleanMutex(&workers->mtx);
+            return false;
+        }
+
+        if (!InitCond(&workers->done_cnd)) {
+            CleanCond(&workers->job_cnd);
+            CleanMutex(&workers->mtx);
+            return false;
+        }
+
+        workers->sync_inited = true;
+    }
+
+    while (workers->thread_cnt < thread_cnt) {
+        if (!StartThread(&workers->threads[workers->thread_cnt], RunRenderCmdListWorker, workers)) {
+            return false;
+        }
+
+        workers->thread_cnt++;
+    }
+
+    return true;
+}
+
+// Clears each of the lists and then has the given function fill them in, each on its own thread (with the first on the calling thread), returning once all are done. The worker threads are kept between calls. If a thread can't be started, its list is recorded on the calling thread instead, so the result is the same either way.
+bool RecordRenderCmdListsInParallel(const s_rendering_context* const context, s_render_cmd_list* const lists, const int list_cnt, const t_render_cmd_list_record_func func, void* const user_data) {
+    assert(context);
+    assert(lists);
+    assert(list_cnt > 0 && list_cnt <= RENDER_CMD_LIST_THREAD_LIMIT);
+    assert(func);
+
+    s_render_cmd_list_workers* const workers = &context->pers->cmd_list_workers;
+
+    for (int i = 0; i < list_cnt; i++) {
+        ClearRenderCmdList(&lists[i]);
+    }
+
+    const bool all_started = PrepareRenderCmdListWorkers(workers, list_cnt - 1);
+    const int worker_list_cnt = MIN(list_cnt - 1, workers->thread_cnt);
+
+    if (worker_list_cnt > 0) {
+        LockMutex(&workers->mtx);
+
+        workers->lists = lists;
+        workers->func = func;
+        workers->user_data = user_data;
+
+        for (int i = 0; i < worker_list_cnt; i++) {
+            workers->jobs_pending[i] = true;
+        }
+
+        workers->jobs_left_cnt = worker_list_cnt;
+
+        BroadcastCond(&workers->job_cnd);
+        UnlockMutex(&workers->mtx);
+    }
+
+    func(&lists[0], 0, user_data);
+
+    for (int i = 1 + worker_list_cnt; i < list_cnt; i++) {
+        func(&lists[i], i, user_data);
+    }
+
+    if (worker_list_cnt > 0) {
+        LockMutex(&workers->mtx);
+
+        while (workers->jobs_left_cnt > 0) {
+            WaitCond(&workers->done_cnd, &workers->mtx);
+        }
+
+        UnlockMutex(&workers->mtx);
+    }
+
+    return all_started;
+}
+
+// Runs of commands sharing a texture are copied into the batch together, so that the texture slot lookup and flush checks happen once per run rather than per command.
+static void SubmitRenderCmdList(const s_rendering_context* const context, const s_render_cmd_list* const list) {
+    s_rendering_state* const state = context->state;
+
+    if (state->queue_active) {
+        EnqueueRenderCmdArray(context, list->cmds, list->cmd_cnt);
+        return;
+    }
+
+    int submitted_cnt = 0;
+
+    while (submitted_cnt < list->cmd_cnt) {
+        const s_render_cmd* const run = &list->cmds[submitted_cnt];
+
+        if (state->batch_slots_used_cnt == context->pers->batch_slot_cnt) {
+            FlushBatch(context);
+        }
+
+        const uint8_t tex_slot = (uint8_t)AcquireBatchTexSlot(context, run->tex_gl_id); // Might flush too.
+
+        MapBatchIfEmpty(context);
+
+        e_render_batch_features features = 0;
+
+        const int run_len_limit = MIN(list->cmd_cnt - submitted_cnt, context->pers->batch_slot_cnt - state->batch_slots_used_cnt);
+        s_render_batch_slot* const dest_slots = &state->batch_slots[state->batch_slots_used_cnt];
+        int run_len = 0;
+
+        while (run_len < run_len_limit && run[run_len].tex_gl_id == run->tex_gl_id) {
+            s_render_batch_slot slot = run[run_len].slot;
+            slot.tex_slot = tex_slot;
+            features |= BatchSlotFeatures(context, run->tex_gl_id, &slot);
+            dest_slots[run_len] = slot;
+            run_len++;
+        }
+
+        state->batch_features |= features;
+        state->batch_slots_used_cnt += run_len;
+        submitted_cnt += run_len;
+    }
+}
+
+// The lists are submitted one after another in the order given, so the result doesn't depend on which thread finished recording first.
+void SubmitRenderCmdLists(const s_rendering_context* const context, const s_render_cmd_list* const lists, const int list_cnt) {
+    assert(context);
+    assert(lists);
+    assert(list_cnt >= 0);
+
+    for (int i = 0; i < list_cnt; i++) {
+        SubmitRenderCmdList(context, &lists[i]);
+    }
+}
+
+bool InitStaticRenderBatch(s_static_render_batch* const batch, const s_rendering_context* const context, const int slot_limit) {
+    assert(batch);
+    assert(IsZero(batch, sizeof(*batch)));
+    assert(context);
+    assert(slot_limit > 0);
+
+    batch->slots = malloc(sizeof(*batch->slots) * slot_limit);
+
+    if (!batch->slots) {
+        fprintf(stderr, "Failed to allocate static render batch slots!\n");
+        return false;
+    }
+
+    const s_pers_render_data* const render_data = context->pers;
+    s_gl_state_cache* const gl_state_cache = &context->state->gl_state_cache;
+
+    batch->slot_limit = slot_limit;
+    batch->tex_slot_limit = render_data->batch_tex_slot_cnt;
+
+    // The unit quad and its indices are shared with the dynamic batch, only the slot buffer is our own.
+    glGenVertexArrays(1, &batch->vert_array_gl_id);
+    BindVertArray(gl_state_cache, batch->vert_array_gl_id);
+
+    BindArrayBuf(gl_state_cache, render_data->batch_gl_ids.quad_vert_buf_gl_id);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, render_data->batch_gl_ids.elem_buf_gl_id);
+
+    glGenBuffers(1, &batch->slot_buf_gl_id);
+    BindArrayBuf(gl_state_cache, batch->slot_buf_gl_id);
+    glBufferData(GL_ARRAY_BUFFER, RENDER_BATCH_SLOT_SIZE * slot_limit, NULL, GL_STATIC_DRAW);
+
+    SetUpRenderBatchSlotAttribs();
+
+    return true;
+}
+
+void CleanStaticRenderBatch(s_static_render_batch* const batch) {
+    assert(batch);
+
+    glDeleteBuffers(1, &batch->slot_buf_gl_id);
+    glDeleteVertexArrays(1, &batch->vert_array_gl_id);
+
+    free(batch->slots);
+
+    ZeroOut(batch, sizeof(*batch));
+}
+
+void ClearStaticRenderBatch(s_static_render_batch* const batch) {
+    assert(batch);
+
+    batch->slot_cnt = 0;
+    batch->tex_slots_used_cnt = 0;
+    batch->dirty_begin = 0;
+    batch->dirty_end = 0;
+    batch->features = 0;
+}
+
+// Returns the texture slot of the batch to use for the given texture, assigning it a new one if needed. Returns -1 if the batch is out of texture slots.
+static int StaticRenderBatchTexSlot(s_static_render_batch* const batch, const t_gl_id tex_gl_id) {
+    for (int i = 0; i < batch->tex_slots_used_cnt; i++) {
+        if (batch->tex_gl_ids[i] == tex_gl_id) {
+            return i;
+        }
+    }
+
+    if (batch->tex_slots_used_cnt == batch->tex_slot_limit) {
+        return -1;
+    }
+
+    batch->tex_gl_ids[batch->tex_slots_used_cnt] = tex_gl_id;
+    batch->tex_slots_used_cnt++;
+
+    return batch->tex_slots_used_cnt - 1;
+}
+
+static bool WriteStaticRenderBatchSlot(s_static_render_batch* const batch, const int slot_index, const t_gl_id tex_gl_id, s_render_batch_slot slot) {
+    const int tex_slot = StaticRenderBatchTexSlot(batch, tex_gl_id);
+
+    if (tex_slot == -1) {
+        fprintf(stderr, "Static render batch is out of texture slots!\n");
+        return false;
+    }
+
+    slot.tex_slot = (uint8_t)tex_slot;
+    batch->slots[slot_index] = slot;
+
+    if (slot.rot != 0.0f) {
+        batch->features |= ek_render_batch_feature_rotation;
+    }
+
+    // Extend the dirty range to cover the slot.
+    if (batch->dirty_begin == batch->dirty_end) {
+        batch->dirty_begin = slot_index;
+        batch->dirty_end = slot_index + 1;
+    } else {
+        batch->dirty_begin = MIN(batch->dirty_begin, slot_index);
+        batch->dirty_end = MAX(batch->dirty_end, slot_index + 1);
+    }
+
+    return true;
+}
+
+// Returns the index of the new slot, or -1 if the batch is out of slots or texture slots.
+int AddToStaticRenderBatch(s_static_render_batch* const batch, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend) {
+    assert(batch);
+
+    if (batch->slot_cnt == batch->slot_limit) {
+        fprintf(stderr, "Static render batch is out of slots!\n");
+        return -1;
+    }
+
+    const int slot_index = batch->slot_cnt;
+
+    if (!WriteStaticRenderBatchSlot(batch, slot_index, tex_gl_id, GenRenderBatchSlot(tex_coords, pos, size, origin, rot, blend, (s_color){0}))) {
+        return -1;
+    }
+
+    batch->slot_cnt++;
+
+    return slot_index;
+}
+
+int AddTextureToStaticRenderBatch(s_static_render_batch* const batch, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend) {
+    assert(tex_index >= 0 && tex_index < textures->cnt);
+
+    const s_rect_edges tex_coords = CalcTextureCoords(src_rect, textures->sizes[tex_index]);
+    const s_vec_2d size_scaled = {src_rect.width * scale.x, src_rect.height * scale.y};
+
+    return AddToStaticRenderBatch(batch, textures->gl_ids[tex_index], tex_coords, pos, size_scaled, origin, rot, blend);
+}
+
+bool UpdateStaticRenderBatchSlot(s_static_render_batch* const batch, const int slot_index, const t_gl_id tex_gl_id, const s_rect_edges tex_coords, const s_vec_2d pos, const s_vec_2d size, const s_vec_2d origin, const float rot, const s_color blend) {
+    assert(batch);
+    assert(slot_index >= 0 && slot_index < batch->slot_cnt);
+
+    return WriteStaticRenderBatchSlot(batch, slot_index, tex_gl_id, GenRenderBatchSlot(tex_coords, pos, size, origin, rot, blend, (s_color){0}));
+}
+
+static void UploadStaticRenderBatchDirtySlots(s_gl_state_cache* const gl_state_cache, s_static_render_batch* const batch) {
+    if (batch->dirty_begin == batch->dirty_end) {
+        return;
+    }
+
+    BindArrayBuf(gl_state_cache, batch->slot_buf_gl_id);
+    glBufferSubData(GL_ARRAY_BUFFER, RENDER_BATCH_SLOT_SIZE * batch->dirty_begin, RENDER_BATCH_SLOT_SIZE * (batch->dirty_end - batch->dirty_begin), batch->slots + batch->dirty_begin);
+
+    batch->dirty_begin = 0;
+    batch->dirty_end = 0;
+}
+
+static void PrepareStaticRenderBatchDraw(const s_rendering_context* const context, const s_static_render_batch* const batch) {
+    s_gl_state_cache* const gl_state_cache = &context->state->gl_state_cache;
+
+    if (context->state->frame_uniforms_dirty || !Vec2DIsEqual(context->state->frame_uniforms_display_size, context->display_size)) {
+        UploadFrameUniforms(context);
+    }
+
+    UseShaderProg(gl_state_cache, context->pers->batch_shader_progs[batch->features | ek_render_batch_feature_texture].gl_id);
+    BindVertArray(gl_state_cache, batch->vert_array_gl_id);
+
+    for (int i = 0; i < batch->tex_slots_used_cnt; i++) {
+        BindTexture(gl_state_cache, i, batch->tex_gl_ids[i]);
+    }
+}
+
+void RenderStaticBatch(const s_rendering_context* const context, s_static_render_batch* const batch) {
+    RenderStaticBatchRange(context, batch, 0, batch->slot_cnt);
+}
+
+// Only draws the given range of slots, which lets callers that record their slots in spatial order cull the rest away.
+void RenderStaticBatchRange(const s_rendering_context* const context, s_static_render_batch* const batch, const int slot_begin, const int slot_cnt) {
+    assert(context);
+    assert(!context->state->queue_active && "Static batches cannot be rendered while a render queue is active!");
+    assert(batch);
+    assert(slot_begin >= 0 && slot_cnt >= 0 && slot_begin + slot_cnt <= batch->slot_cnt);
+
+    if (slot_cnt == 0) {
+        return;
+    }
+
+    // Anything submitted before needs to be drawn first.
+    Flush(context);
+
+    UploadStaticRenderBatchDirtySlots(&context->state->gl_state_cache, batch);
+
+    PrepareStaticRenderBatchDraw(context, batch);
+
+    glDrawElementsInstancedBaseInstance(GL_TRIANGLES, RENDER_BATCH_SLOT_ELEM_CNT, GL_UNSIGNED_SHORT, NULL, slot_cnt, slot_begin);
+}
+
+static s_vec_2d_i RenderTargetSize(const e_render_target_size size, const s_vec_2d_i display_size) {
+    const int div = 1 << size;
+    return (s_vec_2d_i){MAX(display_size.x / div, 1), MAX(display_size.y / div, 1)};
+}
+
+static int RoundUpToSurfaceSizeGranularity(const int val) {
+    return ((val + RENDER_SURFACE_SIZE_GRANULARITY - 1) / RENDER_SURFACE_SIZE_GRANULARITY) * RENDER_SURFACE_SIZE_GRANULARITY;
+}
+
+// Whether the surface texture is of the given format and can hold the given size without being over double the size it'd be allocated at now.
+static bool DoesRenderSurfaceFit(const s_render_surfaces* const surfs, const int surf_index, const s_vec_2d_i size, const e_render_target_format format) {
+    const s_vec_2d_i tex_size = surfs->tex_sizes[surf_index];
+    const s_vec_2d_i tex_size_new = {RoundUpToSurfaceSizeGranularity(size.x), RoundUpToSurfaceSizeGranularity(size.y)};
+
+    const bool fits = surfs->framebuffer_tex_gl_ids[surf_index] != 0
+        && surfs->formats[surf_index] == format
+        && size.x <= tex_size.x && size.y <= tex_size.y;
+
+    const bool oversized = tex_size.x > tex_size_new.x * 2 || tex_size.y > tex_size_new.y * 2;
+
+    return fits && !oversized;
+}
+
+// Makes sure that the surface texture fits the given size and format (see DoesRenderSurfaceFit()), reallocating it if not.
+static bool PrepareRenderSurface(s_render_surfaces* const surfs, s_gl_state_cache* const gl_state_cache, const int surf_index, const s_vec_2d_i size, const e_render_target_format format) {
+    assert(surf_index >= 0 && surf_index < RENDER_SURFACE_LIMIT);
+    assert(size.x > 0 && size.y > 0);
+
+    surfs->sizes[surf_index] = size;
+
+    if (DoesRenderSurfaceFit(surfs, surf_index, size, format)) {
+        return true;
+    }
+
+    const s_vec_2d_i tex_size_new = {RoundUpToSurfaceSizeGranularity(size.x), RoundUpToSurfaceSizeGranularity(size.y)};
+
+    if (surfs->framebuffer_tex_gl_ids[surf_index] == 0) {
+        glGenTextures(1, &surfs->framebuffer_tex_gl_ids[surf_index]);
+    }
+
+    BindTexture(gl_state_cache, 0, surfs->framebuffer_tex_gl_ids[surf_index]);
+
+    switch (format) {
+        case ek_render_target_format_rgba8:
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, tex_size_new.x, tex_size_new.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            break;
+
+        case ek_render_target_format_rgba16f:
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, tex_size_new.x, tex_size_new.y, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+            break;
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    BindFramebuffer(gl_state_cache, surfs->framebuffer_gl_ids[surf_index]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, surfs->framebuffer_tex_gl_ids[surf_index], 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Failed to allocate render surface %d!\n", surf_index);
+        return false;
+    }
+
+    surfs->tex_sizes[surf_index] = tex_size_new;
+    surfs->formats[surf_index] = format;
+
+    return true;
+}
+
+// Binds the framebuffer of the surface on top of the stack, or the default framebuffer if the stack is empty.
+static void BindTopSurface(const s_rendering_context* const rendering_context) {
+    s_rendering_state* const rs = rendering_context->state;
+    const s_render_surfaces* const surfs = &rendering_context->pers->surfs;
+
+    if (rs->surf_index_stack_height == 0) {
+        BindFramebuffer(&rs->gl_state_cache, 0);
+        SetViewport(&rs->gl_state_cache, rendering_context->display_size);
+    } else {
+        const int surf_index = rs->surf_index_stack[rs->surf_index_stack_height - 1];
+        BindFramebuffer(&rs->gl_state_cache, surfs->framebuffer_gl_ids[surf_index]);
+        SetViewport(&rs->gl_state_cache, surfs->sizes[surf_index]);
+    }
+}
+
+// Rewrites the quad of the surface in the vertex buffer if the surface size has changed relative to its texture, as only the top-left of the texture holds the surface contents. This only happens as a surface is set, never as it's rendered.
+static void UpdateSurfaceQuad(s_pers_render_data* const pers, s_gl_state_cache* const gl_state_cache, const int surf_index) {
+    const s_vec_2d tex_coords_scale = {
+        (float)pers->surfs.sizes[surf_index].x / pers->surfs.tex_sizes[surf_index].x,
+        (float)pers->surfs.sizes[surf_index].y / pers->surfs.tex_sizes[surf_index].y
+    };
+
+    const s_vec_2d tex_coords_scale_last = pers->surf_tex_coords_scales[surf_index];
+
+    if (tex_coords_scale.x == tex_coords_scale_last.x && tex_coords_scale.y == tex_coords_scale_last.y) {
+        return;
+    }
+
+    const float verts[] = {
+        -1.0, -1.0, 0.0, 0.0,
+         1.0, -1.0, tex_coords_scale.x, 0.0,
+         1.0,  1.0, tex_coords_scale.x, tex_coords_scale.y,
+        -1.0,  1.0, 0.0, tex_coords_scale.y
+    };
+
+    BindArrayBuf(gl_state_cache, pers->surf_vert_buf_gl_id);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(verts) * surf_index, sizeof(verts), verts);
+
+    pers->surf_tex_coords_scales[surf_index] = tex_coords_scale;
+}
+
+static bool PushSurface(const s_rendering_context* const rendering_context, const int surf_index, const s_vec_2d_i size, const e_render_target_format format) {
+    assert(rendering_context);
+
+    s_rendering_state* const rs = rendering_context->state;
+    s_render_surfaces* const surfs = &rendering_context->pers->surfs;
+
+    assert(surf_index >= 0 && surf_index < RENDER_SURFACE_LIMIT);
+    assert(rs->surf_index_stack_height < RENDER_SURFACE_LIMIT);
+
+    if (!PrepareRenderSurface(surfs, &rs->gl_state_cache, surf_index, size, format)) {
+        // The surface framebuffer might have been left bound by the attempt.
+        BindTopSurface(rendering_context);
+        return false;
+    }
+
+    UpdateSurfaceQuad(rendering_context->pers, &rs->gl_state_cache, surf_index);
+
+    // Add the surface index to the stack.
+    rs->surf_index_stack[rs->surf_index_stack_height] = surf_index;
+    rs->surf_index_stack_height++;
+
+    // Bind the surface framebuffer.
+    BindFramebuffer(&rs->gl_state_cache, surfs->framebuffer_gl_ids[surf_index]);
+    SetViewport(&rs->gl_state_cache, surfs->sizes[surf_index]);
+
+    return true;
+}
+
+bool SetSurface(const s_rendering_context* const rendering_context, const int surf_index) {
+    // NOTE: Should flushing be a prerequisite to this?
+    return PushSurface(rendering_context, surf_index, rendering_context->display_size, ek_render_target_format_rgba8);
+}
+
+void UnsetSurface(const s_rendering_context* const rendering_context) {
+    assert(rendering_context);
+
+    s_rendering_state* const rs = rendering_context->state;
+
+    assert(rs->batch_slots_used_cnt == 0);
+    assert(rs->queue_cmd_cnt == 0);
+    assert(rs->surf_index_stack_height > 0);
+
+    rs->surf_index_stack_height--;
+
+    BindTopSurface(rendering_context);
+}
+
+void SetSurfaceShaderProg(const s_rendering_context* const rendering_context, const t_gl_id gl_id) {
+    assert(gl_id != 0);
+    // NOTE: Should we also trip an assert if current shader program GL ID is not 0?
+
+    rendering_context->state->surf_shader_prog_gl_id = gl_id;
+    UseShaderProg(&rendering_context->state->gl_state_cache, gl_id);
+}
+
+static bool AreShaderProgUniformValuesEqual(const s_shader_prog_uniform_value a, const s_shader_prog_uniform_value b) {
+    assert(a.type == b.type);
+
+    switch (a.type) {
+        case ek_shader_prog_uniform_value_type_int:
+            return a.as_int == b.as_int;
+
+        case ek_shader_prog_uniform_value_type_float:
+            return a.as_float == b.as_float;
+
+        case ek_shader_prog_uniform_value_type_v2:
+            return a.as_v2.x == b.as_v2.x && a.as_v2.y == b.as_v2.y;
+
+        case ek_shader_prog_uniform_value_type_v3:
+            return a.as_v3.x == b.as_v3.x && a.as_v3.y == b.as_v3.y && a.as_v3.z == b.as_v3.z;
+
+        case ek_shader_prog_uniform_value_type_v4:
+            return a.as_v4.x == b.as_v4.x && a.as_v4.y == b.as_v4.y && a.as_v4.z == b.as_v4.z && a.as_v4.w == b.as_v4.w;
+
+        case ek_shader_prog_uniform_value_type_mat4x4:
+            return memcmp(a.as_mat4x4, b.as_mat4x4, sizeof(a.as_mat4x4)) == 0;
+    }
+
+    return false;
+}
+
+void SetSurfaceShaderProgUniform(const s_rendering_context* const rendering_context, const s_shader_prog_uniform_handle handle, const s_shader_prog_uniform_value val) {
+    assert(rendering_context->state->surf_shader_prog_gl_id != 0 && "Surface shader program must be set before modifying uniforms!");
+    assert(handle.uniforms && handle.uniforms->prog_gl_id == rendering_context->state->surf_shader_prog_gl_id && "Uniform handle is for a different shader program!");
+    assert(handle.index >= 0 && handle.index < handle.uniforms->cnt);
+    assert(val.type == handle.type && "Uniform value type doesn't match that of the uniform!");
+
+    s_shader_prog_uniforms* const uniforms = handle.uniforms;
+    const uint32_t val_set_bit = 1u << handle.index;
+
+    if ((uniforms->vals_set & val_set_bit) && AreShaderProgUniformValuesEqual(uniforms->vals[handle.index], val)) {
+        return;
+    }
+
+    // The program-addressed variants are used since a flush might have switched over to the batch program since the surface one was set.
+    const t_gl_id prog_gl_id = uniforms->prog_gl_id;
+    const int loc = uniforms->locs[handle.index];
+
+    switch (val.type) {
+        case ek_shader_prog_uniform_value_type_int:
+            glProgramUniform1i(prog_gl_id, loc, val.as_int);
+            break;
+
+        case ek_shader_prog_uniform_value_type_float:
+            glProgramUniform1f(prog_gl_id, loc, val.as_float);
+            break;
+
+        case ek_shader_prog_uniform_value_type_v2:
+            glProgramUniform2f(prog_gl_id, loc, val.as_v2.x, val.as_v2.y);
+            break;
+
+        case ek_shader_prog_uniform_value_type_v3:
+            glProgramUniform3f(prog_gl_id, loc, val.as_v3.x, val.as_v3.y, val.as_v3.z);
+            break;
+
+        case ek_shader_prog_uniform_value_type_v4:
+            glProgramUniform4f(prog_gl_id, loc, val.as_v4.x, val.as_v4.y, val.as_v4.z, val.as_v4.w);
+            break;
+
+        case ek_shader_prog_uniform_value_type_mat4x4:
+            glProgramUniformMatrix4fv(prog_gl_id, loc, 1, false, &val.as_mat4x4[0][0]);
+            break;
+    }
+
+    uniforms->vals[handle.index] = val;
+    uniforms->vals_set |= val_set_bit;
+}
+
+void RenderSurface(const s_rendering_context* const rendering_context, const int surf_index) {
+    assert(surf_index >= 0 && surf_index < RENDER_SURFACE_LIMIT);
+    assert(rendering_context->state->surf_shader_prog_gl_id != 0 && "Surface shader program must be set before rendering a surface!");
+
+    s_gl_state_cache* const gl_state_cache = &rendering_context->state->gl_state_cache;
+    s_pers_render_data* const pers = rendering_context->pers;
+
+    assert(pers->surfs.framebuffer_tex_gl_ids[surf_index] != 0 && "Surface must have been set before it can be rendered!");
+
+    // The program is set again in case a flush has switched over to the batch program since.
+    UseShaderProg(gl_state_cache, rendering_context->state->surf_shader_prog_gl_id);
+    BindTexture(gl_state_cache, 0, rendering_context->pers->surfs.framebuffer_tex_gl_ids[surf_index]);
+    BindVertArray(gl_state_cache, rendering_context->pers->surf_vert_array_gl_id);
+
+    glDrawElementsBaseVertex(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, NULL, surf_index * 4);
+}
+
+// Blits the whole of the surface into the given rectangle (in framebuffer coordinates, so bottom-up) of whatever is being drawn to. Only the read binding is changed for this, and is put back afterwards.
+static void BlitSurface(s_gl_state_cache* const gl_state_cache, const s_render_surfaces* const surfs, const int surf_index, const int dest_x0, const int dest_y0, const int dest_x1, const int dest_y1, const GLenum filter) {
+    assert(surf_index >= 0 && surf_index < RENDER_SURFACE_LIMIT);
+    assert(surfs->framebuffer_tex_gl_ids[surf_index] != 0 && "Surface must have been set before it can be blitted!");
+
+    const s_vec_2d_i src_size = surfs->sizes[surf_index];
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, surfs->framebuffer_gl_ids[surf_index]);
+    glBlitFramebuffer(0, 0, src_size.x, src_size.y, dest_x0, dest_y0, dest_x1, dest_y1, GL_COLOR_BUFFER_BIT, filter);
+
+    // If the cache doesn't know the framebuffer binding, it'll rebind both the next time anyway.
+    if (gl_state_cache->known_bindings & ek_gl_binding_framebuffer) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gl_state_cache->framebuffer_gl_id);
+    }
+}
+
+// Copies the surface as it was last rendered to onto whatever is being rendered to now, pixel for pixel. Unlike RenderSurface(), no shader program is involved.
+void CopySurface(const s_rendering_context* const context, const int surf_index) {
+    assert(context);
+
+    Flush(context);
+
+    const s_vec_2d_i size = context->pers->surfs.sizes[surf_index];
+    BlitSurface(&context->state->gl_state_cache, &context->pers->surfs, surf_index, 0, 0, size.x, size.y, GL_NEAREST);
+}
+
+// Stretches the surface as it was last rendered to over the whole of whatever is being rendered to now, with linear filtering.
+void StretchSurface(const s_rendering_context* const context, const int surf_index) {
+    assert(context);
+
+    Flush(context);
+
+    const s_rendering_state* const rs = context->state;
+    const s_vec_2d_i dest_size = rs->surf_index_stack_height == 0 ? context->display_size : context->pers->surfs.sizes[rs->surf_index_stack[rs->surf_index_stack_height - 1]];
+
+    BlitSurface(&context->state->gl_state_cache, &context->pers->surfs, surf_index, 0, 0, dest_size.x, dest_size.y, GL_LINEAR);
+}
+
+void Flush(const s_rendering_context* const context) {
+    assert(context);
+
+    if (context->state->queue_active) {
+        SubmitRenderQueue(context);
+    }
+
+    FlushBatch(context);
+}
+
+void BeginRenderQueue(const s_rendering_context* const context, const bool stable) {
+    assert(context);
+    assert(!context->state->queue_active);
+
+    // Anything rendered before now has to come out first.
+    FlushBatch(context);
+
+    context->state->queue_active = true;
+    context->state->queue_stable = stable;
+}
+
+void EndRenderQueue(const s_rendering_context* const context) {
+    assert(context);
+    assert(context->state->queue_active);
+
+    Flush(context);
+
+    context->state->queue_active = false;
+    context->state->layer = 0;
+    context->state->depth = 0;
+}
+
+void SetRenderLayer(const s_rendering_context* const context, const int layer) {
+    assert(context);
+    assert(layer >= 0 && layer < RENDER_LAYER_LIMIT);
+
+    context->state->layer = layer;
+}
+
+void SetRenderDepth(const s_rendering_context* const context, const int depth) {
+    assert(context);
+    assert(depth >= 0 && depth < RENDER_DEPTH_LIMIT);
+
+    context->state->depth = depth;
+}
+
+static void FlushBatch(const s_rendering_context* const context) {
+    assert(context);
+
+    if (context->state->batch_slots_used_cnt == 0) {
+        return;
+    }
+
+    s_render_batch_ring* const ring = &context->pers->batch_ring;
+
+    s_gl_state_cache* const gl_state_cache = &context->state->gl_state_cache;
+
+    // The slots were written straight into the mapped ring range, so all that's left is to flush what was used and unmap.
+    BindArrayBuf(gl_state_cache, context->pers->batch_gl_ids.slot_buf_gl_id);
+
+    const GLsizeiptr write_size = RENDER_BATCH_SLOT_SIZE * context->state->batch_slots_used_cnt;
+    glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, write_size);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    if (context->state->frame_uniforms_dirty || !Vec2DIsEqual(context->state->frame_uniforms_display_size, context->display_size)) {
+        UploadFrameUniforms(context);
+    }
+
+    UseShaderProg(gl_state_cache, context->pers->batch_shader_progs[context->state->batch_features].gl_id);
+    BindVertArray(gl_state_cache, context->pers->batch_gl_ids.vert_array_gl_id);
+
+    for (int i = 0; i < context->state->batch_tex_slots_used_cnt; i++) {
+        BindTexture(gl_state_cache, i, context->state->batch_tex_gl_ids[i]);
+    }
+
+    const int base_slot = ring->write_offs / RENDER_BATCH_SLOT_SIZE;
+    glDrawElementsInstancedBaseInstance(GL_TRIANGLES, RENDER_BATCH_SLOT_ELEM_CNT, GL_UNSIGNED_SHORT, NULL, context->state->batch_slots_used_cnt, base_slot);
+
+    ring->write_offs += write_size;
+
+    context->state->batch_slots_used_cnt = 0;
+    context->state->batch_slots = NULL;
+    context->state->batch_tex_slots_used_cnt = 0;
+    context->state->batch_features = 0;
+}
+
+void ReserveRenderGraphSurface(s_render_graph* const graph, const int surf_index) {
+    assert(graph);
+    assert(surf_index >= 0 && surf_index < RENDER_SURFACE_LIMIT);
+
+    graph->surfs_reserved[surf_index] = true;
+}
+
+int AddRenderGraphTarget(s_render_graph* const graph, const e_render_target_size size, const e_render_target_format format) {
+    assert(graph);
+    assert(graph->target_cnt < RENDER_GRAPH_TARGET_LIMIT);
+
+    const int target = graph->target_cnt;
+    graph->targets[target] = (s_render_target_desc){size, format};
+    graph->target_cnt++;
+
+    return target;
+}
+
+void AddRenderGraphPass(s_render_graph* const graph, const t_render_pass_func func, void* const user_data, const int output_target, const int* const input_targets, const int input_cnt) {
+    assert(graph);
+    assert(graph->pass_cnt < RENDER_GRAPH_PASS_LIMIT);
+    assert(func);
+    assert(output_target == RENDER_GRAPH_DISPLAY_TARGET || (output_target >= 0 && output_target < graph->target_cnt));
+    assert(input_cnt >= 0 && input_cnt <= RENDER_GRAPH_PASS_INPUT_LIMIT);
+    assert(input_cnt == 0 || input_targets);
+
+    s_render_pass* const pass = &graph->passes[graph->pass_cnt];
+    pass->func = func;
+    pass->user_data = user_data;
+    pass->output_target = output_target;
+    pass->input_cnt = input_cnt;
+
+    for (int i = 0; i < input_cnt; i++) {
+        assert(input_targets[i] >= 0 && input_targets[i] < graph->target_cnt);
+        assert(input_targets[i] != output_target && "A pass cannot read from the target it renders to!");
+
+        pass->input_targets[i] = input_targets[i];
+    }
+
+    graph->pass_cnt++;
+}
+
+// Picks a surface that is free to back a target, preferring one that already fits it as is, then one yet to be allocated, so that targets of different size classes don't keep reallocating each other's surfaces. Surfaces are free if given -1 in the array.
+static int FindFreeRenderGraphSurface(const s_render_surfaces* const surfs, const int* const surf_target_indices, const s_vec_2d_i size, const e_render_target_format format) {
+    int unallocated_surf_index = -1;
+    int allocated_surf_index = -1;
+
+    for (int i = 0; i < RENDER_SURFACE_LIMIT; i++) {
+        if (surf_target_indices[i] != -1) {
+            continue;
+        }
+
+        if (DoesRenderSurfaceFit(surfs, i, size, format)) {
+            return i;
+        }
+
+        if (surfs->framebuffer_tex_gl_ids[i] == 0) {
+            if (unallocated_surf_index == -1) {
+                unallocated_surf_index = i;
+            }
+        } else if (allocated_surf_index == -1) {
+            allocated_surf_index = i;
+        }
+    }
+
+    return unallocated_surf_index != -1 ? unallocated_surf_index : allocated_surf_index;
+}
+
+bool ExecuteRenderGraph(const s_rendering_context* const context, const s_render_graph* const graph) {
+    assert(context);
+    assert(graph);
+
+    // Work backwards from the display to find which passes actually contribute to it.
+    bool passes_live[RENDER_GRAPH_PASS_LIMIT] = {0};
+    bool targets_needed[RENDER_GRAPH_TARGET_LIMIT] = {0};
+
+    for (int i = graph->pass_cnt - 1; i >= 0; i--) {
+        const s_render_pass* const pass = &graph->passes[i];
+
+        if (pass->output_target != RENDER_GRAPH_DISPLAY_TARGET && !targets_needed[pass->output_target]) {
+            continue;
+        }
+
+        passes_live[i] = true;
+
+        for (int j = 0; j < pass->input_cnt; j++) {
+            targets_needed[pass->input_targets[j]] = true;
+        }
+    }
+
+    // Determine the range of live passes over which each target is used.
+    int target_first_pass_indices[RENDER_GRAPH_TARGET_LIMIT];
+    int target_last_pass_indices[RENDER_GRAPH_TARGET_LIMIT];
+
+    for (int i = 0; i < graph->target_cnt; i++) {
+        target_first_pass_indices[i] = -1;
+        target_last_pass_indices[i] = -1;
+    }
+
+    for (int i = 0; i < graph->pass_cnt; i++) {
+        if (!passes_live[i]) {
+            continue;
+        }
+
+        const s_render_pass* const pass = &graph->passes[i];
+
+        for (int j = -1; j < pass->input_cnt; j++) {
+            const int target = j == -1 ? pass->output_target : pass->input_targets[j];
+
+            if (target == RENDER_GRAPH_DISPLAY_TARGET) {
+                continue;
+            }
+
+            if (target_first_pass_indices[target] == -1) {
+                assert(j == -1 && "Render graph target is read before anything renders to it!");
+                target_first_pass_indices[target] = i;
+            }
+
+            target_last_pass_indices[target] = i;
+        }
+    }
+
+    // Each target takes a surface when its range begins and gives it back once it ends, so targets whose ranges don't overlap end up sharing.
+    int target_surf_indices[RENDER_GRAPH_TARGET_LIMIT];
+    int surf_target_indices[RENDER_SURFACE_LIMIT];
+
+    for (int i = 0; i < graph->target_cnt; i++) {
+        target_surf_indices[i] = -1;
+    }
+
+    // Surfaces that can't be used are marked with -2.
+    for (int i = 0; i < RENDER_SURFACE_LIMIT; i++) {
+        surf_target_indices[i] = graph->surfs_reserved[i] ? -2 : -1;
+    }
+
+    for (int i = 0; i < context->state->surf_index_stack_height; i++) {
+        surf_target_indices[context->state->surf_index_stack[i]] = -2;
+    }
+
+    for (int i = 0; i < graph->pass_cnt; i++) {
+        if (!passes_live[i]) {
+            continue;
+        }
+
+        const s_render_pass* const pass = &graph->passes[i];
+        const int output_target = pass->output_target;
+
+        if (output_target != RENDER_GRAPH_DISPLAY_TARGET && target_first_pass_indices[output_target] == i) {
+            const s_render_target_desc* const desc = &graph->targets[output_target];
+            const int surf_index = FindFreeRenderGraphSurface(&context->pers->surfs, surf_target_indices, RenderTargetSize(desc->size, context->display_size), desc->format);
+
+            if (surf_index == -1) {
+                fprintf(stderr, "Ran out of surfaces to back render graph targets with!\n");
+                return false;
+            }
+
+            target_surf_indices[output_target] = surf_index;
+            surf_target_indices[surf_index] = output_target;
+        }
+
+        s_render_pass_info pass_info = {
+            .user_data = pass->user_data,
+            .input_cnt = pass->input_cnt
+        };
+
+        for (int j = 0; j < pass->input_cnt; j++) {
+            pass_info.input_surf_indices[j] = target_surf_indices[pass->input_targets[j]];
+        }
+
+        if (output_target != RENDER_GRAPH_DISPLAY_TARGET) {
+            const s_render_target_desc* const desc = &graph->targets[output_target];
+
+            if (!PushSurface(context, target_surf_indices[output_target], RenderTargetSize(desc->size, context->display_size), desc->format)) {
+                return false;
+            }
+        }
+
+        const bool pass_succeeded = pass->func(context, &pass_info);
+
+        Flush(context);
+
+        if (output_target != RENDER_GRAPH_DISPLAY_TARGET) {
+            UnsetSurface(context);
+        }
+
+        if (!pass_succeeded) {
+            return false;
+        }
+
+        // Release the surfaces of targets that are no longer needed.
+        for (int j = -1; j < pass->input_cnt; j++) {
+            const int target = j == -1 ? output_target : pass->input_targets[j];
+
+            if (target != RENDER_GRAPH_DISPLAY_TARGET && target_last_pass_indices[target] == i) {
+                surf_target_indices[target_surf_indices[target]] = -1;
+            }
+        }
+    }
+
+    return true;
+}
+
+void InitDynamicRes(s_dynamic_res* const dynamic_res, const float target_gpu_time) {
+    assert(dynamic_res);
+    assert(IsZero(dynamic_res, sizeof(*dynamic_res)));
+    assert(target_gpu_time > 0.0f);
+
+    dynamic_res->scale = DYNAMIC_RES_SCALE_MAX;
+    dynamic_res->target_gpu_time = target_gpu_time;
+    dynamic_res->surf_index = -1;
+
+    glGenQueries(DYNAMIC_RES_QUERY_CNT, dynamic_res->query_gl_ids);
+}
+
+void CleanDynamicRes(s_dynamic_res* const dynamic_res) {
+    assert(dynamic_res);
+    assert(dynamic_res->surf_index == -1);
+
+    glDeleteQueries(DYNAMIC_RES_QUERY_CNT, dynamic_res->query_gl_ids);
+
+    ZeroOut(dynamic_res, sizeof(*dynamic_res));
+}
+
+// Feeds in the results of any queries which have finished, without waiting on those which haven't.
+static void UpdateDynamicResScale(s_dynamic_res* const dynamic_res) {
+    while (dynamic_res->query_cnt > 0) {
+        const t_gl_id query_gl_id = dynamic_res->query_gl_ids[dynamic_res->query_begin];
+
+        GLint available = 0;
+        glGetQueryObjectiv(query_gl_id, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available) {
+            break;
+        }
+
+        GLuint64 elapsed = 0; // In nanoseconds.
+        glGetQueryObjectui64v(query_gl_id, GL_QUERY_RESULT, &elapsed);
+
+        const float gpu_time = (float)elapsed / 1000000.0f;
+
+        if (dynamic_res->gpu_time == 0.0f) {
+            dynamic_res->gpu_time = gpu_time;
+        } else {
+            dynamic_res->gpu_time = Lerp(dynamic_res->gpu_time, gpu_time, DYNAMIC_RES_GPU_TIME_SMOOTHING);
+        }
+
+        const float query_scale = dynamic_res->query_scales[dynamic_res->query_begin];
+
+        dynamic_res->query_begin = (dynamic_res->query_begin + 1) % DYNAMIC_RES_QUERY_CNT;
+        dynamic_res->query_cnt--;
+
+        if (dynamic_res->gpu_time <= 0.0f) {
+            continue;
+        }
+
+        const float time_ratio = dynamic_res->target_gpu_time / dynamic_res->gpu_time;
+
+        if (fabsf(time_ratio - 1.0f) <= DYNAMIC_RES_GPU_TIME_TOLERANCE) {
+            continue;
+        }
+
+        // The cost of the pass goes with its pixel count, so with the square of the scale.
+        const float scale_ideal = query_scale * sqrtf(time_ratio);
+        const float scale_step = CLAMP(scale_ideal - dynamic_res->scale, -DYNAMIC_RES_SCALE_STEP_LIMIT, DYNAMIC_RES_SCALE_STEP_LIMIT);
+        dynamic_res->scale = CLAMP(dynamic_res->scale + scale_step, DYNAMIC_RES_SCALE_MIN, DYNAMIC_RES_SCALE_MAX);
+    }
+}
+
+// Sets the given surface at the current dynamic resolution scale. As the projection is still based on the display size, what is rendered comes out the same as it would at full resolution, only with fewer pixels.
+bool BeginDynamicResPass(const s_rendering_context* const context, s_dynamic_res* const dynamic_res, const int surf_index) {
+    assert(context);
+    assert(dynamic_res);
+    assert(dynamic_res->surf_index == -1 && "A dynamic resolution pass is already active!");
+
+    Flush(context);
+
+    UpdateDynamicResScale(dynamic_res);
+
+    const s_vec_2d_i size = {
+        MAX((int)roundf(context->display_size.x * dynamic_res->scale), 1),
+        MAX((int)roundf(context->display_size.y * dynamic_res->scale), 1)
+    };
+
+    if (!PushSurface(context, surf_index, size, ek_render_target_format_rgba8)) {
+        return false;
+    }
+
+    dynamic_res->surf_index = surf_index;
+
+    // If every query is still in flight the pass just goes untimed, as the GPU is far enough behind that there are results on the way regardless.
+    dynamic_res->pass_timed = dynamic_res->query_cnt < DYNAMIC_RES_QUERY_CNT;
+
+    if (dynamic_res->pass_timed) {
+        const int query_index = (dynamic_res->query_begin + dynamic_res->query_cnt) % DYNAMIC_RES_QUERY_CNT;
+        glBeginQuery(GL_TIME_ELAPSED, dynamic_res->query_gl_ids[query_index]);
+        dynamic_res->query_scales[query_index] = dynamic_res->scale;
+    }
+
+    return true;
+}
+
+// Unsets the surface of the pass and upscales it to whatever is rendered to next, which is then at full resolution again.
+void EndDynamicResPass(const s_rendering_context* const context, s_dynamic_res* const dynamic_res) {
+    assert(context);
+    assert(dynamic_res);
+    assert(dynamic_res->surf_index != -1 && "No dynamic resolution pass is active!");
+
+    Flush(context);
+    UnsetSurface(context);
+
+    s_gl_state_cache* const gl_state_cache = &context->state->gl_state_cache;
+    const s_render_surfaces* const surfs = &context->pers->surfs;
+    const s_vec_2d_i dest_size = gl_state_cache->viewport_size;
+
+    BlitSurface(gl_state_cache, surfs, dynamic_res->surf_index, 0, 0, dest_size.x, dest_size.y, GL_LINEAR);
+
+    if (dynamic_res->pass_timed) {
+        glEndQuery(GL_TIME_ELAPSED);
+        dynamic_res->query_cnt++;
+    }
+
+    dynamic_res->surf_index = -1;
+    dynamic_res->pass_timed = false;
+}
+
+// Sets the surface at the display size divided by the scale. The view translation is snapped to
+// whole virtual pixels, with the remainder applied in the upscale so that scrolling stays smooth.
+bool BeginVirtualResPass(const s_rendering_context* const context, const int surf_index, const int scale) {
+    assert(context);
+    assert(scale > 0);
+
+    s_rendering_state* const rs = context->state;
+
+    assert(rs->virtual_res_scale == 0 && "A virtual resolution pass is already active!");
+
+    Flush(context);
+
+    // There's a virtual pixel of margin on each side, so that the upscale can shift the surface by up to one without leaving a gap.
+    const s_vec_2d_i size = {
+        ((context->display_size.x + scale - 1) / scale) + 2,
+        ((context->display_size.y + scale - 1) / scale) + 2
+    };
+
+    if (!PushSurface(context, surf_index, size, ek_render_target_format_rgba8)) {
+        return false;
+    }
+
+    const s_vec_2d trans = {rs->view_mat[3][0], rs->view_mat[3][1]};
+    const s_vec_2d trans_snapped = {floorf(trans.x / scale) * scale, floorf(trans.y / scale) * scale};
+
+    rs->view_mat[3][0] = trans_snapped.x;
+    rs->view_mat[3][1] = trans_snapped.y;
+
+    rs->virtual_res_scale = scale;
+    rs->virtual_res_surf_index = surf_index;
+    rs->virtual_res_view_offs = Vec2DDiff(trans, trans_snapped);
+    rs->frame_uniforms_dirty = true;
+
+    return true;
+}
+
+// Unsets the surface of the pass and upscales it by the integer scale, restoring the view translation.
+void EndVirtualResPass(const s_rendering_context* const context) {
+    assert(context);
+
+    s_rendering_state* const rs = context->state;
+
+    assert(rs->virtual_res_scale != 0 && "No virtual resolution pass is active!");
+
+    Flush(context);
+    UnsetSurface(context);
+
+    const int scale = rs->virtual_res_scale;
+    const s_render_surfaces* const surfs = &context->pers->surfs;
+    const s_vec_2d_i src_size = surfs->sizes[rs->virtual_res_surf_index];
+    const s_vec_2d_i dest_size = rs->gl_state_cache.viewport_size;
+
+    // The offset can only be applied in whole display pixels, as precise as full resolution anyway.
+    const s_vec_2d_i offs = {(int)roundf(rs->virtual_res_view_offs.x), (int)roundf(rs->virtual_res_view_offs.y)};
+
+    // The destination is given in framebuffer coordinates, which go bottom-up.
+    const int dest_left = offs.x - scale;
+    const int dest_top = dest_size.y - (offs.y - scale);
+
+    BlitSurface(&rs->gl_state_cache, surfs, rs->virtual_res_surf_index, dest_left, dest_top - (src_size.y * scale), dest_left + (src_size.x * scale), dest_top, GL_NEAREST);
+
+    rs->view_mat[3][0] += rs->virtual_res_view_offs.x;
+    rs->view_mat[3][1] += rs->virtual_res_view_offs.y;
+
+    rs->virtual_res_scale = 0;
+    rs->virtual_res_surf_index = 0;
+    rs->virtual_res_view_offs = (s_vec_2d){0};
+    rs->frame_uniforms_dirty = true;
+}
+
+// Shared between the particle simulation and rendering shaders, matching s_particle.
+static const char* const g_particle_struct_src =
+    "struct Particle {\n"
+    "    vec2 pos;\n"
+    "    vec2 vel;\n"
+    "    float age;\n"
+    "    float lifetime;\n"
+    "    float size_begin;\n"
+    "    float size_end;\n"
+    "    float drag;\n"
+    "    uint col_begin;\n"
+    "    uint col_end;\n"
+    "    uint padding;\n"
+    "};\n";
+
+// Each simulation step takes four dispatches:
+//
+// 0. A single invocation sizes the update dispatch to the live count, and resets the count of the destination buffer.
+// 1. Each live particle is advanced, and appended to the destination buffer unless it has outlived its lifetime.
+// 2. Each particle emitted since the last step is generated from its burst, advanced by the ticks passed since, and appended.
+// 3. A single invocation makes the destination count the new live count, which is also the instance count of the draw.
+static bool LoadParticleShaderProgs(s_particle_system* const sys, const char* const cache_dir) {
+    const char* const comp_shader_body_src =
+        "struct Burst {\n"
+        "    vec2 pos;\n"
+        "    float dir;\n"
+        "    float spread;\n"
+        "    float spd_min;\n"
+        "    float spd_max;\n"
+        "    float lifetime_min;\n"
+        "    float lifetime_max;\n"
+        "    float size_begin;\n"
+        "    float size_end;\n"
+        "    float drag;\n"
+        "    uint col_begin;\n"
+        "    uint col_end;\n"
+        "    uint particle_begin;\n"
+        "    uint tick_cnt;\n"
+        "    uint padding;\n"
+        "};\n"
+        "layout (std430, binding = 0) readonly buffer SrcParticles { Particle src_particles[]; };\n"
+        "layout (std430, binding = 1) writeonly buffer DestParticles { Particle dest_particles[]; };\n"
+        "layout (std430, binding = 2) buffer State {\n"
+        "    uint work_group_cnts[3];\n"
+        "    uint vert_cnt;\n"
+        "    uint inst_cnt;\n"
+        "    uint first_vert;\n"
+        "    uint base_inst;\n"
+        "    uint live_cnt;\n"
+        "    uint dest_cnt;\n"
+        "};\n"
+        "layout (std430, binding = 3) readonly buffer Bursts { Burst bursts[]; };\n"
+        "uniform int u_stage;\n"
+        "uniform uint u_tick_cnt;\n"
+        "uniform uint u_emit_cnt;\n"
+        "uniform uint u_burst_cnt;\n"
+        "uniform uint u_particle_limit;\n"
+        "uniform uint u_seed;\n"
+        "uint Hash(uint x) {\n"
+        "    x ^= x >> 16;\n"
+        "    x *= 0x7FEB352Du;\n"
+        "    x ^= x >> 15;\n"
+        "    x *= 0x846CA68Bu;\n"
+        "    x ^= x >> 16;\n"
+        "    return x;\n"
+        "}\n"
+        "float Rand(inout uint rng) {\n"
+        "    rng = Hash(rng);\n"
+        "    return float(rng >> 8) * (1.0 / 16777216.0);\n"
+        "}\n"
+        // Each tick moves by the velocity and then applies drag, so the distance covered over many is a geometric series.
+        "void Advance(inout Particle p, float tick_cnt) {\n"
+        "    float vel_kept = pow(1.0 - p.drag, tick_cnt);\n"
+        "    p.pos += p.vel * (p.drag > 0.0 ? (1.0 - vel_kept) / p.drag : tick_cnt);\n"
+        "    p.vel *= vel_kept;\n"
+        "    p.age += tick_cnt;\n"
+        "}\n"
+        "void Append(Particle p) {\n"
+        "    uint index = atomicAdd(dest_cnt, 1u);\n"
+        "    if (index < u_particle_limit) {\n"
+        "        dest_particles[index] = p;\n"
+        "    }\n"
+        "}\n"
+        "void main() {\n"
+        "    uint index = gl_GlobalInvocationID.x;\n"
+        "    if (u_stage == 0) {\n"
+        "        if (index == 0u) {\n"
+        "            work_group_cnts[0] = (live_cnt + WORK_GROUP_SIZE - 1u) / WORK_GROUP_SIZE;\n"
+        "            work_group_cnts[1] = 1u;\n"
+        "            work_group_cnts[2] = 1u;\n"
+        "            dest_cnt = 0u;\n"
+        "        }\n"
+        "    } else if (u_stage == 1) {\n"
+        "        if (index < live_cnt) {\n"
+        "            Particle p = src_particles[index];\n"
+        "            Advance(p, float(u_tick_cnt));\n"
+        "            if (p.age < p.lifetime) {\n"
+        "                Append(p);\n"
+        "            }\n"
+        "        }\n"
+        "    } else if (u_stage == 2) {\n"
+        "        if (index < u_emit_cnt) {\n"
+        "            uint low = 0u;\n"
+        "            uint high = u_burst_cnt - 1u;\n"
+        "            while (low < high) {\n"
+        "                uint mid = (low + high + 1u) / 2u;\n"
+        "                if (bursts[mid].particle_begin <= index) {\n"
+        "                    low = mid;\n"
+        "                } else {\n"
+        "                    high = mid - 1u;\n"
+        "                }\n"
+        "            }\n"
+        "            Burst burst = bursts[low];\n"
+        "            uint rng = Hash(index ^ Hash(u_seed));\n"
+        "            float dir = burst.dir + ((Rand(rng) - 0.5) * burst.spread);\n"
+        "            float spd = mix(burst.spd_min, burst.spd_max, Rand(rng));\n"
+        "            Particle p;\n"
+        "            p.pos = burst.pos;\n"
+        "            p.vel = vec2(cos(dir), -sin(dir)) * spd;\n"
+        "            p.age = 0.0;\n"
+        "            p.lifetime = mix(burst.lifetime_min, burst.lifetime_max, Rand(rng));\n"
+        "            p.size_begin = burst.size_begin;\n"
+        "            p.size_end = burst.size_end;\n"
+        "            p.drag = burst.drag;\n"
+        "            p.col_begin = burst.col_begin;\n"
+        "            p.col_end = burst.col_end;\n"
+        "            p.padding = 0u;\n"
+        "            Advance(p, float(burst.tick_cnt));\n"
+        "            if (p.age < p.lifetime) {\n"
+        "                Append(p);\n"
+        "            }\n"
+        "        }\n"
+        "    } else if (index == 0u) {\n"
+        "        live_cnt = min(dest_cnt, u_particle_limit);\n"
+        "        inst_cnt = live_cnt;\n"
+        "    }\n"
+        "}";
+
+    // Each particle is drawn as a quad made up from the vertex index, with no vertex attributes at all.
+    const char* const vert_shader_body_src =
+        "layout (std430, binding = 0) readonly buffer Particles { Particle particles[]; };\n"
+        "layout (std140) uniform FrameUniforms {\n"
+        "    mat4 u_proj;\n"
+        "    mat4 u_view;\n"
+        "    vec2 u_display_size;\n"
+        "    float u_time;\n"
+        "};\n"
+        "out vec4 v_col;\n"
+        "const vec2 k_quad_verts[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));\n"
+        "void main() {\n"
+        "    Particle p = particles[gl_InstanceID];\n"
+        "    float life_frac = clamp(p.age / p.lifetime, 0.0, 1.0);\n"
+        "    float size = mix(p.size_begin, p.size_end, life_frac);\n"
+        "    vec2 world_pos = p.pos + ((k_quad_verts[gl_VertexID] - 0.5) * size);\n"
+        "    gl_Position = u_proj * u_view * vec4(world_pos, 0.0, 1.0);\n"
+        "    v_col = mix(unpackUnorm4x8(p.col_begin), unpackUnorm4x8(p.col_end), life_frac);\n"
+        "}";
+
+    const char* const frag_shader_src =
+        "#version 430 core\n"
+        "in vec4 v_col;\n"
+        "out vec4 o_frag_color;\n"
+        "void main() {\n"
+        "    o_frag_color = v_col;\n"
+        "}";
 
-    if (!str[0]) {
-        return true;
-    }
+    char comp_shader_src[8192];
+    const int comp_shader_src_len = snprintf(comp_shader_src, sizeof(comp_shader_src), "#version 430 core\nlayout (local_size_x = %d) in;\n#define WORK_GROUP_SIZE %du\n%s%s", PARTICLE_WORK_GROUP_SIZE, PARTICLE_WORK_GROUP_SIZE, g_particle_struct_src, comp_shader_body_src);
+    assert(comp_shader_src_len > 0 && comp_shader_src_len < (int)sizeof(comp_shader_src));
 
-    const int str_len = strlen(str);
-    const s_vec_2d* const str_chr_positions = PushStrChrPositions(str, temp_mem_arena, font_index, fonts, pos, hor_align, ver_align);
+    char vert_shader_src[4096];
+    const int vert_shader_src_len = snprintf(vert_shader_src, sizeof(vert_shader_src), "#version 430 core\n%s%s", g_particle_struct_src, vert_shader_body_src);
+    assert(vert_shader_src_len > 0 && vert_shader_src_len < (int)sizeof(vert_shader_src));
 
-    if (!str_chr_positions) {
+    const s_shader_prog_srcs srcs_list[] = {
+        {.comp_src = comp_shader_src},
+        {.vert_src = vert_shader_src, .frag_src = frag_shader_src}
+    };
+
+    t_gl_id prog_gl_ids[2] = {0};
+
+    if (!CreateShaderProgs(prog_gl_ids, srcs_list, 2, cache_dir) || !prog_gl_ids[0] || !prog_gl_ids[1]) {
+        glDeleteProgram(prog_gl_ids[0]);
+        glDeleteProgram(prog_gl_ids[1]);
         return false;
     }
 
-    const t_gl_id font_tex_gl_id = fonts->tex_gl_ids[font_index];
+    sys->sim_prog_gl_id = prog_gl_ids[0];
+    sys->sim_stage_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_stage");
+    sys->sim_tick_cnt_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_tick_cnt");
+    sys->sim_emit_cnt_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_emit_cnt");
+    sys->sim_burst_cnt_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_burst_cnt");
+    sys->sim_particle_limit_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_particle_limit");
+    sys->sim_seed_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_seed");
 
-    const s_vec_2d_i font_tex_size = {
-        .x = FONT_TEXTURE_WIDTH,
-        .y = fonts->tex_heights[font_index]
-    };
+    sys->render_prog_gl_id = prog_gl_ids[1];
+    BindFrameUniformBlock(sys->render_prog_gl_id);
 
-    for (int i = 0; i < str_len; ++i) {
-        const char c = str[i];
+    return true;
+}
 
-        if (c == '\0' || c == ' ') {
-            continue;
-        }
+bool InitParticleSystem(s_particle_system* const sys, const int particle_limit, const char* const shader_prog_cache_dir) {
+    assert(sys);
+    assert(IsZero(sys, sizeof(*sys)));
+    assert(particle_limit > 0);
 
-        const int chr_index = c - FONT_CHR_RANGE_BEGIN;
-        const s_rect_i chr_src_rect = fonts->arrangement_infos[font_index].chr_src_rects[chr_index];
-        const s_rect_edges chr_tex_coords = CalcTextureCoords(chr_src_rect, font_tex_size);
+    if (!LoadParticleShaderProgs(sys, shader_prog_cache_dir)) {
+        fprintf(stderr, "Failed to load particle shader programs!\n");
+        return false;
+    }
 
-        Render(
-            context,
-            font_tex_gl_id,
-            chr_tex_coords,
-            str_chr_positions[i],
-            (s_vec_2d){chr_src_rect.width, chr_src_rect.height},
-            VEC_2D_ZERO,
-            0.0f,
-            blend
-        );
+    sys->particle_limit = particle_limit;
+
+    glGenBuffers(2, sys->particle_buf_gl_ids);
+
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->particle_buf_gl_ids[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(s_particle) * particle_limit, NULL, GL_DYNAMIC_COPY);
+    }
+
+    {
+        const s_particle_sim_state state = {
+            .work_group_cnts = {0, 1, 1},
+            .vert_cnt = 6
+        };
+
+        glGenBuffers(1, &sys->state_buf_gl_id);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->state_buf_gl_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(state), &state, GL_DYNAMIC_COPY);
     }
 
+    glGenBuffers(1, &sys->burst_buf_gl_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->burst_buf_gl_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(sys->bursts), NULL, GL_STREAM_DRAW);
+
+    glGenVertexArrays(1, &sys->vert_array_gl_id);
+
     return true;
 }
- 
-void RenderRect(const s_rendering_context* const context, const s_rect rect, const s_color blend) {
-    assert(rect.width > 0.0f && rect.height > 0.0f);
-    assert(IsColorValid(blend));
 
-    const s_rect_edges tex_coords = {0.0f, 0.0f, 1.0f, 1.0f};
-    const s_vec_2d pos = {rect.x, rect.y};
-    const s_vec_2d size = {rect.width, rect.height};
-    Render(context, context->pers->px_tex_gl_id, tex_coords, pos, size, (s_vec_2d){0}, 0.0f, blend);
-}
+void CleanParticleSystem(s_particle_system* const sys) {
+    assert(sys);
 
-void RenderRectOutline(const s_rendering_context* const context, const s_rect rect, const s_color blend, const float thickness) {
-    assert(rect.width > 0.0f && rect.height > 0.0f);
-    assert(IsColorValid(blend));
-    assert(thickness > 0.0f);
+    glDeleteVertexArrays(1, &sys->vert_array_gl_id);
+    glDeleteBuffers(1, &sys->burst_buf_gl_id);
+    glDeleteBuffers(1, &sys->state_buf_gl_id);
+    glDeleteBuffers(2, sys->particle_buf_gl_ids);
+    glDeleteProgram(sys->render_prog_gl_id);
+    glDeleteProgram(sys->sim_prog_gl_id);
 
-    const s_rect top = {rect.x - thickness, rect.y - thickness, rect.width + thickness, thickness};
-    const s_rect right = {rect.x + rect.width, rect.y - thickness, thickness, rect.height + thickness};
-    const s_rect bottom = {rect.x, rect.y + rect.height, rect.width + thickness, thickness};
-    const s_rect left = {rect.x - thickness, rect.y, thickness, rect.height + thickness};
+    ZeroOut(sys, sizeof(*sys));
+}
 
-    RenderRect(context, top, blend);
-    RenderRect(context, right, blend);
-    RenderRect(context, bottom, blend);
-    RenderRect(context, left, blend);
+static uint32_t ColorToPackedUnorm8x4(const s_color col) {
+    return (uint32_t)ToUnorm8(col.r) | ((uint32_t)ToUnorm8(col.g) << 8) | ((uint32_t)ToUnorm8(col.b) << 16) | ((uint32_t)ToUnorm8(col.a) << 24);
 }
 
-void RenderLine(const s_rendering_context* const context, const s_vec_2d a, const s_vec_2d b, const s_color blend, const float width) {
-    assert(IsColorValid(blend));
-    assert(width > 0.0f);
+// Only records the emission, which costs the same regardless of how many particles it makes. Emissions are dropped once the burst limit is reached, or cut short once they'd take the emitted count past the particle limit.
+void EmitParticles(s_particle_system* const sys, const s_particle_emit_info* const info) {
+    assert(sys);
+    assert(info);
+    assert(info->cnt >= 0);
+    assert(info->spread >= 0.0f);
+    assert(info->spd_min >= 0.0f && info->spd_min <= info->spd_max);
+    assert(info->lifetime_min > 0 && info->lifetime_min <= info->lifetime_max);
+    assert(info->size_begin >= 0.0f && info->size_end >= 0.0f);
+    assert(info->drag >= 0.0f && info->drag < 1.0f);
 
-    const float dx = b.x - a.x;
-    const float dy = b.y - a.y;
-    const float len = sqrtf(dx * dx + dy * dy);
-    const float rot = atan2f(dy, dx);
+    const int cnt = MIN(info->cnt, sys->particle_limit - sys->emit_cnt);
 
-    const s_vec_2d size = {len, width};
-    const s_vec_2d origin = {0.0f, 0.5f};
+    if (cnt <= 0 || sys->burst_cnt == PARTICLE_BURST_LIMIT) {
+        return;
+    }
 
-    const s_rect_edges tex_coords = {0.0f, 0.0f, 1.0f, 1.0f};
+    sys->bursts[sys->burst_cnt] = (s_particle_burst){
+        .pos = info->pos,
+        .dir = info->dir,
+        .spread = info->spread,
+        .spd_min = info->spd_min,
+        .spd_max = info->spd_max,
+        .lifetime_min = (float)info->lifetime_min,
+        .lifetime_max = (float)info->lifetime_max,
+        .size_begin = info->size_begin,
+        .size_end = info->size_end,
+        .drag = info->drag,
+        .col_begin = ColorToPackedUnorm8x4(info->col_begin),
+        .col_end = ColorToPackedUnorm8x4(info->col_end),
+        .particle_begin = (uint32_t)sys->emit_cnt,
+        .tick_cnt = (uint32_t)sys->pending_tick_cnt // Turned into the ticks passed since once simulated.
+    };
 
-    Render(context, context->pers->px_tex_gl_id, tex_coords, a, size, origin, rot, blend);
+    sys->burst_cnt++;
+    sys->emit_cnt += cnt;
 }
 
-void RenderPolyOutline(const s_rendering_context* const context, const s_poly poly, const s_color blend, const float width) {
-    assert(IsColorValid(blend));
-    assert(width > 0.0f);
+// Removes every particle, including those of emissions not yet simulated.
+void ClearParticles(s_particle_system* const sys) {
+    assert(sys);
 
-    for (int i = 0; i < poly.cnt; i++) {
-        const s_vec_2d a = poly.pts[i];
-        const s_vec_2d b = poly.pts[(i + 1) % poly.cnt];
-        RenderLine(context, a, b, blend, width);
-    }
+    const uint32_t live_cnt = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->state_buf_gl_id);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetof(s_particle_sim_state, live_cnt), sizeof(live_cnt), &live_cnt);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetof(s_particle_sim_state, inst_cnt), sizeof(live_cnt), &live_cnt);
+
+    sys->burst_cnt = 0;
+    sys->emit_cnt = 0;
+    sys->pending_tick_cnt = 0;
 }
 
-void RenderBarHor(const s_rendering_context* const context, const s_rect rect, const float perc, const s_color_rgb col_front, const s_color_rgb col_back) {
-    assert(perc >= 0.0f && perc <= 1.0f);
-    assert(IsColorRGBValid(col_front));
-    assert(IsColorRGBValid(col_back));
+// Meant to be called once per tick. The particles aren't touched until they're next rendered, at which point they're simulated for every tick passed.
+void UpdateParticles(s_particle_system* const sys) {
+    assert(sys);
+    sys->pending_tick_cnt++;
+}
 
-    s_rect left_rect = {rect.x, rect.y, 0.0f, rect.height};
+static void SimulateParticles(const s_rendering_context* const context, s_particle_system* const sys) {
+    s_gl_state_cache* const gl_state_cache = &context->state->gl_state_cache;
 
-    // Only render the left rectangle if percentage is not 0.
-    if (perc > 0.0f) {
-        left_rect.width = rect.width * perc;
-        const s_color col = {col_front.r, col_front.g, col_front.b, 1.0f};
-        RenderRect(context, left_rect, col);
+    if (sys->burst_cnt > 0) {
+        for (int i = 0; i < sys->burst_cnt; i++) {
+            sys->bursts[i].tick_cnt = (uint32_t)sys->pending_tick_cnt - sys->bursts[i].tick_cnt;
+        }
+
+        // Orphaned rather than updated in place, so we never wait on the previous step still reading it.
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->burst_buf_gl_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(sys->bursts), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(sys->bursts[0]) * sys->burst_cnt, sys->bursts);
     }
 
-    // Only render right rectangle if percentage is not 100.
-    if (perc < 1.0f) {
-        const s_rect right_rect = {rect.x + left_rect.width, rect.y, rect.width - left_rect.width, rect.height};
-        const s_color col = {col_back.r, col_back.g, col_back.b, 1.0f};
-        RenderRect(context, right_rect, col);
+    const int dest_particle_buf_index = !sys->src_particle_buf_index;
+
+    UseShaderProg(gl_state_cache, sys->sim_prog_gl_id);
+    glUniform1ui(sys->sim_tick_cnt_uniform_loc, (GLuint)sys->pending_tick_cnt);
+    glUniform1ui(sys->sim_emit_cnt_uniform_loc, (GLuint)sys->emit_cnt);
+    glUniform1ui(sys->sim_burst_cnt_uniform_loc, (GLuint)sys->burst_cnt);
+    glUniform1ui(sys->sim_particle_limit_uniform_loc, (GLuint)sys->particle_limit);
+    glUniform1ui(sys->sim_seed_uniform_loc, sys->seed);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sys->particle_buf_gl_ids[sys->src_particle_buf_index]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sys->particle_buf_gl_ids[dest_particle_buf_index]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, sys->state_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, sys->burst_buf_gl_id);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, sys->state_buf_gl_id);
+
+    glUniform1i(sys->sim_stage_uniform_loc, 0);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    glUniform1i(sys->sim_stage_uniform_loc, 1);
+    glDispatchComputeIndirect((GLintptr)offsetof(s_particle_sim_state, work_group_cnts));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    if (sys->emit_cnt > 0) {
+        glUniform1i(sys->sim_stage_uniform_loc, 2);
+        glDispatchCompute((sys->emit_cnt + PARTICLE_WORK_GROUP_SIZE - 1) / PARTICLE_WORK_GROUP_SIZE, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
     }
+
+    glUniform1i(sys->sim_stage_uniform_loc, 3);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    sys->src_particle_buf_index = dest_particle_buf_index;
+    sys->burst_cnt = 0;
+    sys->emit_cnt = 0;
+    sys->pending_tick_cnt = 0;
+    sys->seed++;
 }
 
-void SetSurface(const s_rendering_context* const rendering_context, const int surf_index) {
-    // NOTE: Should flushing be a prerequisite to this?
+// Catches the simulation up if needed, then draws every live particle with a single indirect draw.
+void RenderParticles(const s_rendering_context* const context, s_particle_system* const sys) {
+    assert(context);
+    assert(!context->state->queue_active && "Particles cannot be rendered while a render queue is active!");
+    assert(sys);
 
-    assert(rendering_context);
+    Flush(context);
 
-    s_rendering_state* const rs = rendering_context->state;
+    if (sys->pending_tick_cnt > 0 || sys->burst_cnt > 0) {
+        SimulateParticles(context, sys);
+    }
 
-    assert(surf_index >= 0 && surf_index < RENDER_SURFACE_LIMIT);
-    assert(rs->surf_index_stack_height < RENDER_SURFACE_LIMIT);
+    if (context->state->frame_uniforms_dirty || !Vec2DIsEqual(context->state->frame_uniforms_display_size, context->display_size)) {
+        UploadFrameUniforms(context);
+    }
 
-    // Add the surface index to the stack.
-    rs->surf_index_stack[rs->surf_index_stack_height] = surf_index;
-    rs->surf_index_stack_height++;
+    s_gl_state_cache* const gl_state_cache = &context->state->gl_state_cache;
 
-    // Bind the surface framebuffer.
-    glBindFramebuffer(GL_FRAMEBUFFER, rendering_context->pers->surfs.framebuffer_gl_ids[surf_index]);
+    UseShaderProg(gl_state_cache, sys->render_prog_gl_id);
+    BindVertArray(gl_state_cache, sys->vert_array_gl_id);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sys->particle_buf_gl_ids[sys->src_particle_buf_index]);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, sys->state_buf_gl_id);
+    glDrawArraysIndirect(GL_TRIANGLES, (const void*)offsetof(s_particle_sim_state, vert_cnt));
 }
 
-void UnsetSurface(const s_rendering_context* const rendering_context) {
-    assert(rendering_context);
+static const char* const g_gpu_projectile_struct_src =
+    "struct Projectile {\n"
+    "    vec2 pos;\n"
+    "    vec2 vel;\n"
+    "    float rot;\n"
+    "    int dmg;\n"
+    "    uint hit_mask;\n"
+    "    uint padding;\n"
+    "};\n";
+
+// The simulation shader is run in stages, each being a separate dispatch:
+// 0. The live count is grown by the spawn count, and sizes the indirect dispatch of stage 2.
+// 1. Each spawned projectile is appended to the end of the source buffer.
+// 2. Each projectile is moved, then tested against the solid cells and the targets. Those that hit nothing are appended to the destination buffer.
+// 3. The surviving count becomes the new live count, and the instance count of the indirect draw.
+static bool LoadGPUProjectileShaderProgs(s_gpu_projectile_system* const sys, const char* const cache_dir) {
+    const char* const comp_shader_body_src =
+        "struct Target {\n"
+        "    vec4 rect;\n"
+        "    uint mask;\n"
+        "    uint padding[3];\n"
+        "};\n"
+        "struct Hit {\n"
+        "    uint target_index;\n"
+        "    int dmg;\n"
+        "    vec2 vel;\n"
+        "};\n"
+        "layout (std430, binding = 0) buffer SrcProjectiles { Projectile src_projs[]; };\n"
+        "layout (std430, binding = 1) writeonly buffer DestProjectiles { Projectile dest_projs[]; };\n"
+        "layout (std430, binding = 2) buffer State {\n"
+        "    uint work_group_cnts[3];\n"
+        "    uint vert_cnt;\n"
+        "    uint inst_cnt;\n"
+        "    uint first_vert;\n"
+        "    uint base_inst;\n"
+        "    uint live_cnt;\n"
+        "    uint src_cnt;\n"
+        "    uint dest_cnt;\n"
+        "};\n"
+        "layout (std430, binding = 3) readonly buffer Spawns { Projectile spawns[]; };\n"
+        "layout (std430, binding = 4) readonly buffer Targets { Target targets[]; };\n"
+        "layout (std430, binding = 5) readonly buffer SolidCells { uint solid_cells[]; };\n"
+        "layout (std430, binding = 6) buffer HitList {\n"
+        "    uint hit_cnt;\n"
+        "    uint hit_list_padding;\n"
+        "    Hit hits[];\n"
+        "};\n"
+        "uniform int u_stage;\n"
+        "uniform uint u_spawn_cnt;\n"
+        "uniform uint u_target_cnt;\n"
+        "uniform uint u_proj_limit;\n"
+        "uniform int u_grid_width;\n"
+        "uniform int u_grid_height;\n"
+        "uniform vec4 u_collider;\n" // Half the collider size, then the cell size.
+        "bool IsCellSolid(int x, int y) {\n"
+        "    if (x < 0 || y < 0 || x >= u_grid_width || y >= u_grid_height) {\n"
+        "        return true;\n"
+        "    }\n"
+        "    uint bit = uint((y * u_grid_width) + x);\n"
+        "    return (solid_cells[bit >> 5] & (1u << (bit & 31u))) != 0u;\n"
+        "}\n"
+        // A separating axis test of the rotated collider against the rect, with the axes of the rect covered by the bounding extents.
+        "bool DoesColliderIntersWithRect(vec2 pos, vec2 axis_x, vec2 axis_y, vec2 ext, vec4 rect) {\n"
+        "    vec2 rect_half_size = rect.zw * 0.5;\n"
+        "    vec2 diff = rect.xy + rect_half_size - pos;\n"
+        "    if (any(greaterThanEqual(abs(diff), ext + rect_half_size))) {\n"
+        "        return false;\n"
+        "    }\n"
+        "    return abs(dot(diff, axis_x)) < u_collider.x + dot(rect_half_size, abs(axis_x))\n"
+        "        && abs(dot(diff, axis_y)) < u_collider.y + dot(rect_half_size, abs(axis_y));\n"
+        "}\n"
+        "void main() {\n"
+        "    uint index = gl_GlobalInvocationID.x;\n"
+        "    if (u_stage == 0) {\n"
+        "        if (index == 0u) {\n"
+        "            src_cnt = min(live_cnt + u_spawn_cnt, u_proj_limit);\n"
+        "            work_group_cnts[0] = (src_cnt + WORK_GROUP_SIZE - 1u) / WORK_GROUP_SIZE;\n"
+        "            work_group_cnts[1] = 1u;\n"
+        "            work_group_cnts[2] = 1u;\n"
+        "            dest_cnt = 0u;\n"
+        "            hit_cnt = 0u;\n"
+        "        }\n"
+        "    } else if (u_stage == 1) {\n"
+        "        if (live_cnt + index < src_cnt) {\n"
+        "            src_projs[live_cnt + index] = spawns[index];\n"
+        "        }\n"
+        "    } else if (u_stage == 2) {\n"
+        "        if (index >= src_cnt) {\n"
+        "            return;\n"
+        "        }\n"
+        "        Projectile p = src_projs[index];\n"
+        "        p.pos += p.vel;\n"
+        "        vec2 axis_x = vec2(cos(p.rot), -sin(p.rot));\n"
+        "        vec2 axis_y = vec2(-axis_x.y, axis_x.x);\n"
+        "        vec2 ext = (abs(axis_x) * u_collider.x) + (abs(axis_y) * u_collider.y);\n"
+        "        ivec2 cell_min = ivec2(floor((p.pos - ext) / u_collider.z));\n"
+        "        ivec2 cell_max = ivec2(floor((p.pos + ext) / u_collider.z));\n"
+        "        for (int y = cell_min.y; y <= cell_max.y; y++) {\n"
+        "            for (int x = cell_min.x; x <= cell_max.x; x++) {\n"
+        "                if (IsCellSolid(x, y)) {\n"
+        "                    return;\n"
+        "                }\n"
+        "            }\n"
+        "        }\n"
+        "        for (uint i = 0u; i < u_target_cnt; i++) {\n"
+        "            if ((targets[i].mask & p.hit_mask) == 0u || !DoesColliderIntersWithRect(p.pos, axis_x, axis_y, ext, targets[i].rect)) {\n"
+        "                continue;\n"
+        "            }\n"
+        "            uint hit_index = atomicAdd(hit_cnt, 1u);\n"
+        "            if (hit_index < HIT_LIMIT) {\n"
+        "                hits[hit_index] = Hit(i, p.dmg, p.vel);\n"
+        "                return;\n"
+        "            }\n"
+        "            break;\n"
+        "        }\n"
+        "        uint dest_index = atomicAdd(dest_cnt, 1u);\n"
+        "        if (dest_index < u_proj_limit) {\n"
+        "            dest_projs[dest_index] = p;\n"
+        "        }\n"
+        "    } else if (index == 0u) {\n"
+        "        live_cnt = min(dest_cnt, u_proj_limit);\n"
+        "        inst_cnt = live_cnt;\n"
+        "    }\n"
+        "}";
 
-    s_rendering_state* const rs = rendering_context->state;
+    // Each projectile in the view rect is appended to the culled buffer, and counted as an instance of its draw.
+    const char* const cull_comp_shader_body_src =
+        "layout (std430, binding = 0) readonly buffer Projectiles { Projectile projs[]; };\n"
+        "layout (std430, binding = 1) writeonly buffer CulledProjectiles { Projectile culled_projs[]; };\n"
+        "layout (std430, binding = 2) readonly buffer State {\n"
+        "    uint work_group_cnts[3];\n"
+        "    uint vert_cnt;\n"
+        "    uint inst_cnt;\n"
+        "    uint first_vert;\n"
+        "    uint base_inst;\n"
+        "    uint live_cnt;\n"
+        "};\n"
+        "layout (std430, binding = 3) buffer DrawCmd {\n"
+        "    uint draw_vert_cnt;\n"
+        "    uint draw_inst_cnt;\n"
+        "    uint draw_first_vert;\n"
+        "    uint draw_base_inst;\n"
+        "};\n"
+        "uniform vec4 u_view_rect;\n" // Left, top, right, bottom.
+        "void main() {\n"
+        "    uint index = gl_GlobalInvocationID.x;\n"
+        "    if (index >= live_cnt) {\n"
+        "        return;\n"
+        "    }\n"
+        "    Projectile p = projs[index];\n"
+        "    if (any(lessThan(p.pos, u_view_rect.xy)) || any(greaterThan(p.pos, u_view_rect.zw))) {\n"
+        "        return;\n"
+        "    }\n"
+        "    culled_projs[atomicAdd(draw_inst_cnt, 1u)] = p;\n"
+        "}";
 
-    assert(rs->batch_slots_used_cnt == 0);
-    assert(rs->surf_index_stack_height > 0);
+    // As with particles, each projectile is drawn as a quad made up from the vertex index.
+    const char* const vert_shader_body_src =
+        "layout (std430, binding = 0) readonly buffer Projectiles { Projectile projs[]; };\n"
+        "layout (std140) uniform FrameUniforms {\n"
+        "    mat4 u_proj;\n"
+        "    mat4 u_view;\n"
+        "    vec2 u_display_size;\n"
+        "    float u_time;\n"
+        "};\n"
+        "uniform vec4 u_tex_coords;\n"
+        "uniform vec4 u_size_and_origin;\n"
+        "out vec2 v_tex_coord;\n"
+        "const vec2 k_quad_verts[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));\n"
+        "void main() {\n"
+        "    Projectile p = projs[gl_InstanceID];\n"
+        "    vec2 vert = k_quad_verts[gl_VertexID];\n"
+        "    vec2 local_pos = (vert - u_size_and_origin.zw) * u_size_and_origin.xy;\n"
+        "    float rot_cos = cos(p.rot);\n"
+        "    float rot_sin = -sin(p.rot);\n"
+        "    vec2 world_pos = vec2(\n"
+        "        (local_pos.x * rot_cos) - (local_pos.y * rot_sin),\n"
+        "        (local_pos.x * rot_sin) + (local_pos.y * rot_cos)) + p.pos;\n"
+        "    gl_Position = u_proj * u_view * vec4(world_pos, 0.0, 1.0);\n"
+        "    v_tex_coord = mix(u_tex_coords.xy, u_tex_coords.zw, vert);\n"
+        "}";
 
-    rs->surf_index_stack_height--;
+    const char* const frag_shader_src =
+        "#version 430 core\n"
+        "in vec2 v_tex_coord;\n"
+        "out vec4 o_frag_color;\n"
+        "uniform sampler2D u_tex;\n"
+        "uniform vec4 u_blend;\n"
+        "void main() {\n"
+        "    o_frag_color = texture(u_tex, v_tex_coord) * u_blend;\n"
+        "}";
 
-    if (rs->surf_index_stack_height == 0) {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    } else {
-        const int new_surf_index = rs->surf_index_stack_height;
-        const t_gl_id fb_gl_id = rendering_context->pers->surfs.framebuffer_gl_ids[new_surf_index];
-        glBindFramebuffer(GL_FRAMEBUFFER, rendering_context->pers->surfs.framebuffer_gl_ids[new_surf_index]);
+    char comp_shader_src[8192];
+    const int comp_shader_src_len = snprintf(comp_shader_src, sizeof(comp_shader_src), "#version 430 core\nlayout (local_size_x = %d) in;\n#define WORK_GROUP_SIZE %du\n#define HIT_LIMIT %du\n%s%s", GPU_PROJECTILE_WORK_GROUP_SIZE, GPU_PROJECTILE_WORK_GROUP_SIZE, GPU_PROJECTILE_HIT_LIMIT, g_gpu_projectile_struct_src, comp_shader_body_src);
+    assert(comp_shader_src_len > 0 && comp_shader_src_len < (int)sizeof(comp_shader_src));
+
+    char cull_comp_shader_src[4096];
+    const int cull_comp_shader_src_len = snprintf(cull_comp_shader_src, sizeof(cull_comp_shader_src), "#version 430 core\nlayout (local_size_x = %d) in;\n%s%s", GPU_PROJECTILE_WORK_GROUP_SIZE, g_gpu_projectile_struct_src, cull_comp_shader_body_src);
+    assert(cull_comp_shader_src_len > 0 && cull_comp_shader_src_len < (int)sizeof(cull_comp_shader_src));
+
+    char vert_shader_src[4096];
+    const int vert_shader_src_len = snprintf(vert_shader_src, sizeof(vert_shader_src), "#version 430 core\n%s%s", g_gpu_projectile_struct_src, vert_shader_body_src);
+    assert(vert_shader_src_len > 0 && vert_shader_src_len < (int)sizeof(vert_shader_src));
+
+    const s_shader_prog_srcs srcs_list[] = {
+        {.comp_src = comp_shader_src},
+        {.vert_src = vert_shader_src, .frag_src = frag_shader_src},
+        {.comp_src = cull_comp_shader_src}
+    };
+
+    t_gl_id prog_gl_ids[3] = {0};
+
+    if (!CreateShaderProgs(prog_gl_ids, srcs_list, 3, cache_dir) || !prog_gl_ids[0] || !prog_gl_ids[1] || !prog_gl_ids[2]) {
+        for (int i = 0; i < 3; i++) {
+            glDeleteProgram(prog_gl_ids[i]);
+        }
+
+        return false;
     }
-}
 
-void SetSurfaceShaderProg(const s_rendering_context* const rendering_context, const t_gl_id gl_id) {
-    assert(gl_id != 0);
-    // NOTE: Should we also trip an assert if current shader program GL ID is not 0?
+    sys->sim_prog_gl_id = prog_gl_ids[0];
+    sys->sim_stage_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_stage");
+    sys->sim_spawn_cnt_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_spawn_cnt");
+    sys->sim_target_cnt_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_target_cnt");
+    sys->sim_proj_limit_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_proj_limit");
+    sys->sim_grid_width_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_grid_width");
+    sys->sim_grid_height_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_grid_height");
+    sys->sim_collider_uniform_loc = glGetUniformLocation(sys->sim_prog_gl_id, "u_collider");
 
-    rendering_context->state->surf_shader_prog_gl_id = gl_id;
-    glUseProgram(rendering_context->state->surf_shader_prog_gl_id);
+    sys->render_prog_gl_id = prog_gl_ids[1];
+    sys->render_tex_coords_uniform_loc = glGetUniformLocation(sys->render_prog_gl_id, "u_tex_coords");
+    sys->render_size_and_origin_uniform_loc = glGetUniformLocation(sys->render_prog_gl_id, "u_size_and_origin");
+    sys->render_blend_uniform_loc = glGetUniformLocation(sys->render_prog_gl_id, "u_blend");
+    BindFrameUniformBlock(sys->render_prog_gl_id);
+
+    sys->cull_prog_gl_id = prog_gl_ids[2];
+    sys->cull_view_rect_uniform_loc = glGetUniformLocation(sys->cull_prog_gl_id, "u_view_rect");
+
+    return true;
 }
 
-void SetSurfaceShaderProgUniform(const s_rendering_context* const rendering_context, const char* const name, const s_shader_prog_uniform_value val) {
-    assert(rendering_context->state->surf_shader_prog_gl_id != 0 && "Surface shader program must be set before modifying uniforms!");
+bool InitGPUProjectileSystem(s_gpu_projectile_system* const sys, const int proj_limit, const s_vec_2d collider_size, const char* const shader_prog_cache_dir) {
+    assert(sys);
+    assert(IsZero(sys, sizeof(*sys)));
+    assert(proj_limit > 0);
+    assert(collider_size.x > 0.0f && collider_size.y > 0.0f);
 
-    const int loc = glGetUniformLocation(rendering_context->state->surf_shader_prog_gl_id, name);
-    assert(loc != -1 && "Failed to get location of shader uniform!");
+    if (!LoadGPUProjectileShaderProgs(sys, shader_prog_cache_dir)) {
+        fprintf(stderr, "Failed to load GPU projectile shader programs!\n");
+        return false;
+    }
 
-    switch (val.type) {
-        case ek_shader_prog_uniform_value_type_int:
-            glUniform1i(loc, val.as_int);
-            break;
+    sys->proj_limit = proj_limit;
+    sys->collider_size = collider_size;
 
-        case ek_shader_prog_uniform_value_type_float:
-            glUniform1f(loc, val.as_float);
-            break;
+    glGenBuffers(2, sys->proj_buf_gl_ids);
 
-        case ek_shader_prog_uniform_value_type_v2:
-            glUniform2f(loc, val.as_v2.x, val.as_v2.y);
-            break;
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->proj_buf_gl_ids[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(s_gpu_projectile) * proj_limit, NULL, GL_DYNAMIC_COPY);
+    }
 
-        case ek_shader_prog_uniform_value_type_v3:
-            glUniform3f(loc, val.as_v3.x, val.as_v3.y, val.as_v3.z);
-            break;
+    {
+        const s_gpu_projectile_sim_state state = {
+            .work_group_cnts = {0, 1, 1},
+            .vert_cnt = 6
+        };
 
-        case ek_shader_prog_uniform_value_type_v4:
-            glUniform4f(loc, val.as_v4.x, val.as_v4.y, val.as_v4.z, val.as_v4.w);
-            break;
+        glGenBuffers(1, &sys->state_buf_gl_id);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->state_buf_gl_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(state), &state, GL_DYNAMIC_COPY);
+    }
 
-        case ek_shader_prog_uniform_value_type_mat4x4:
-            glUniformMatrix4fv(loc, 1, false, &val.as_mat4x4[0][0]);
-            break;
+    glGenBuffers(1, &sys->spawn_buf_gl_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->spawn_buf_gl_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(sys->spawns), NULL, GL_STREAM_DRAW);
+
+    glGenBuffers(1, &sys->target_buf_gl_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->target_buf_gl_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(s_gpu_projectile_target) * GPU_PROJECTILE_TARGET_LIMIT, NULL, GL_STREAM_DRAW);
+
+    glGenBuffers(1, &sys->solid_cell_buf_gl_id);
+
+    glGenBuffers(GPU_PROJECTILE_HIT_READBACK_CNT, sys->hit_list_buf_gl_ids);
+
+    for (int i = 0; i < GPU_PROJECTILE_HIT_READBACK_CNT; i++) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->hit_list_buf_gl_ids[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(s_gpu_projectile_hit_list), NULL, GL_DYNAMIC_READ);
     }
+
+    glGenBuffers(1, &sys->culled_proj_buf_gl_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->culled_proj_buf_gl_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(s_gpu_projectile) * proj_limit, NULL, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &sys->culled_draw_cmd_buf_gl_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->culled_draw_cmd_buf_gl_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(s_gpu_projectile_draw_cmd), NULL, GL_DYNAMIC_COPY);
+
+    glGenVertexArrays(1, &sys->vert_array_gl_id);
+
+    return true;
 }
 
-void RenderSurface(const s_rendering_context* const rendering_context, const int surf_index) {
-    assert(surf_index >= 0 && surf_index < RENDER_SURFACE_LIMIT);
-    assert(rendering_context->state->surf_shader_prog_gl_id != 0 && "Surface shader program must be set before rendering a surface!");
+void CleanGPUProjectileSystem(s_gpu_projectile_system* const sys) {
+    assert(sys);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, rendering_context->pers->surfs.framebuffer_tex_gl_ids[surf_index]);
+    for (int i = 0; i < GPU_PROJECTILE_HIT_READBACK_CNT; i++) {
+        glDeleteSync(sys->hit_list_fences[i]);
+    }
 
-    glBindVertexArray(rendering_context->pers->surf_vert_array_gl_id);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rendering_context->pers->surf_elem_buf_gl_id);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, NULL);
+    glDeleteVertexArrays(1, &sys->vert_array_gl_id);
+    glDeleteBuffers(1, &sys->culled_draw_cmd_buf_gl_id);
+    glDeleteBuffers(1, &sys->culled_proj_buf_gl_id);
+    glDeleteBuffers(GPU_PROJECTILE_HIT_READBACK_CNT, sys->hit_list_buf_gl_ids);
+    glDeleteBuffers(1, &sys->solid_cell_buf_gl_id);
+    glDeleteBuffers(1, &sys->target_buf_gl_id);
+    glDeleteBuffers(1, &sys->spawn_buf_gl_id);
+    glDeleteBuffers(1, &sys->state_buf_gl_id);
+    glDeleteBuffers(2, sys->proj_buf_gl_ids);
+    glDeleteProgram(sys->cull_prog_gl_id);
+    glDeleteProgram(sys->render_prog_gl_id);
+    glDeleteProgram(sys->sim_prog_gl_id);
+
+    ZeroOut(sys, sizeof(*sys));
 }
 
-void Flush(const s_rendering_context* const context) {
-    assert(context);
+// The projectile is only queued up, to be added on the next step. Returns false if too many have been spawned since the last step.
+bool SpawnGPUProjectile(s_gpu_projectile_system* const sys, const s_vec_2d pos, const s_vec_2d vel, const float rot, const int dmg, const uint32_t hit_mask) {
+    assert(sys);
 
-    if (context->state->batch_slots_used_cnt == 0) {
-        return;
+    if (sys->spawn_cnt == GPU_PROJECTILE_SPAWN_LIMIT) {
+        return false;
     }
 
-    glBindVertexArray(context->pers->batch_gl_ids.vert_array_gl_id);
-    glBindBuffer(GL_ARRAY_BUFFER, context->pers->batch_gl_ids.vert_buf_gl_id);
+    sys->spawns[sys->spawn_cnt] = (s_gpu_projectile){
+        .pos = pos,
+        .vel = vel,
+        .rot = rot,
+        .dmg = dmg,
+        .hit_mask = hit_mask
+    };
+    sys->spawn_cnt++;
 
-    // TODO: There's something wrong with the below? Try a high slot limit.
-    const GLsizeiptr write_size = RENDER_BATCH_SLOT_VERTS_SIZE * context->state->batch_slots_used_cnt;
-    glBufferSubData(GL_ARRAY_BUFFER, 0, write_size, &context->state->batch_slot_verts[0][0]);
+    return true;
+}
 
-    const s_render_batch_shader_prog* const prog = &context->pers->batch_shader_prog;
+// Removes every projectile, including those queued up to be spawned. Hits still in flight and those read back by the last step are dropped.
+void ClearGPUProjectiles(s_gpu_projectile_system* const sys) {
+    assert(sys);
 
-    glUseProgram(prog->gl_id);
+    const uint32_t live_cnt = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->state_buf_gl_id);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetof(s_gpu_projectile_sim_state, live_cnt), sizeof(live_cnt), &live_cnt);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetof(s_gpu_projectile_sim_state, inst_cnt), sizeof(live_cnt), &live_cnt);
 
-    t_matrix_4x4 proj_mat = {0};
-    InitOrthoMatrix4x4(&proj_mat, 0.0f, (float)context->display_size.x, (float)context->display_size.y, 0.0f, -1.0f, 1.0f);
+    sys->spawn_cnt = 0;
+    sys->hit_cnt = 0;
+    sys->gen++;
+}
 
-    glUniformMatrix4fv(prog->proj_uniform_loc, 1, GL_FALSE, &proj_mat[0][0]);
-    glUniformMatrix4fv(prog->view_uniform_loc, 1, GL_FALSE, &context->state->view_mat[0][0]);
+// Appends the hits of the oldest step in flight to those read back, once GL is done with them.
+static void RetireGPUProjectileHitList(s_gpu_projectile_system* const sys) {
+    assert(sys->hit_list_cnt > 0);
 
-    glBindTexture(GL_TEXTURE_2D, context->state->batch_tex_gl_id);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, context->pers->batch_gl_ids.elem_buf_gl_id);
+    const int index = sys->hit_list_begin;
 
-    glDrawElements(GL_TRIANGLES, RENDER_BATCH_SLOT_ELEM_CNT * context->state->batch_slots_used_cnt, GL_UNSIGNED_SHORT, NULL);
+    glDeleteSync(sys->hit_list_fences[index]);
+    sys->hit_list_fences[index] = NULL;
 
-    context->state->batch_slots_used_cnt = 0;
-    context->state->batch_tex_gl_id = 0;
-}
+    sys->hit_list_begin = (sys->hit_list_begin + 1) % GPU_PROJECTILE_HIT_READBACK_CNT;
+    sys->hit_list_cnt--;
 
-static bool AttachFramebufferTexture(const t_gl_id fb_gl_id, const t_gl_id tex_gl_id, const s_vec_2d_i tex_size) {
-    assert(fb_gl_id != 0);
-    assert(tex_gl_id != 0);
-    assert(tex_size.x > 0 && tex_size.y > 0);
+    if (sys->hit_list_gens[index] != sys->gen) {
+        return;
+    }
 
-    glBindTexture(GL_TEXTURE_2D, tex_gl_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_size.x, tex_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->hit_list_buf_gl_ids[index]);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, fb_gl_id);
+    const s_gpu_projectile_hit_list* const hit_list = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, sizeof(*hit_list), GL_MAP_READ_BIT);
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_gl_id, 0);
+    if (!hit_list) {
+        fprintf(stderr, "Failed to map a GPU projectile hit list, so its hits will go unreported!\n");
+        return;
+    }
 
-    const bool success = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    const int hit_cnt = MIN((int)hit_list->cnt, GPU_PROJECTILE_HIT_LIMIT);
+    assert(sys->hit_cnt + hit_cnt <= GPU_PROJECTILE_HIT_LIMIT * GPU_PROJECTILE_HIT_READBACK_CNT);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    memcpy(&sys->hits[sys->hit_cnt], hit_list->hits, sizeof(hit_list->hits[0]) * hit_cnt);
+    sys->hit_cnt += hit_cnt;
 
-    return success;
+    glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
 }
 
-bool InitRenderSurfaces(s_render_surfaces* const surfs, const s_vec_2d_i size) {
-    assert(surfs && IsZero(surfs, sizeof(*surfs)));
-    assert(size.x > 0 && size.y > 0);
+// Meant to be called once per tick, with the hits of the steps GL has finished since being left in the system for the caller to go through. Hits are only ever waited on if every hit list is still in flight.
+void StepGPUProjectiles(s_gpu_projectile_system* const sys, s_gl_state_cache* const gl_state_cache, const s_gpu_projectile_step_input* const input) {
+    assert(sys);
+    assert(gl_state_cache);
+    assert(input);
+    assert(input->target_cnt >= 0 && input->target_cnt <= GPU_PROJECTILE_TARGET_LIMIT);
+    assert(input->target_cnt == 0 || input->targets);
+    assert(input->solid_cells);
+    assert(input->grid_size.x > 0 && input->grid_size.y > 0);
+    assert(input->cell_size > 0.0f);
 
-    glGenFramebuffers(RENDER_SURFACE_LIMIT, &surfs->framebuffer_gl_ids[0]);
-    glGenTextures(RENDER_SURFACE_LIMIT, &surfs->framebuffer_tex_gl_ids[0]);
+    sys->hit_cnt = 0;
 
-    for (int i = 0; i < RENDER_SURFACE_LIMIT; i++) {
-        if (!AttachFramebufferTexture(surfs->framebuffer_gl_ids[i], surfs->framebuffer_tex_gl_ids[i], size)) {
-            return false;
+    while (sys->hit_list_cnt > 0) {
+        const GLenum wait_res = glClientWaitSync(sys->hit_list_fences[sys->hit_list_begin], 0, 0);
+
+        if (wait_res != GL_ALREADY_SIGNALED && wait_res != GL_CONDITION_SATISFIED) {
+            break;
         }
+
+        RetireGPUProjectileHitList(sys);
     }
 
-    return true;
+    if (sys->hit_list_cnt == GPU_PROJECTILE_HIT_READBACK_CNT) {
+        GLenum wait_res;
+
+        do {
+            wait_res = glClientWaitSync(sys->hit_list_fences[sys->hit_list_begin], GL_SYNC_FLUSH_COMMANDS_BIT, GPU_PROJECTILE_HIT_FENCE_TIMEOUT);
+        } while (wait_res == GL_TIMEOUT_EXPIRED);
+
+        assert(wait_res != GL_WAIT_FAILED);
+
+        RetireGPUProjectileHitList(sys);
+    }
+
+    // The input buffers are orphaned rather than updated in place, so we never wait on the previous step still reading them.
+    if (sys->spawn_cnt > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->spawn_buf_gl_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(sys->spawns), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(sys->spawns[0]) * sys->spawn_cnt, sys->spawns);
+    }
+
+    if (input->target_cnt > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->target_buf_gl_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(s_gpu_projectile_target) * GPU_PROJECTILE_TARGET_LIMIT, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(input->targets[0]) * input->target_cnt, input->targets);
+    }
+
+    {
+        // Padded out to whole words, as the shader reads the cells a word at a time.
+        const int solid_cells_size = ((input->grid_size.x * input->grid_size.y) + 7) / 8;
+        const int solid_cell_buf_size = ((solid_cells_size + 3) / 4) * 4;
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->solid_cell_buf_gl_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, solid_cell_buf_size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, solid_cells_size, input->solid_cells);
+    }
+
+    const int hit_list_index = (sys->hit_list_begin + sys->hit_list_cnt) % GPU_PROJECTILE_HIT_READBACK_CNT;
+    const int dest_proj_buf_index = !sys->src_proj_buf_index;
+
+    UseShaderProg(gl_state_cache, sys->sim_prog_gl_id);
+    glUniform1ui(sys->sim_spawn_cnt_uniform_loc, (GLuint)sys->spawn_cnt);
+    glUniform1ui(sys->sim_target_cnt_uniform_loc, (GLuint)input->target_cnt);
+    glUniform1ui(sys->sim_proj_limit_uniform_loc, (GLuint)sys->proj_limit);
+    glUniform1i(sys->sim_grid_width_uniform_loc, input->grid_size.x);
+    glUniform1i(sys->sim_grid_height_uniform_loc, input->grid_size.y);
+    glUniform4f(sys->sim_collider_uniform_loc, sys->collider_size.x / 2.0f, sys->collider_size.y / 2.0f, input->cell_size, 0.0f);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sys->proj_buf_gl_ids[sys->src_proj_buf_index]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sys->proj_buf_gl_ids[dest_proj_buf_index]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, sys->state_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, sys->spawn_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, sys->target_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, sys->solid_cell_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, sys->hit_list_buf_gl_ids[hit_list_index]);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, sys->state_buf_gl_id);
+
+    glUniform1i(sys->sim_stage_uniform_loc, 0);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    if (sys->spawn_cnt > 0) {
+        glUniform1i(sys->sim_stage_uniform_loc, 1);
+        glDispatchCompute((sys->spawn_cnt + GPU_PROJECTILE_WORK_GROUP_SIZE - 1) / GPU_PROJECTILE_WORK_GROUP_SIZE, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    glUniform1i(sys->sim_stage_uniform_loc, 2);
+    glDispatchComputeIndirect((GLintptr)offsetof(s_gpu_projectile_sim_state, work_group_cnts));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUniform1i(sys->sim_stage_uniform_loc, 3);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // Fences are polled without flushing, as the buffer swap that follows each tick's render does so anyway.
+    sys->hit_list_fences[hit_list_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    sys->hit_list_gens[hit_list_index] = sys->gen;
+    sys->hit_list_cnt++;
+
+    sys->src_proj_buf_index = dest_proj_buf_index;
+    sys->spawn_cnt = 0;
 }
 
-bool ResizeRenderSurfaces(s_render_surfaces* const surfs, const s_vec_2d_i size) {
-    assert(surfs);
-    assert(size.x > 0 && size.y > 0);
+// Compacts the live projectiles within the view rect into the culled buffer, writing the draw
+// command for them on the GPU. The rect is grown by how far a sprite reaches from its position.
+static void CullGPUProjectiles(const s_rendering_context* const context, const s_gpu_projectile_system* const sys, const s_rect view_rect, const float reach) {
+    const s_gpu_projectile_draw_cmd draw_cmd = {.vert_cnt = 6};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sys->culled_draw_cmd_buf_gl_id);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(draw_cmd), &draw_cmd);
+
+    UseShaderProg(&context->state->gl_state_cache, sys->cull_prog_gl_id);
+    glUniform4f(sys->cull_view_rect_uniform_loc, view_rect.x - reach, view_rect.y - reach, view_rect.x + view_rect.width + reach, view_rect.y + view_rect.height + reach);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sys->proj_buf_gl_ids[sys->src_proj_buf_index]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sys->culled_proj_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, sys->state_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, sys->culled_draw_cmd_buf_gl_id);
+
+    // The dispatch of the last step covers at least every projectile still live.
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, sys->state_buf_gl_id);
+    glDispatchComputeIndirect((GLintptr)offsetof(s_gpu_projectile_sim_state, work_group_cnts));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+// Draws every live projectile as the given texture region with a single indirect draw. If a
+// view rect is given, those outside it are culled on the GPU first. Nothing is read back.
+void RenderGPUProjectiles(const s_rendering_context* const context, const s_gpu_projectile_system* const sys, const s_rect* const cull_view_rect, const int tex_index, const s_textures* const textures, const s_rect_i src_rect, const s_vec_2d origin, const s_color blend) {
+    assert(context);
+    assert(!context->state->queue_active && "GPU projectiles cannot be rendered while a render queue is active!");
+    assert(sys);
+    assert(tex_index >= 0 && tex_index < textures->cnt);
+    assert(IsOriginValid(origin));
+    assert(IsColorValid(blend));
+
+    Flush(context);
+
+    t_gl_id proj_buf_gl_id = sys->proj_buf_gl_ids[sys->src_proj_buf_index];
+    t_gl_id draw_cmd_buf_gl_id = sys->state_buf_gl_id;
+    GLintptr draw_cmd_offs = offsetof(s_gpu_projectile_sim_state, vert_cnt);
+
+    if (cull_view_rect) {
+        // Projectiles are rotated about their origin, so this is as far as a corner can get from it.
+        const float reach = Mag((s_vec_2d){src_rect.width * MAX(origin.x, 1.0f - origin.x), src_rect.height * MAX(origin.y, 1.0f - origin.y)});
+
+        CullGPUProjectiles(context, sys, *cull_view_rect, reach);
 
-    // Delete old textures.
-    glDeleteTextures(RENDER_SURFACE_LIMIT, surfs->framebuffer_tex_gl_ids);
+        proj_buf_gl_id = sys->culled_proj_buf_gl_id;
+        draw_cmd_buf_gl_id = sys->culled_draw_cmd_buf_gl_id;
+        draw_cmd_offs = 0;
+    }
+
+    if (context->state->frame_uniforms_dirty || !Vec2DIsEqual(context->state->frame_uniforms_display_size, context->display_size)) {
+        UploadFrameUniforms(context);
+    }
+
+    const s_rect_edges tex_coords = CalcTextureCoords(src_rect, textures->sizes[tex_index]);
+
+    s_gl_state_cache* const gl_state_cache = &context->state->gl_state_cache;
+
+    UseShaderProg(gl_state_cache, sys->render_prog_gl_id);
+    BindVertArray(gl_state_cache, sys->vert_array_gl_id);
+    BindTexture(gl_state_cache, 0, textures->gl_ids[tex_index]);
+
+    glUniform4f(sys->render_tex_coords_uniform_loc, tex_coords.left, tex_coords.top, tex_coords.right, tex_coords.bottom);
+    glUniform4f(sys->render_size_and_origin_uniform_loc, (float)src_rect.width, (float)src_rect.height, origin.x, origin.y);
+    glUniform4f(sys->render_blend_uniform_loc, blend.r, blend.g, blend.b, blend.a);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, proj_buf_gl_id);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_cmd_buf_gl_id);
+    glDrawArraysIndirect(GL_TRIANGLES, (const void*)draw_cmd_offs);
+}
+
+// Only the framebuffers are generated here, with textures being allocated on demand.
+void InitRenderSurfaces(s_render_surfaces* const surfs) {
+    assert(surfs && IsZero(surfs, sizeof(*surfs)));
+    glGenFramebuffers(RENDER_SURFACE_LIMIT, surfs->framebuffer_gl_ids);
+}
 
-    // Generate new ones with the given size.
-    glGenTextures(RENDER_SURFACE_LIMIT, surfs->framebuffer_tex_gl_ids);
+void CleanRenderSurfaces(s_render_surfaces* const surfs) {
+    assert(surfs);
 
     for (int i = 0; i < RENDER_SURFACE_LIMIT; i++) {
-        if (!AttachFramebufferTexture(surfs->framebuffer_gl_ids[i], surfs->framebuffer_tex_gl_ids[i], size)) {
-            return false;
+        if (surfs->framebuffer_tex_gl_ids[i]) {
+            glDeleteTextures(1, &surfs->framebuffer_tex_gl_ids[i]);
         }
     }
 
-    return true;
+    glDeleteFramebuffers(RENDER_SURFACE_LIMIT, surfs->framebuffer_gl_ids);
+
+    ZeroOut(surfs, sizeof(*surfs));
 }
 
 static void ApplyHorAlignOffsToLine(
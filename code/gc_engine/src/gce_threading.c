@@ -0,0 +1,135 @@
+#include <assert.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#endif
+#include <gce_threading.h>
+
+#ifdef _WIN32
+static unsigned __stdcall RunThread(void* const thread_raw) {
+    s_thread* const thread = thread_raw;
+    return (unsigned)thread->func(thread->func_arg);
+}
+
+bool StartThread(s_thread* const thread, const t_thread_func func, void* const func_arg) {
+    assert(thread);
+    assert(func);
+
+    thread->func = func;
+    thread->func_arg = func_arg;
+    thread->handle = (void*)_beginthreadex(NULL, 0, RunThread, thread, 0, NULL);
+
+    return thread->handle != NULL;
+}
+
+void JoinThread(s_thread* const thread) {
+    assert(thread);
+
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+bool InitMutex(s_mutex* const mutex) {
+    assert(mutex);
+    InitializeSRWLock((PSRWLOCK)&mutex->handle);
+    return true;
+}
+
+void CleanMutex(s_mutex* const mutex) {
+    // SRW locks hold no resources.
+    assert(mutex);
+}
+
+void LockMutex(s_mutex* const mutex) {
+    AcquireSRWLockExclusive((PSRWLOCK)&mutex->handle);
+}
+
+void UnlockMutex(s_mutex* const mutex) {
+    ReleaseSRWLockExclusive((PSRWLOCK)&mutex->handle);
+}
+
+bool InitCond(s_cond* const cond) {
+    assert(cond);
+    InitializeConditionVariable((PCONDITION_VARIABLE)&cond->handle);
+    return true;
+}
+
+void CleanCond(s_cond* const cond) {
+    // Condition variables hold no resources.
+    assert(cond);
+}
+
+void WaitCond(s_cond* const cond, s_mutex* const mutex) {
+    SleepConditionVariableSRW((PCONDITION_VARIABLE)&cond->handle, (PSRWLOCK)&mutex->handle, INFINITE, 0);
+}
+
+void SignalCond(s_cond* const cond) {
+    WakeConditionVariable((PCONDITION_VARIABLE)&cond->handle);
+}
+
+void BroadcastCond(s_cond* const cond) {
+    WakeAllConditionVariable((PCONDITION_VARIABLE)&cond->handle);
+}
+#else
+static void* RunThread(void* const thread_raw) {
+    s_thread* const thread = thread_raw;
+    thread->func(thread->func_arg);
+    return NULL;
+}
+
+bool StartThread(s_thread* const thread, const t_thread_func func, void* const func_arg) {
+    assert(thread);
+    assert(func);
+
+    thread->func = func;
+    thread->func_arg = func_arg;
+
+    return pthread_create(&thread->handle, NULL, RunThread, thread) == 0;
+}
+
+void JoinThread(s_thread* const thread) {
+    assert(thread);
+    pthread_join(thread->handle, NULL);
+}
+
+bool InitMutex(s_mutex* const mutex) {
+    assert(mutex);
+    return pthread_mutex_init(&mutex->handle, NULL) == 0;
+}
+
+void CleanMutex(s_mutex* const mutex) {
+    assert(mutex);
+    pthread_mutex_destroy(&mutex->handle);
+}
+
+void LockMutex(s_mutex* const mutex) {
+    pthread_mutex_lock(&mutex->handle);
+}
+
+void UnlockMutex(s_mutex* const mutex) {
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+bool InitCond(s_cond* const cond) {
+    assert(cond);
+    return pthread_cond_init(&cond->handle, NULL) == 0;
+}
+
+void CleanCond(s_cond* const cond) {
+    assert(cond);
+    pthread_cond_destroy(&cond->handle);
+}
+
+void WaitCond(s_cond* const cond, s_mutex* const mutex) {
+    pthread_cond_wait(&cond->handle, &mutex->handle);
+}
+
+void SignalCond(s_cond* const cond) {
+    pthread_cond_signal(&cond->handle);
+}
+
+void BroadcastCond(s_cond* const cond) {
+    pthread_cond_broadcast(&cond->handle);
+}
+#endif
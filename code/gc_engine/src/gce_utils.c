@@ -1,5 +1,11 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 #include <gce_utils.h>
 
 bool IsZero(const void* const mem, const int size) {
@@ -155,3 +161,20 @@ t_byte* PushEntireFileContents(const char* const file_path, s_mem_arena* const m
 
     return contents;
 }
+
+bool CreateDirIfMissing(const char* const path) {
+    assert(path);
+
+#ifdef _WIN32
+    const int result = _mkdir(path);
+#else
+    const int result = mkdir(path, 0755);
+#endif
+
+    if (result != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create directory \"%s\"!\n", path);
+        return false;
+    }
+
+    return true;
+}
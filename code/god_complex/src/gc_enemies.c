@@ -6,6 +6,10 @@
 #define ENEMY_VEL_LERP_FACTOR 0.2f
 #define ENEMY_SHOOT_INTERVAL 120
 #define ENEMY_DMG_FLASH_TIME 6
+#define ENEMY_VOLLEY_INTERVAL 4
+#define ENEMY_VOLLEY_PROJ_CNT 24
+#define ENEMY_VOLLEY_PROJ_SPD 3.0f
+#define ENEMY_VOLLEY_SPIN 0.1f
 
 bool SpawnEnemy(const s_vec_2d pos, s_enemy_list* const enemy_list) {
     const int enemy_index = FirstInactiveBitIndex(enemy_list->activity, sizeof(enemy_list->activity));
@@ -25,8 +29,10 @@ bool SpawnEnemy(const s_vec_2d pos, s_enemy_list* const enemy_list) {
     return true;
 }
 
-bool UpdateEnemies(s_level* const level) {
+// Enemies fire single shots at the player, or volleys in every direction if projectiles are simulated on the GPU.
+bool UpdateEnemies(s_level* const level, s_gpu_projectile_system* const gpu_projs, s_particle_system* const particles) {
     assert(level);
+    assert(particles);
     
     for (int i = 0; i < ENEMY_LIMIT; i++) {
         if (!IsEnemyActive(i, &level->enemy_list)) {
@@ -38,12 +44,23 @@ bool UpdateEnemies(s_level* const level) {
         enemy->vel = LerpVec2D(enemy->vel, VEC_2D_ZERO, ENEMY_VEL_LERP_FACTOR);
         enemy->pos = Vec2DSum(enemy->pos, enemy->vel);
 
-        if (enemy->shoot_time < ENEMY_SHOOT_INTERVAL) {
+        if (enemy->shoot_time < (gpu_projs ? ENEMY_VOLLEY_INTERVAL : ENEMY_SHOOT_INTERVAL)) {
             enemy->shoot_time++;
+        } else if (gpu_projs) {
+            for (int j = 0; j < ENEMY_VOLLEY_PROJ_CNT; j++) {
+                const float shoot_dir = enemy->volley_dir + ((2.0f * PI * j) / ENEMY_VOLLEY_PROJ_CNT);
+
+                if (!SpawnProjectile(level, gpu_projs, particles, enemy->pos, ENEMY_VOLLEY_PROJ_SPD, shoot_dir, 4, true)) {
+                    return false;
+                }
+            }
+
+            enemy->volley_dir = fmodf(enemy->volley_dir + ENEMY_VOLLEY_SPIN, 2.0f * PI);
+            enemy->shoot_time = 0;
         } else {
             const float shoot_dir = DirFrom(enemy->pos, level->player.pos);
 
-            if (!SpawnProjectile(level, enemy->pos, 12.0f, shoot_dir, 4, true)) {
+            if (!SpawnProjectile(level, gpu_projs, particles, enemy->pos, 12.0f, shoot_dir, 4, true)) {
                 return false;
             }
 
@@ -58,8 +75,9 @@ bool UpdateEnemies(s_level* const level) {
     return true;
 }
 
-void ProcEnemyDeaths(s_level* const level) {
+void ProcEnemyDeaths(s_level* const level, s_particle_system* const particles) {
     assert(level);
+    assert(particles);
     
     for (int i = 0; i < ENEMY_LIMIT; i++) {
         if (!IsEnemyActive(i, &level->enemy_list)) {
@@ -71,62 +89,101 @@ void ProcEnemyDeaths(s_level* const level) {
         assert(enemy->hp >= 0);
 
         if (enemy->hp == 0) {
+            // Debris.
+            EmitParticles(particles, &(s_particle_emit_info){
+                .pos = enemy->pos,
+                .cnt = 160,
+                .spread = 2.0f * PI,
+                .spd_min = 0.5f,
+                .spd_max = 4.0f,
+                .lifetime_min = 30,
+                .lifetime_max = 60,
+                .size_begin = 3.0f,
+                .size_end = 1.0f,
+                .col_begin = {0.8f, 0.2f, 0.2f, 1.0f},
+                .col_end = {0.3f, 0.1f, 0.1f, 0.0f},
+                .drag = 0.08f
+            });
+
             DeactivateBit(i, level->enemy_list.activity, ENEMY_LIMIT);
             ZeroOut(enemy, sizeof(*enemy));
         }
     }
 }
 
-void RenderEnemies(const s_rendering_context* const rendering_context, const s_enemy_list* const enemies, const s_textures* const textures, const s_shader_progs* const shader_progs) {
-    assert(rendering_context);
-    assert(enemies);
-    assert(textures);
-    assert(shader_progs);
+typedef struct {
+    const s_enemy_list* enemies;
+    s_rect view_rect;
+    const s_textures* textures;
+    int drawn_cnts[ENEMY_RENDER_CMD_LIST_CNT];
+    int culled_cnts[ENEMY_RENDER_CMD_LIST_CNT];
+} s_enemy_render_cmd_record_data;
 
-    for (int i = 0; i < ENEMY_LIMIT; i++) {
-        if (!IsEnemyActive(i, enemies)) {
+static void RecordEnemyRenderCmds(s_render_cmd_list* const list, const int list_index, void* const data_raw) {
+    s_enemy_render_cmd_record_data* const data = data_raw;
+    const s_sprite* const sprite = &g_sprites[ek_sprite_enemy];
+
+    const int enemy_index_begin = (ENEMY_LIMIT * list_index) / ENEMY_RENDER_CMD_LIST_CNT;
+    const int enemy_index_end = (ENEMY_LIMIT * (list_index + 1)) / ENEMY_RENDER_CMD_LIST_CNT;
+
+    for (int i = enemy_index_begin; i < enemy_index_end; i++) {
+        if (!IsEnemyActive(i, data->enemies)) {
             continue;
         }
 
-        const s_enemy* const enemy = &enemies->buf[i];
+        const s_enemy* const enemy = &data->enemies->buf[i];
 
-        if (enemy->flash_time > 0) {
-            Flush(rendering_context);
+        if (!IsSpriteInView(ek_sprite_enemy, enemy->pos, (s_vec_2d){0.5f, 0.5f}, 0.0f, data->view_rect)) {
+            data->culled_cnts[list_index]++;
+            continue;
+        }
+
+        // The lists are sized to fit their share of the enemy list, so this can't run out of commands.
+        AddTextureToRenderCmdList(list, sprite->tex, data->textures, sprite->src_rect, enemy->pos, (s_vec_2d){0.5f, 0.5f}, (s_vec_2d){1.0f, 1.0f}, 0.0f, WHITE, enemy->flash_time > 0 ? WHITE : (s_color){0});
+        data->drawn_cnts[list_index]++;
+    }
+}
 
-            SetSurface(rendering_context, 0);
+bool InitEnemyRenderCmdLists(s_render_cmd_list* const lists) {
+    assert(lists);
+
+    for (int i = 0; i < ENEMY_RENDER_CMD_LIST_CNT; i++) {
+        if (!InitRenderCmdList(&lists[i], (ENEMY_LIMIT + ENEMY_RENDER_CMD_LIST_CNT - 1) / ENEMY_RENDER_CMD_LIST_CNT)) {
+            return false;
+        }
+    }
 
-            RenderClear((s_color){0});
-        } 
+    return true;
+}
 
-        RenderSprite(
-            rendering_context,
-            ek_sprite_enemy,
-            textures,
-            enemy->pos,
-            (s_vec_2d){0.5f, 0.5f},
-            (s_vec_2d){1.0f, 1.0f},
-            0.0f,
-            WHITE
-        );
+void CleanEnemyRenderCmdLists(s_render_cmd_list* const lists) {
+    assert(lists);
 
-        if (enemy->flash_time > 0) {
-            Flush(rendering_context);
+    for (int i = 0; i < ENEMY_RENDER_CMD_LIST_CNT; i++) {
+        CleanRenderCmdList(&lists[i]);
+    }
+}
 
-            UnsetSurface(rendering_context);
+// The enemies are culled and recorded into command lists in parallel, with the lists submitted in order so that the result is the same as recording them all on the one thread.
+void RenderEnemies(const s_rendering_context* const rendering_context, const s_enemy_list* const enemies, s_render_cmd_list* const render_cmd_lists, const s_rect view_rect, s_cull_stats* const cull_stats, const s_textures* const textures) {
+    assert(rendering_context);
+    assert(enemies);
+    assert(render_cmd_lists);
+    assert(cull_stats);
+    assert(textures);
 
-            SetSurfaceShaderProg(rendering_context, shader_progs->gl_ids[ek_shader_prog_blend]);
+    s_enemy_render_cmd_record_data data = {
+        .enemies = enemies,
+        .view_rect = view_rect,
+        .textures = textures
+    };
 
-            SetSurfaceShaderProgUniform(
-                rendering_context,
-                "u_col",
-                (s_shader_prog_uniform_value){
-                    .type = ek_shader_prog_uniform_value_type_v3,
-                    .as_v3 = {1.0f, 1.0f, 1.0f}
-                }
-            );
+    RecordRenderCmdListsInParallel(rendering_context, render_cmd_lists, ENEMY_RENDER_CMD_LIST_CNT, RecordEnemyRenderCmds, &data);
+    SubmitRenderCmdLists(rendering_context, render_cmd_lists, ENEMY_RENDER_CMD_LIST_CNT);
 
-            RenderSurface(rendering_context, 0);
-        }
+    for (int i = 0; i < ENEMY_RENDER_CMD_LIST_CNT; i++) {
+        cull_stats->drawn_cnt += data.drawn_cnts[i];
+        cull_stats->culled_cnt += data.culled_cnts[i];
     }
 }
 
@@ -134,8 +191,9 @@ s_rect GenEnemyDamageCollider(const s_vec_2d enemy_pos) {
     return GenColliderRectFromSprite(ek_sprite_enemy, enemy_pos, (s_vec_2d){0.5f, 0.5f});
 }
 
-void DamageEnemy(s_level* const level, const int enemy_index, const s_damage_info dmg_info) {
+void DamageEnemy(s_level* const level, s_particle_system* const particles, const int enemy_index, const s_damage_info dmg_info) {
     assert(level);
+    assert(particles);
     assert(enemy_index >= 0 && enemy_index < ENEMY_LIMIT);
     assert(IsEnemyActive(enemy_index, &level->enemy_list));
     assert(dmg_info.dmg > 0);
@@ -144,4 +202,21 @@ void DamageEnemy(s_level* const level, const int enemy_index, const s_damage_inf
     enemy->vel = Vec2DSum(enemy->vel, dmg_info.kb);
     enemy->hp = MAX(enemy->hp - dmg_info.dmg, 0);
     enemy->flash_time = ENEMY_DMG_FLASH_TIME;
+
+    // Hit sparks, sent off in the direction of the knockback.
+    EmitParticles(particles, &(s_particle_emit_info){
+        .pos = enemy->pos,
+        .cnt = 40,
+        .dir = Dir(dmg_info.kb),
+        .spread = 1.2f,
+        .spd_min = 1.0f,
+        .spd_max = 6.0f,
+        .lifetime_min = 8,
+        .lifetime_max = 20,
+        .size_begin = 2.0f,
+        .size_end = 0.0f,
+        .col_begin = {1.0f, 1.0f, 0.8f, 1.0f},
+        .col_end = {1.0f, 0.6f, 0.2f, 0.0f},
+        .drag = 0.1f
+    });
 }
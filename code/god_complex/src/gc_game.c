@@ -3,6 +3,11 @@
 #include "gc_game.h"
 #include "gce_game.h"
 #include "gce_math.h"
+#include "gce_render_recording.h"
+
+#define RENDER_CHECK_ENEMY_CNT 200
+#define RENDER_CHECK_DISPLAY_SIZE (s_vec_2d_i){1280, 720}
+#define RENDER_CHECK_LEVEL_DRAW_LIMIT 4
 
 const s_sprite g_sprites[eks_sprite_cnt] = {
     (s_sprite){.tex = ek_texture_level, .src_rect = {0, 0, 24, 24}}, // Player
@@ -23,6 +28,12 @@ static const char* TextureIndexToFilePath(const int index) {
 
 static s_font_load_info FontIndexToLoadInfo(const int index) {
     switch (index) {
+        case ek_font_eb_garamond_24:
+            return (s_font_load_info){
+                .file_path = "assets/fonts/eb_garamond.ttf",
+                .height = 24
+            };
+
         case ek_font_eb_garamond_64:
             return (s_font_load_info){
                 .file_path = "assets/fonts/eb_garamond.ttf",
@@ -40,19 +51,6 @@ static s_font_load_info FontIndexToLoadInfo(const int index) {
     }
 }
 
-static s_shader_prog_file_paths ShaderProgIndexToFilePaths(const int index) {
-    switch (index) {
-        case ek_shader_prog_blend:
-            return (s_shader_prog_file_paths){
-                .vs_fp = "assets/shaders/blend.vert",
-                .fs_fp = "assets/shaders/blend.frag"
-            };
-
-        default:
-            return (s_shader_prog_file_paths){0};
-    }
-}
-
 static bool InitGame(const s_game_init_func_data* const func_data) {
     s_game* const game = func_data->user_mem;
 
@@ -66,8 +64,22 @@ static bool InitGame(const s_game_init_func_data* const func_data) {
         return false;
     }
 
-    if (!LoadShaderProgsFromFiles(&game->shader_progs, func_data->perm_mem_arena, eks_shader_prog_cnt, ShaderProgIndexToFilePaths, func_data->temp_mem_arena)) {
-        fprintf(stderr, "Failed to load game shader programs!\n");
+    if (!InitParticleSystem(&game->particles, PARTICLE_LIMIT, SHADER_PROG_CACHE_DIR)) {
+        fprintf(stderr, "Failed to initialise the particle system!\n");
+        return false;
+    }
+
+    {
+        const s_rect_i proj_src_rect = g_sprites[ek_sprite_projectile].src_rect;
+
+        if (!InitGPUProjectileSystem(&game->gpu_projectiles, GPU_PROJECTILE_LIMIT, (s_vec_2d){proj_src_rect.width, proj_src_rect.height}, SHADER_PROG_CACHE_DIR)) {
+            fprintf(stderr, "Failed to initialise the GPU projectile system!\n");
+            return false;
+        }
+    }
+
+    if (!InitEnemyRenderCmdLists(game->enemy_render_cmd_lists)) {
+        fprintf(stderr, "Failed to initialise the enemy render command lists!\n");
         return false;
     }
 
@@ -76,6 +88,10 @@ static bool InitGame(const s_game_init_func_data* const func_data) {
         return false;
     }
 
+    game->tilemap_render_batch_stale = true;
+
+    InitDynamicRes(&game->dynamic_res, DYNAMIC_RES_TARGET_GPU_TIME);
+
     return true;
 }
 
@@ -88,20 +104,100 @@ static bool GameTick(const s_game_tick_func_data* const func_data) {
         if (!InitLevel(&game->level)) {
             return false;
         }
+
+        ClearParticles(&game->particles);
+        ClearGPUProjectiles(&game->gpu_projectiles);
+
+        game->tilemap_render_batch_stale = true;
+        *func_data->visuals_dirty = true;
+    }
+
+    if (IsKeyPressed(ek_key_code_f1, func_data->input_state, func_data->input_state_last)) {
+        game->dynamic_res_enabled = !game->dynamic_res_enabled;
+        *func_data->visuals_dirty = true;
+    }
+
+    if (IsKeyPressed(ek_key_code_f2, func_data->input_state, func_data->input_state_last)) {
+        game->virtual_res_enabled = !game->virtual_res_enabled;
+        *func_data->visuals_dirty = true;
+    }
+
+    // Projectiles of the backend being switched from are dropped rather than carried over.
+    if (IsKeyPressed(ek_key_code_f3, func_data->input_state, func_data->input_state_last)) {
+        game->gpu_projectiles_enabled = !game->gpu_projectiles_enabled;
+        game->level.proj_cnt = 0;
+        ClearGPUProjectiles(&game->gpu_projectiles);
+        *func_data->visuals_dirty = true;
+    }
+
+    // The stats go over the scene rather than into it, so toggling them doesn't dirty it.
+    if (IsKeyPressed(ek_key_code_f4, func_data->input_state, func_data->input_state_last)) {
+        game->cull_stats_shown = !game->cull_stats_shown;
     }
 
-    if (!LevelTick(game, &func_data->window_state, func_data->input_state, func_data->input_state_last, func_data->temp_mem_arena)) {
+    const bool paused_before_tick = game->level.paused;
+
+    if (!LevelTick(game, &func_data->window_state, func_data->input_state, func_data->input_state_last, func_data->gl_state_cache, func_data->temp_mem_arena)) {
         return false;
     }
 
+    // Nothing in the level changes while it's paused, so the scene only needs rendering again if the pause has just been toggled.
+    if (!game->level.paused || game->level.paused != paused_before_tick) {
+        *func_data->visuals_dirty = true;
+    }
+
     return true;
 }
 
+static bool RenderGameLevel(s_game* const game, const s_game_render_func_data* const func_data) {
+    return RenderLevel(&func_data->rendering_context, &game->level, game->gpu_projectiles_enabled ? &game->gpu_projectiles : NULL, &game->particles, &game->tilemap_render_batch, game->enemy_render_cmd_lists, game->dynamic_res_enabled ? &game->dynamic_res : NULL, game->virtual_res_enabled, &game->cull_stats, &game->textures, &game->fonts, func_data->temp_mem_arena);
+}
+
 static bool RenderGame(const s_game_render_func_data* const func_data) {
     s_game* const game = func_data->user_mem;
 
-    if (!RenderLevel(&func_data->rendering_context, &game->level, &game->textures, &game->fonts, &game->shader_progs, func_data->temp_mem_arena)) {
-        return false;
+    if (game->tilemap_render_batch_stale) {
+        if (!GenTilemapRenderBatch(&game->tilemap_render_batch, &game->level.tilemap, &game->textures, &func_data->rendering_context)) {
+            fprintf(stderr, "Failed to generate the tilemap render batch!\n");
+            return false;
+        }
+
+        game->tilemap_render_batch_stale = false;
+    }
+
+    // Frames where the scene changed have it rendered straight to the back buffer. Only once the scene settles is it rendered into a surface, so that frames where just the cursor moves can copy it from there instead.
+    if (func_data->visuals_dirty) {
+        if (!RenderGameLevel(game, func_data)) {
+            return false;
+        }
+
+        game->scene_cached = false;
+    } else {
+        if (!game->scene_cached) {
+            if (!SetSurface(&func_data->rendering_context, SCENE_SURF_INDEX)) {
+                return false;
+            }
+
+            if (!RenderGameLevel(game, func_data)) {
+                return false;
+            }
+
+            UnsetSurface(&func_data->rendering_context);
+
+            game->scene_cached = true;
+        }
+
+        CopySurface(&func_data->rendering_context, SCENE_SURF_INDEX);
+    }
+
+    // These are from whenever the scene was last rendered, which is still what's being shown if it came from the surface.
+    if (game->cull_stats_shown) {
+        char str[64];
+        snprintf(str, sizeof(str), "Drawn: %d\nCulled: %d", game->cull_stats.drawn_cnt, game->cull_stats.culled_cnt);
+
+        if (!RenderStr(&func_data->rendering_context, str, ek_font_eb_garamond_24, &game->fonts, (s_vec_2d){8.0f, 8.0f}, ek_str_hor_align_left, ek_str_ver_align_top, WHITE, func_data->temp_mem_arena)) {
+            return false;
+        }
     }
 
     // Render cursor.
@@ -123,6 +219,12 @@ static bool RenderGame(const s_game_render_func_data* const func_data) {
 }
 
 static void CleanGame(void* const user_mem) {
+    s_game* const game = user_mem;
+    CleanDynamicRes(&game->dynamic_res);
+    CleanStaticRenderBatch(&game->tilemap_render_batch.batch);
+    CleanEnemyRenderCmdLists(game->enemy_render_cmd_lists);
+    CleanGPUProjectileSystem(&game->gpu_projectiles);
+    CleanParticleSystem(&game->particles);
 }
 
 s_rect GenColliderRectFromSprite(const e_sprite sprite, const s_vec_2d pos, const s_vec_2d origin) {
@@ -144,7 +246,134 @@ bool PushColliderPolyFromSprite(s_poly* const poly, s_mem_arena* const mem_arena
     return PushQuadPolyRotated(poly, mem_arena, pos, (s_vec_2d){g_sprites[sprite].src_rect.width, g_sprites[sprite].src_rect.height}, origin, rot);
 }
 
-int main() {
+// Sets up the game much as InitGame() does, minus anything the level render doesn't need, with a crowd of enemies in view.
+static bool InitLevelRenderCheck(s_game* const game, const s_rendering_context* const rendering_context, s_mem_arena* const perm_mem_arena, s_mem_arena* const temp_mem_arena) {
+    const s_rect_i proj_src_rect = g_sprites[ek_sprite_projectile].src_rect;
+
+    if (!LoadTexturesFromFiles(&game->textures, perm_mem_arena, eks_texture_cnt, TextureIndexToFilePath)
+        || !LoadFontsFromFiles(&game->fonts, perm_mem_arena, eks_font_cnt, FontIndexToLoadInfo, temp_mem_arena)
+        || !InitParticleSystem(&game->particles, PARTICLE_LIMIT, NULL)
+        || !InitGPUProjectileSystem(&game->gpu_projectiles, GPU_PROJECTILE_LIMIT, (s_vec_2d){proj_src_rect.width, proj_src_rect.height}, NULL)
+        || !InitEnemyRenderCmdLists(game->enemy_render_cmd_lists)
+        || !InitLevel(&game->level)) {
+        return false;
+    }
+
+    // The enemies are laid out in a grid around the player, so that they're all in view.
+    for (int i = 0; i < RENDER_CHECK_ENEMY_CNT; i++) {
+        const s_vec_2d pos = {
+            game->level.player.pos.x + (((i % 20) - 10) * 24.0f),
+            game->level.player.pos.y + (((i / 20) - 5) * 24.0f)
+        };
+
+        if (!SpawnEnemy(pos, &game->level.enemy_list)) {
+            return false;
+        }
+    }
+
+    BeginRendering(rendering_context->state);
+
+    return GenTilemapRenderBatch(&game->tilemap_render_batch, &game->level.tilemap, &game->textures, rendering_context);
+}
+
+// Renders the level once into the recording, which is reset first. GPU projectiles are rendered if their system is given.
+static bool RecordLevelRender(s_render_recording* const recording, s_game* const game, const s_rendering_context* const rendering_context, const s_gpu_projectile_system* const gpu_projs, s_mem_arena* const temp_mem_arena) {
+    ResetMemArena(temp_mem_arena);
+    ResetRenderRecording(recording);
+
+    BeginRendering(rendering_context->state);
+
+    return RenderLevel(rendering_context, &game->level, gpu_projs, &game->particles, &game->tilemap_render_batch, game->enemy_render_cmd_lists, NULL, false, &game->cull_stats, &game->textures, &game->fonts, temp_mem_arena);
+}
+
+// Renders the level while recording without GL, and checks that the draw calls made stay within the limit. Needs no window or GPU, so it can be run headless.
+static bool CheckLevelRenderCounts(void) {
+    s_render_recording recording = {0};
+
+    if (!BeginRenderRecording(&recording, false)) {
+        return false;
+    }
+
+    s_mem_arena perm_mem_arena = {0};
+    s_mem_arena temp_mem_arena = {0};
+    s_pers_render_data pers_render_data = {0};
+    s_game* const game = calloc(1, sizeof(*game));
+    s_rendering_state* const rendering_state = calloc(1, sizeof(*rendering_state));
+
+    const s_rendering_context rendering_context = {
+        .pers = &pers_render_data,
+        .state = rendering_state,
+        .display_size = RENDER_CHECK_DISPLAY_SIZE
+    };
+
+    // No shader program cache directory is given, as the recording has no real binaries to write to one.
+    bool success = game
+        && rendering_state
+        && InitMemArena(&perm_mem_arena, (1 << 20) * 80)
+        && InitMemArena(&temp_mem_arena, (1 << 20) * 40)
+        && InitPersRenderData(&pers_render_data, RENDER_BATCH_SLOT_CNT_DEFAULT, NULL)
+        && InitLevelRenderCheck(game, &rendering_context, &perm_mem_arena, &temp_mem_arena)
+        && RecordLevelRender(&recording, game, &rendering_context, NULL, &temp_mem_arena);
+
+    if (success) {
+        const int draw_cnt = RenderRecordingDrawCnt(&recording);
+
+        printf("Rendering the level with %d enemies took %d draw calls (%d sprites drawn, %d culled).\n", RENDER_CHECK_ENEMY_CNT, draw_cnt, game->cull_stats.drawn_cnt, game->cull_stats.culled_cnt);
+
+        if (game->cull_stats.drawn_cnt < RENDER_CHECK_ENEMY_CNT) {
+            fprintf(stderr, "Not every enemy was in view for the render count check!\n");
+            success = false;
+        } else if (draw_cnt > RENDER_CHECK_LEVEL_DRAW_LIMIT) {
+            fprintf(stderr, "Rendering the level took more than %d draw calls!\n", RENDER_CHECK_LEVEL_DRAW_LIMIT);
+            success = false;
+        }
+    } else {
+        fprintf(stderr, "Failed to record the level render for the render count check!\n");
+    }
+
+    // GPU projectiles should only add a culling dispatch and an indirect draw.
+    if (success) {
+        const int draw_cnt = RenderRecordingDrawCnt(&recording);
+        const int indirect_draw_cnt = RenderRecordingCmdCnt(&recording, "glDrawArraysIndirect");
+        const int dispatch_cnt = recording.type_cnts[ek_recorded_gl_cmd_type_dispatch];
+
+        if (!RecordLevelRender(&recording, game, &rendering_context, &game->gpu_projectiles, &temp_mem_arena)) {
+            fprintf(stderr, "Failed to record the level render with GPU projectiles!\n");
+            success = false;
+        } else if (RenderRecordingDrawCnt(&recording) != draw_cnt + 1
+            || RenderRecordingCmdCnt(&recording, "glDrawArraysIndirect") != indirect_draw_cnt + 1
+            || recording.type_cnts[ek_recorded_gl_cmd_type_dispatch] != dispatch_cnt + 1) {
+            fprintf(stderr, "GPU projectiles weren't culled and drawn with a single indirect draw!\n");
+            success = false;
+        }
+    }
+
+    if (game) {
+        CleanStaticRenderBatch(&game->tilemap_render_batch.batch);
+        CleanEnemyRenderCmdLists(game->enemy_render_cmd_lists);
+        CleanGPUProjectileSystem(&game->gpu_projectiles);
+        CleanParticleSystem(&game->particles);
+        free(game);
+    }
+
+    free(rendering_state);
+
+    CleanPersRenderData(&pers_render_data);
+    CleanMemArena(&temp_mem_arena);
+    CleanMemArena(&perm_mem_arena);
+
+    EndRenderRecording(&recording);
+    CleanRenderRecording(&recording);
+
+    return success;
+}
+
+// A file path can be given, to capture gameplay to as Y4M video. Alternatively "--check-render-counts" can be given, to run the headless render count check.
+int main(const int argc, char** const argv) {
+    if (argc > 1 && strcmp(argv[1], "--check-render-counts") == 0) {
+        return CheckLevelRenderCounts() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     const s_game_info game_info = {
         .user_mem_size = sizeof(s_game),
         .user_mem_alignment = alignof(s_game),
@@ -153,6 +382,12 @@ int main() {
         .window_title = GAME_TITLE,
         .window_flags = ek_window_flag_hide_cursor | ek_window_flag_resizable,
 
+        .shader_prog_cache_dir = SHADER_PROG_CACHE_DIR,
+        .render_only_when_dirty = true,
+
+        .capture_out_path = argc > 1 ? argv[1] : NULL,
+        .capture_format = ek_frame_capture_format_y4m,
+
         .init_func = InitGame,
         .tick_func = GameTick,
         .render_func = RenderGame,
@@ -6,16 +6,27 @@
 
 #define GAME_TITLE "God Complex"
 
+#define SHADER_PROG_CACHE_DIR "shader_cache"
+
 #define PLAYER_HP_LIMIT 100
 
 #define ENEMY_LIMIT 256
+#define ENEMY_RENDER_CMD_LIST_CNT 4 // Enemy rendering is recorded across this many threads, each taking an even share of the enemy list.
 
 #define PROJECTILE_LIMIT 1024
+#define GPU_PROJECTILE_LIMIT 65536
+
+#define PARTICLE_LIMIT 200000
 
-#define CAMERA_SCALE 2.0f
+#define CAMERA_SCALE 2.0f // Kept a whole number so that the world can be rendered at camera resolution and upscaled.
 
 #define PAUSE_SCREEN_BG_ALPHA 0.2f
 
+#define DYNAMIC_RES_TARGET_GPU_TIME 12.0f // In milliseconds, leaving room within a 60 Hz frame for the UI and the upscale.
+#define DYNAMIC_RES_SURF_INDEX 0
+#define VIRTUAL_RES_SURF_INDEX 1
+#define SCENE_SURF_INDEX 2
+
 #define TILE_SIZE 16
 
 typedef enum {
@@ -26,6 +37,7 @@ typedef enum {
 } e_texture;
 
 typedef enum {
+    ek_font_eb_garamond_24,
     ek_font_eb_garamond_64,
     ek_font_eb_garamond_80,
 
@@ -33,9 +45,16 @@ typedef enum {
 } e_fonts;
 
 typedef enum {
-    ek_shader_prog_blend,
-    eks_shader_prog_cnt
-} e_shader_prog;
+    ek_render_layer_enemies,
+    ek_render_layer_player,
+    ek_render_layer_projectiles
+} e_render_layer;
+
+// Which targets a GPU projectile can hit.
+typedef enum {
+    ek_gpu_projectile_target_player = 1 << 0,
+    ek_gpu_projectile_target_enemy = 1 << 1
+} e_gpu_projectile_target;
 
 typedef enum {
     ek_sprite_player,
@@ -52,6 +71,12 @@ typedef struct {
     s_rect_i src_rect;
 } s_sprite;
 
+// For debugging, counts of what was submitted for rendering against what was culled for being out of view.
+typedef struct {
+    int drawn_cnt;
+    int culled_cnt;
+} s_cull_stats;
+
 typedef struct {
     bool killed;
     s_vec_2d pos;
@@ -67,6 +92,7 @@ typedef struct {
     s_vec_2d vel;
     int hp;
     int shoot_time;
+    float volley_dir; // Turned a little with each volley, so that they spiral out.
     int flash_time;
 } s_enemy;
 
@@ -102,8 +128,19 @@ typedef struct {
 typedef struct {
     s_textures textures;
     s_fonts fonts;
-    s_shader_progs shader_progs;
     s_level level;
+    s_particle_system particles;
+    s_gpu_projectile_system gpu_projectiles;
+    bool gpu_projectiles_enabled; // Toggled with F3. If set, projectiles are simulated on the GPU instead of in the level, and enemies fire in volleys.
+    s_tilemap_render_batch tilemap_render_batch;
+    bool tilemap_render_batch_stale; // Set whenever the level is initialised, so that the batch gets regenerated on the next render.
+    s_render_cmd_list enemy_render_cmd_lists[ENEMY_RENDER_CMD_LIST_CNT];
+    s_cull_stats cull_stats; // Regenerated every render.
+    bool cull_stats_shown; // Toggled with F4.
+    bool scene_cached; // Whether the scene surface holds the scene as it currently is.
+    s_dynamic_res dynamic_res;
+    bool dynamic_res_enabled; // Toggled with F1. If set, the world is rendered at a resolution scaled to keep within the target GPU time.
+    bool virtual_res_enabled; // Toggled with F2. If set, the world is rendered at camera resolution and upscaled, which takes precedence over dynamic resolution.
 } s_game;
 
 typedef struct {
@@ -117,25 +154,27 @@ s_rect GenColliderRectFromSprite(const e_sprite sprite, const s_vec_2d pos, cons
 bool PushColliderPolyFromSprite(s_poly* const poly, s_mem_arena* const mem_arena, const e_sprite sprite, const s_vec_2d pos, const s_vec_2d origin, const float rot);
 
 bool InitLevel(s_level* const level);
-bool LevelTick(s_game* const game, const s_window_state* const window_state, const s_input_state* const input_state, const s_input_state* const input_state_last, s_mem_arena* const temp_mem_arena);
-bool RenderLevel(const s_rendering_context* const rendering_context, const s_level* const level, const s_textures* const textures, const s_fonts* const fonts, const s_shader_progs* const shader_progs, s_mem_arena* const temp_mem_arena);
-bool SpawnProjectile(s_level* const level, const s_vec_2d pos, const float spd, const float dir, const int dmg, const bool from_enemy);
+bool LevelTick(s_game* const game, const s_window_state* const window_state, const s_input_state* const input_state, const s_input_state* const input_state_last, s_gl_state_cache* const gl_state_cache, s_mem_arena* const temp_mem_arena);
+bool RenderLevel(const s_rendering_context* const rendering_context, const s_level* const level, const s_gpu_projectile_system* const gpu_projs, s_particle_system* const particles, s_tilemap_render_batch* const tilemap_render_batch, s_render_cmd_list* const enemy_render_cmd_lists, s_dynamic_res* const dynamic_res, const bool virtual_res, s_cull_stats* const cull_stats, const s_textures* const textures, const s_fonts* const fonts, s_mem_arena* const temp_mem_arena);
+bool SpawnProjectile(s_level* const level, s_gpu_projectile_system* const gpu_projs, s_particle_system* const particles, const s_vec_2d pos, const float spd, const float dir, const int dmg, const bool from_enemy);
 
 void InitPlayer(s_player* const player, const s_vec_2d pos);
 void ProcPlayerMovement(s_player* const player, const s_input_state* const input_state, const t_tilemap* const tilemap, const s_camera* const cam, const s_vec_2d_i display_size);
-bool ProcPlayerShooting(s_level* const level, const s_vec_2d_i display_size, const s_input_state* const input_state, const s_input_state* const input_state_last);
+bool ProcPlayerShooting(s_level* const level, s_gpu_projectile_system* const gpu_projs, s_particle_system* const particles, const s_vec_2d_i display_size, const s_input_state* const input_state, const s_input_state* const input_state_last);
 void UpdatePlayerTimers(s_player* const player);
 void ProcPlayerDeath(s_level* const level);
-void RenderPlayer(const s_rendering_context* const rendering_context, const s_player* const player, const s_textures* const textures, const s_shader_progs* const shader_progs);
+void RenderPlayer(const s_rendering_context* const rendering_context, const s_player* const player, const s_textures* const textures);
 s_rect GenPlayerCollider(const s_vec_2d player_pos);
 void DamagePlayer(s_level* const level, const s_damage_info dmg_info);
 
+bool InitEnemyRenderCmdLists(s_render_cmd_list* const lists);
+void CleanEnemyRenderCmdLists(s_render_cmd_list* const lists);
 bool SpawnEnemy(const s_vec_2d pos, s_enemy_list* const enemy_list);
-bool UpdateEnemies(s_level* const level);
-void ProcEnemyDeaths(s_level* const level);
-void RenderEnemies(const s_rendering_context* const rendering_context, const s_enemy_list* const enemies, const s_textures* const textures, const s_shader_progs* const shader_progs);
+bool UpdateEnemies(s_level* const level, s_gpu_projectile_system* const gpu_projs, s_particle_system* const particles);
+void ProcEnemyDeaths(s_level* const level, s_particle_system* const particles);
+void RenderEnemies(const s_rendering_context* const rendering_context, const s_enemy_list* const enemies, s_render_cmd_list* const render_cmd_lists, const s_rect view_rect, s_cull_stats* const cull_stats, const s_textures* const textures);
 s_rect GenEnemyDamageCollider(const s_vec_2d enemy_pos);
-void DamageEnemy(s_level* const level, const int enemy_index, const s_damage_info dmg_info);
+void DamageEnemy(s_level* const level, s_particle_system* const particles, const int enemy_index, const s_damage_info dmg_info);
 
 inline bool IsEnemyActive(const int index, const s_enemy_list* const enemy_list) {
     assert(index >= 0 && index < ENEMY_LIMIT);
@@ -158,6 +197,12 @@ inline s_vec_2d CameraTopLeft(const s_camera* const cam, const s_vec_2d_i displa
     return (s_vec_2d){ pos.x - (size.x / 2.0f), pos.y - (size.y / 2.0f)};
 }
 
+inline s_rect CameraRect(const s_camera* const cam, const s_vec_2d_i display_size) {
+    const s_vec_2d tl = CameraTopLeft(cam, display_size);
+    const s_vec_2d size = CameraSize(display_size);
+    return (s_rect){tl.x, tl.y, size.x, size.y};
+}
+
 inline s_vec_2d CameraToDisplayPos(const s_vec_2d pos, const s_camera* const cam, const s_vec_2d_i display_size) {
     assert(display_size.x > 0 && display_size.y > 0);
     const s_vec_2d cam_tl = CameraTopLeft(cam, display_size);
@@ -190,4 +235,52 @@ inline void RenderSprite(const s_rendering_context* const context, const int spr
     );
 }
 
+inline void RenderSpriteFlashed(const s_rendering_context* const context, const int sprite_index, const s_textures* const textures, const s_vec_2d pos, const s_vec_2d origin, const s_vec_2d scale, const float rot, const s_color blend, const s_color flash) {
+    RenderTextureFlashed(
+        context,
+        g_sprites[sprite_index].tex,
+        textures,
+        g_sprites[sprite_index].src_rect,
+        pos,
+        origin,
+        scale,
+        rot,
+        blend,
+        flash
+    );
+}
+
+inline void RenderSpritesBulk(const s_rendering_context* const context, const int sprite_index, const s_textures* const textures, const s_vec_2d origin, const s_render_bulk_input* const input) {
+    RenderTextureBulk(
+        context,
+        g_sprites[sprite_index].tex,
+        textures,
+        g_sprites[sprite_index].src_rect,
+        origin,
+        input
+    );
+}
+
+// Rotated sprites are conservatively treated as the square covering every rotation about the origin.
+inline bool IsSpriteInView(const int sprite_index, const s_vec_2d pos, const s_vec_2d origin, const float rot, const s_rect view_rect) {
+    const s_rect_i src_rect = g_sprites[sprite_index].src_rect;
+
+    if (rot == 0.0f) {
+        const s_rect bounds = {
+            pos.x - (src_rect.width * origin.x),
+            pos.y - (src_rect.height * origin.y),
+            src_rect.width,
+            src_rect.height
+        };
+
+        return DoRectsInters(bounds, view_rect);
+    }
+
+    const float ext_x = src_rect.width * MAX(origin.x, 1.0f - origin.x);
+    const float ext_y = src_rect.height * MAX(origin.y, 1.0f - origin.y);
+    const float radius = sqrtf((ext_x * ext_x) + (ext_y * ext_y));
+
+    return DoRectsInters((s_rect){pos.x - radius, pos.y - radius, radius * 2.0f, radius * 2.0f}, view_rect);
+}
+
 #endif
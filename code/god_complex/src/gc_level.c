@@ -33,8 +33,69 @@ static s_damage_info GenProjectileDamageInfo(const s_projectile* const proj) {
     };
 }
 
-static bool UpdateProjectiles(s_level* const level, s_mem_arena* const temp_mem_arena) {
+static void UpdateGPUProjectiles(s_level* const level, s_gpu_projectile_system* const gpu_projs, s_gl_state_cache* const gl_state_cache, s_particle_system* const particles) {
     assert(level);
+    assert(gpu_projs);
+    assert(gl_state_cache);
+    assert(particles);
+
+    // The player is the first target, with each enemy following at its index plus one. Inactive enemies are left with no mask, so that nothing hits them.
+    s_gpu_projectile_target targets[1 + ENEMY_LIMIT] = {0};
+
+    if (!level->player.killed) {
+        targets[0] = (s_gpu_projectile_target){
+            .rect = GenPlayerCollider(level->player.pos),
+            .mask = ek_gpu_projectile_target_player
+        };
+    }
+
+    for (int i = 0; i < ENEMY_LIMIT; i++) {
+        if (!IsEnemyActive(i, &level->enemy_list)) {
+            continue;
+        }
+
+        targets[1 + i] = (s_gpu_projectile_target){
+            .rect = GenEnemyDamageCollider(level->enemy_list.buf[i].pos),
+            .mask = ek_gpu_projectile_target_enemy
+        };
+    }
+
+    const s_gpu_projectile_step_input input = {
+        .targets = targets,
+        .target_cnt = 1 + ENEMY_LIMIT,
+        .solid_cells = level->tilemap,
+        .grid_size = {TILEMAP_WIDTH, TILEMAP_HEIGHT},
+        .cell_size = TILE_SIZE
+    };
+
+    StepGPUProjectiles(gpu_projs, gl_state_cache, &input);
+
+    // Hits come back a step or more after they happened, by which point what was hit might be gone.
+    for (int i = 0; i < gpu_projs->hit_cnt; i++) {
+        const s_gpu_projectile_hit* const hit = &gpu_projs->hits[i];
+
+        const s_damage_info dmg_info = {
+            .dmg = hit->dmg,
+            .kb = hit->vel
+        };
+
+        if (hit->target_index == 0) {
+            if (!level->player.killed) {
+                DamagePlayer(level, dmg_info);
+            }
+        } else {
+            const int enemy_index = (int)hit->target_index - 1;
+
+            if (IsEnemyActive(enemy_index, &level->enemy_list)) {
+                DamageEnemy(level, particles, enemy_index, dmg_info);
+            }
+        }
+    }
+}
+
+static bool UpdateProjectiles(s_level* const level, s_particle_system* const particles, s_mem_arena* const temp_mem_arena) {
+    assert(level);
+    assert(particles);
     assert(temp_mem_arena && IsMemArenaValid(temp_mem_arena));
 
     // Process projectile movement.
@@ -105,7 +166,7 @@ static bool UpdateProjectiles(s_level* const level, s_mem_arena* const temp_mem_
 
                 if (DoesPolyIntersWithRect(&proj_colliders[i], enemy_dmg_colliders[j])) {
                     const s_damage_info proj_dmg_info = GenProjectileDamageInfo(proj);
-                    DamageEnemy(level, j, proj_dmg_info);
+                    DamageEnemy(level, particles, j, proj_dmg_info);
 
                     level->proj_cnt -= 1;
                     level->projectiles[i] = level->projectiles[level->proj_cnt];
@@ -120,7 +181,7 @@ static bool UpdateProjectiles(s_level* const level, s_mem_arena* const temp_mem_
     return true;
 }
 
-bool LevelTick(s_game* const game, const s_window_state* const window_state, const s_input_state* const input_state, const s_input_state* const input_state_last, s_mem_arena* const temp_mem_arena) {
+bool LevelTick(s_game* const game, const s_window_state* const window_state, const s_input_state* const input_state, const s_input_state* const input_state_last, s_gl_state_cache* const gl_state_cache, s_mem_arena* const temp_mem_arena) {
     s_level* const level = &game->level;
 
     if (IsKeyPressed(ek_key_code_escape, input_state, input_state_last)) {
@@ -131,72 +192,154 @@ bool LevelTick(s_game* const game, const s_window_state* const window_state, con
         return true;
     }
 
+    UpdateParticles(&game->particles);
+
+    s_gpu_projectile_system* const gpu_projs = game->gpu_projectiles_enabled ? &game->gpu_projectiles : NULL;
+
     ProcPlayerMovement(&level->player, input_state, &level->tilemap, &level->camera, window_state->size);
 
-    if (!ProcPlayerShooting(level, window_state->size, input_state, input_state_last)) {
+    if (!ProcPlayerShooting(level, gpu_projs, &game->particles, window_state->size, input_state, input_state_last)) {
         return false;
     }
 
     UpdatePlayerTimers(&level->player);
 
-    if (!UpdateEnemies(level)) {
+    if (!UpdateEnemies(level, gpu_projs, &game->particles)) {
         return false;
     }
 
-    UpdateProjectiles(level, temp_mem_arena);
+    if (gpu_projs) {
+        UpdateGPUProjectiles(level, gpu_projs, gl_state_cache, &game->particles);
+    } else {
+        UpdateProjectiles(level, &game->particles, temp_mem_arena);
+    }
 
     ProcPlayerDeath(level);
-    ProcEnemyDeaths(level);
+    ProcEnemyDeaths(level, &game->particles);
 
     UpdateCamera(level, window_state, input_state);
 
     return true;
 }
 
-void RenderProjectiles(const s_rendering_context* const rendering_context, const s_projectile* const projectiles, const int proj_cnt, const s_textures* const textures) {
+void RenderProjectiles(const s_rendering_context* const rendering_context, const s_projectile* const projectiles, const int proj_cnt, const s_rect view_rect, s_cull_stats* const cull_stats, const s_textures* const textures) {
     assert(rendering_context);
     assert(projectiles);
     assert(proj_cnt >= 0 && proj_cnt <= PROJECTILE_LIMIT);
+    assert(cull_stats);
+
+    // The visible projectiles are gathered up so that they can all be submitted in one go.
+    s_vec_2d positions[PROJECTILE_LIMIT];
+    float rots[PROJECTILE_LIMIT];
+    int visible_cnt = 0;
 
     for (int i = 0; i < proj_cnt; i++) {
         const s_projectile* const proj = &projectiles[i];
 
-        RenderSprite(
-            rendering_context,
-            ek_sprite_projectile,
-            textures,
-            proj->pos,
-            (s_vec_2d){0.5f, 0.5f},
-            (s_vec_2d){1.0f, 1.0f},
-            proj->rot,
-            WHITE
-        );
+        if (!IsSpriteInView(ek_sprite_projectile, proj->pos, (s_vec_2d){0.5f, 0.5f}, proj->rot, view_rect)) {
+            cull_stats->culled_cnt++;
+            continue;
+        }
+
+        positions[visible_cnt] = proj->pos;
+        rots[visible_cnt] = proj->rot;
+        visible_cnt++;
     }
+
+    cull_stats->drawn_cnt += visible_cnt;
+
+    const s_render_bulk_input input = {
+        .cnt = visible_cnt,
+        .positions = positions,
+        .rots = rots
+    };
+
+    RenderSpritesBulk(rendering_context, ek_sprite_projectile, textures, (s_vec_2d){0.5f, 0.5f}, &input);
 }
 
-bool RenderLevel(const s_rendering_context* const rendering_context, const s_level* const level, const s_textures* const textures, const s_fonts* const fonts, const s_shader_progs* const shader_progs, s_mem_arena* const temp_mem_arena) {
-    ZeroOut(&rendering_context->state->view_mat, sizeof(rendering_context->state->view_mat));
-    InitCameraViewMatrix4x4(&rendering_context->state->view_mat, &level->camera, rendering_context->display_size);
+typedef struct {
+    const s_level* level;
+    const s_gpu_projectile_system* gpu_projs;
+    s_particle_system* particles;
+    s_tilemap_render_batch* tilemap_render_batch;
+    s_render_cmd_list* enemy_render_cmd_lists;
+    s_dynamic_res* dynamic_res;
+    bool virtual_res;
+    s_cull_stats* cull_stats;
+    const s_textures* textures;
+    const s_fonts* fonts;
+    s_mem_arena* temp_mem_arena;
+} s_level_render_data;
+
+// Renders the world and the HUD over it, which is everything but the pause screen.
+static bool RenderLevelScene(const s_rendering_context* const rendering_context, const s_level_render_data* const data) {
+    {
+        t_matrix_4x4 view_mat = {0};
+        InitCameraViewMatrix4x4(&view_mat, &data->level->camera, rendering_context->display_size);
+        SetViewMatrix(rendering_context, &view_mat);
+    }
+
+    if (data->virtual_res) {
+        if (!BeginVirtualResPass(rendering_context, VIRTUAL_RES_SURF_INDEX, (int)CAMERA_SCALE)) {
+            return false;
+        }
+    } else if (data->dynamic_res) {
+        if (!BeginDynamicResPass(rendering_context, data->dynamic_res, DYNAMIC_RES_SURF_INDEX)) {
+            return false;
+        }
+    }
 
     RenderClear((s_color){0.2, 0.3, 0.4, 1.0});
 
-    RenderEnemies(rendering_context, &level->enemy_list, textures, shader_progs);
+    ZeroOut(data->cull_stats, sizeof(*data->cull_stats));
 
-    if (!level->player.killed) {
-        RenderPlayer(rendering_context, &level->player, textures, shader_progs);
+    const s_rect view_rect = CameraRect(&data->level->camera, rendering_context->display_size);
+
+    // World rendering is queued, with the layers determining draw order.
+    BeginRenderQueue(rendering_context, false);
+
+    SetRenderLayer(rendering_context, ek_render_layer_enemies);
+    RenderEnemies(rendering_context, &data->level->enemy_list, data->enemy_render_cmd_lists, view_rect, data->cull_stats, data->textures);
+
+    if (!data->level->player.killed) {
+        SetRenderLayer(rendering_context, ek_render_layer_player);
+        RenderPlayer(rendering_context, &data->level->player, data->textures);
     }
 
-    RenderProjectiles(rendering_context, level->projectiles, level->proj_cnt, textures);
+    if (!data->gpu_projs) {
+        SetRenderLayer(rendering_context, ek_render_layer_projectiles);
+        RenderProjectiles(rendering_context, data->level->projectiles, data->level->proj_cnt, view_rect, data->cull_stats, data->textures);
+    }
 
-    RenderTilemap(rendering_context, &level->tilemap, textures);
+    EndRenderQueue(rendering_context);
 
-    Flush(rendering_context);
+    RenderParticles(rendering_context, data->particles);
+
+    if (data->gpu_projs) {
+        RenderGPUProjectiles(rendering_context, data->gpu_projs, &view_rect, g_sprites[ek_sprite_projectile].tex, data->textures, g_sprites[ek_sprite_projectile].src_rect, (s_vec_2d){0.5f, 0.5f}, WHITE);
+    }
+
+    // The tilemap goes over the rest of the world.
+    {
+        const int tiles_drawn_cnt = RenderTilemap(rendering_context, data->tilemap_render_batch, view_rect);
+        data->cull_stats->drawn_cnt += tiles_drawn_cnt;
+        data->cull_stats->culled_cnt += data->tilemap_render_batch->batch.slot_cnt - tiles_drawn_cnt;
+    }
+
+    if (data->virtual_res) {
+        EndVirtualResPass(rendering_context);
+    } else if (data->dynamic_res) {
+        EndDynamicResPass(rendering_context, data->dynamic_res);
+    }
 
     //
     // UI
     //
-    ZeroOut(&rendering_context->state->view_mat, sizeof(rendering_context->state->view_mat));
-    InitIdenMatrix4x4(&rendering_context->state->view_mat);
+    {
+        t_matrix_4x4 view_mat = {0};
+        InitIdenMatrix4x4(&view_mat);
+        SetViewMatrix(rendering_context, &view_mat);
+    }
 
     // Render player health.
     {
@@ -208,13 +351,7 @@ bool RenderLevel(const s_rendering_context* const rendering_context, const s_lev
             bar_size.y
         };
 
-        RenderBarHor(rendering_context, bar_rect, (float)level->player.hp / PLAYER_HP_LIMIT, ToColorRGB(WHITE), ToColorRGB(BLACK));
-    }
-
-    // Render pause screen.
-    if (level->paused) {
-        RenderRect(rendering_context, (s_rect){0, 0, rendering_context->display_size.x, rendering_context->display_size.y}, (s_color){0.0f, 0.0f, 0.0f, PAUSE_SCREEN_BG_ALPHA});
-        RenderStr(rendering_context, "Paused", ek_font_eb_garamond_64, fonts, (s_vec_2d){rendering_context->display_size.x / 2.0f, rendering_context->display_size.y / 2.0f}, ek_str_hor_align_center, ek_str_ver_align_center, WHITE, temp_mem_arena);
+        RenderBarHor(rendering_context, bar_rect, (float)data->level->player.hp / PLAYER_HP_LIMIT, ToColorRGB(WHITE), ToColorRGB(BLACK));
     }
 
     Flush(rendering_context);
@@ -222,24 +359,98 @@ bool RenderLevel(const s_rendering_context* const rendering_context, const s_lev
     return true;
 }
 
-bool SpawnProjectile(s_level* const level, const s_vec_2d pos, const float spd, const float dir, const int dmg, const bool from_enemy) {
+static bool RenderLevelScenePass(const s_rendering_context* const context, const s_render_pass_info* const pass_info) {
+    return RenderLevelScene(context, pass_info->user_data);
+}
+
+static bool RenderPauseScreenPass(const s_rendering_context* const context, const s_render_pass_info* const pass_info) {
+    const s_level_render_data* const data = pass_info->user_data;
+
+    StretchSurface(context, pass_info->input_surf_indices[0]);
+
+    RenderRect(context, (s_rect){0, 0, context->display_size.x, context->display_size.y}, (s_color){0.0f, 0.0f, 0.0f, PAUSE_SCREEN_BG_ALPHA});
+    RenderStr(context, "Paused", ek_font_eb_garamond_64, data->fonts, (s_vec_2d){context->display_size.x / 2.0f, context->display_size.y / 2.0f}, ek_str_hor_align_center, ek_str_ver_align_center, WHITE, data->temp_mem_arena);
+
+    return true;
+}
+
+// The GPU projectile system can be NULL, in which case the projectiles of the level are rendered instead. The dynamic resolution state can be NULL, in which case the world is rendered at full resolution. It goes unused if the world is rendered at virtual (camera) resolution.
+bool RenderLevel(const s_rendering_context* const rendering_context, const s_level* const level, const s_gpu_projectile_system* const gpu_projs, s_particle_system* const particles, s_tilemap_render_batch* const tilemap_render_batch, s_render_cmd_list* const enemy_render_cmd_lists, s_dynamic_res* const dynamic_res, const bool virtual_res, s_cull_stats* const cull_stats, const s_textures* const textures, const s_fonts* const fonts, s_mem_arena* const temp_mem_arena) {
+    s_level_render_data data = {
+        .level = level,
+        .gpu_projs = gpu_projs,
+        .particles = particles,
+        .tilemap_render_batch = tilemap_render_batch,
+        .enemy_render_cmd_lists = enemy_render_cmd_lists,
+        .dynamic_res = dynamic_res,
+        .virtual_res = virtual_res,
+        .cull_stats = cull_stats,
+        .textures = textures,
+        .fonts = fonts,
+        .temp_mem_arena = temp_mem_arena
+    };
+
+    if (!level->paused) {
+        return RenderLevelScene(rendering_context, &data);
+    }
+
+    // Paused, the scene is rendered into a graph target for the pause screen to go over.
+    s_render_graph graph = {0};
+    ReserveRenderGraphSurface(&graph, DYNAMIC_RES_SURF_INDEX);
+    ReserveRenderGraphSurface(&graph, VIRTUAL_RES_SURF_INDEX);
+    ReserveRenderGraphSurface(&graph, SCENE_SURF_INDEX);
+
+    const int backdrop_target = AddRenderGraphTarget(&graph, ek_render_target_size_full, ek_render_target_format_rgba8);
+    AddRenderGraphPass(&graph, RenderLevelScenePass, &data, backdrop_target, NULL, 0);
+    AddRenderGraphPass(&graph, RenderPauseScreenPass, &data, RENDER_GRAPH_DISPLAY_TARGET, &backdrop_target, 1);
+
+    return ExecuteRenderGraph(rendering_context, &graph);
+}
+
+// The projectile goes to the GPU projectile system if one is given, or into the level otherwise.
+bool SpawnProjectile(s_level* const level, s_gpu_projectile_system* const gpu_projs, s_particle_system* const particles, const s_vec_2d pos, const float spd, const float dir, const int dmg, const bool from_enemy) {
     assert(level);
+    assert(particles);
     assert(spd > 0.0f);
     assert(dmg > 0);
 
-    if (level->proj_cnt == PROJECTILE_LIMIT) {
-        fprintf(stderr, "Failed to spawn projectile due to insufficient space!\n");
-        return false;
+    if (gpu_projs) {
+        if (!SpawnGPUProjectile(gpu_projs, pos, LenDir(spd, dir), dir, dmg, from_enemy ? ek_gpu_projectile_target_player : ek_gpu_projectile_target_enemy)) {
+            fprintf(stderr, "Failed to spawn GPU projectile due to insufficient space!\n");
+            return false;
+        }
+    } else {
+        if (level->proj_cnt == PROJECTILE_LIMIT) {
+            fprintf(stderr, "Failed to spawn projectile due to insufficient space!\n");
+            return false;
+        }
+
+        level->projectiles[level->proj_cnt] = (s_projectile){
+            .pos = pos,
+            .vel = LenDir(spd, dir),
+            .rot = dir,
+            .dmg = dmg,
+            .from_enemy = from_enemy
+        };
+        level->proj_cnt++;
     }
 
-    level->projectiles[level->proj_cnt] = (s_projectile){
+    // Muzzle flash.
+    EmitParticles(particles, &(s_particle_emit_info){
         .pos = pos,
-        .vel = LenDir(spd, dir),
-        .rot = dir,
-        .dmg = dmg,
-        .from_enemy = from_enemy
-    };
-    level->proj_cnt++;
+        .cnt = 12,
+        .dir = dir,
+        .spread = 0.6f,
+        .spd_min = 2.0f,
+        .spd_max = 5.0f,
+        .lifetime_min = 4,
+        .lifetime_max = 8,
+        .size_begin = 3.0f,
+        .size_end = 0.0f,
+        .col_begin = {1.0f, 0.9f, 0.5f, 1.0f},
+        .col_end = {1.0f, 0.4f, 0.1f, 0.0f},
+        .drag = 0.2f
+    });
 
     return true;
 }
@@ -53,12 +53,12 @@ void ProcPlayerMovement(s_player* const player, const s_input_state* const input
     player->rot = Dir(Vec2DDiff(mouse_cam_pos, player->pos));
 }
 
-bool ProcPlayerShooting(s_level* const level, const s_vec_2d_i display_size, const s_input_state* const input_state, const s_input_state* const input_state_last) {
+bool ProcPlayerShooting(s_level* const level, s_gpu_projectile_system* const gpu_projs, s_particle_system* const particles, const s_vec_2d_i display_size, const s_input_state* const input_state, const s_input_state* const input_state_last) {
     if (IsMouseButtonPressed(ek_mouse_button_code_left, input_state, input_state_last)) {
         const s_vec_2d mouse_cam_pos = DisplayToCameraPos(input_state->mouse_pos, &level->camera, display_size);
         const float shoot_dir = DirFrom(level->player.pos, mouse_cam_pos);
 
-        if (!SpawnProjectile(level, level->player.pos, 12.0f, shoot_dir, 4, false)) {
+        if (!SpawnProjectile(level, gpu_projs, particles, level->player.pos, 12.0f, shoot_dir, 4, false)) {
             return false;
         }
     }
@@ -96,20 +96,12 @@ static float CalcPlayerAlpha(const int inv_time) {
     return 1.0f;
 }
 
-void RenderPlayer(const s_rendering_context* const rendering_context, const s_player* const player, const s_textures* const textures, const s_shader_progs* const shader_progs) {
+void RenderPlayer(const s_rendering_context* const rendering_context, const s_player* const player, const s_textures* const textures) {
     assert(rendering_context);
     assert(player && !player->killed);
     assert(textures);
 
-    if (player->flash_time > 0) {
-        Flush(rendering_context);
-
-        SetSurface(rendering_context, 0);
-
-        RenderClear((s_color){0});
-    }
-
-    RenderSprite(
+    RenderSpriteFlashed(
         rendering_context,
         ek_sprite_player,
         textures,
@@ -117,27 +109,9 @@ void RenderPlayer(const s_rendering_context* const rendering_context, const s_pl
         (s_vec_2d){0.5f, 0.5f},
         (s_vec_2d){1.0f, 1.0f},
         player->rot,
-        (s_color){1.0f, 1.0f, 1.0f, CalcPlayerAlpha(player->inv_time)}
+        (s_color){1.0f, 1.0f, 1.0f, CalcPlayerAlpha(player->inv_time)},
+        player->flash_time > 0 ? WHITE : (s_color){0}
     );
-
-    if (player->flash_time > 0) {
-        Flush(rendering_context);
-
-        UnsetSurface(rendering_context);
-
-        SetSurfaceShaderProg(rendering_context, shader_progs->gl_ids[ek_shader_prog_blend]);
-
-        SetSurfaceShaderProgUniform(
-            rendering_context,
-            "u_col",
-            (s_shader_prog_uniform_value){
-                .type = ek_shader_prog_uniform_value_type_v3,
-                .as_v3 = {1.0f, 1.0f, 1.0f}
-            }
-        );
-
-        RenderSurface(rendering_context, 0);
-    }
 }
 
 s_rect GenPlayerCollider(const s_vec_2d player_pos) {
@@ -56,8 +56,26 @@ void ProcTilemapCollisions(s_vec_2d* const vel, const s_rect collider, const t_t
     }
 }
 
-void RenderTilemap(const s_rendering_context* const rendering_context, const t_tilemap* const tilemap, const s_textures* const textures) {
+// The tilemap doesn't change after level initialisation, so it's recorded into a static batch once rather than being resubmitted every frame.
+bool GenTilemapRenderBatch(s_tilemap_render_batch* const batch, const t_tilemap* const tilemap, const s_textures* const textures, const s_rendering_context* const rendering_context) {
+    assert(batch);
+    assert(tilemap);
+    assert(textures);
+    assert(rendering_context);
+
+    if (batch->batch.vert_array_gl_id == 0) {
+        if (!InitStaticRenderBatch(&batch->batch, rendering_context, TILEMAP_WIDTH * TILEMAP_HEIGHT)) {
+            return false;
+        }
+    } else {
+        ClearStaticRenderBatch(&batch->batch);
+    }
+
+    const s_sprite* const sprite = &g_sprites[ek_sprite_tile];
+
     for (int ty = 0; ty < TILEMAP_HEIGHT; ty++) {
+        batch->row_slot_begins[ty] = batch->batch.slot_cnt;
+
         for (int tx = 0; tx < TILEMAP_WIDTH; tx++) {
             if (!IsTileActive(tilemap, tx, ty)) {
                 continue;
@@ -68,7 +86,32 @@ void RenderTilemap(const s_rendering_context* const rendering_context, const t_t
                 TILE_SIZE * ty
             };
 
-            RenderSprite(rendering_context, ek_sprite_tile, textures, tpos, (s_vec_2d){0}, (s_vec_2d){1.0f, 1.0f}, 0.0f, WHITE);
+            if (AddTextureToStaticRenderBatch(&batch->batch, sprite->tex, textures, sprite->src_rect, tpos, (s_vec_2d){0}, (s_vec_2d){1.0f, 1.0f}, 0.0f, WHITE) == -1) {
+                return false;
+            }
         }
     }
+
+    batch->row_slot_begins[TILEMAP_HEIGHT] = batch->batch.slot_cnt;
+
+    return true;
+}
+
+// Only the rows overlapping the view rect are drawn, as one range of the batch. Tiles off to the sides of those rows are left to clipping. Returns the number of tiles drawn.
+int RenderTilemap(const s_rendering_context* const rendering_context, s_tilemap_render_batch* const batch, const s_rect view_rect) {
+    assert(rendering_context);
+    assert(batch);
+
+    const s_rect_edges_i view_span = RectTilemapSpan(view_rect);
+
+    if (view_span.bottom <= view_span.top) {
+        return 0;
+    }
+
+    const int slot_begin = batch->row_slot_begins[view_span.top];
+    const int slot_cnt = batch->row_slot_begins[view_span.bottom] - slot_begin;
+
+    RenderStaticBatchRange(rendering_context, &batch->batch, slot_begin, slot_cnt);
+
+    return slot_cnt;
 }
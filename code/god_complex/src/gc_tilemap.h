@@ -11,9 +11,15 @@
 
 typedef t_byte t_tilemap[BITS_TO_BYTES(TILEMAP_WIDTH * TILEMAP_HEIGHT)];
 
+typedef struct {
+    s_static_render_batch batch;
+    int row_slot_begins[TILEMAP_HEIGHT + 1]; // Tiles are recorded row by row, so the slots of rows a to b are those from row_slot_begins[a] to row_slot_begins[b].
+} s_tilemap_render_batch;
+
 bool TilemapCollision(const t_tilemap* const tilemap, const s_rect collider);
 void ProcTilemapCollisions(s_vec_2d* const vel, const s_rect collider, const t_tilemap* const tilemap);
-void RenderTilemap(const s_rendering_context* const rendering_context, const t_tilemap* const tilemap, const s_textures* const textures);
+bool GenTilemapRenderBatch(s_tilemap_render_batch* const batch, const t_tilemap* const tilemap, const s_textures* const textures, const s_rendering_context* const rendering_context);
+int RenderTilemap(const s_rendering_context* const rendering_context, s_tilemap_render_batch* const batch, const s_rect view_rect);
 
 inline bool IsTilePosInBounds(const int x, const int y) {
     return x >= 0 && x < TILEMAP_WIDTH && y >= 0 && y < TILEMAP_HEIGHT;